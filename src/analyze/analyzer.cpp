@@ -2,19 +2,27 @@
 #include "alert/alert.hpp"
 #include "app.hpp"
 #include "error/error_list.hpp"
+#include "jobs/jobs.hpp"
 #include "log/log.hpp"
 
 #include <algorithm>
+#include <atomic>
 #include <iostream>
 #include <limits>
-#include <sstream>
+#include <memory>
+#include <mutex>
 #include <string>
 
 namespace titan {
 
-analyzer::analyzer(std::vector<instructions::instruction_ptr> &tree)
-    : _tree(tree), _current_function(nullptr), _num_errors(0),
-      _uid(0), _err("analyzer")
+analyzer::analyzer()
+    : _current_function(nullptr), _jobs(1), _err("analyzer"), _num_errors(0)
+{
+}
+
+analyzer::analyzer(analyzer &owner)
+    : _table(&owner._table), _current_function(nullptr), _jobs(1),
+      _err("analyzer"), _num_errors(0)
 {
 }
 
@@ -23,57 +31,177 @@ void analyzer::report_error(uint64_t error_no, size_t line, size_t col,
                             std::string file)
 {
   std::string target_file;
+  bool no_source = false;
   if (!_current_function) {
     if (!file.empty()) {
       target_file = file;
     }
     else {
-      _err.raise(error_no);
+      no_source = true;
     }
   }
   else {
     target_file = _current_function->file_name;
   }
 
-  alert::config cfg;
+  _found.reports.push_back({error_no, line, col, msg, show_col, target_file,
+                            no_source, _found.errors});
+  _found.errors++;
+}
+
+void analyzer::merge(findings &found)
+{
+  for (auto &r : found.reports) {
+    if (r.no_source) {
+      _err.raise(r.error_no);
+    }
+
+    alert::config cfg;
 
-  cfg.set_basic(target_file, msg, line, col);
+    cfg.set_basic(r.file, r.msg, r.line, r.col);
 
-  bool show_full = _num_errors == 0;
+    bool show_full = _num_errors + r.errors_before == 0;
 
-  cfg.set_show_chunk(show_full);
-  cfg.set_all_attn(show_full);
+    cfg.set_show_chunk(show_full);
+    cfg.set_all_attn(show_full);
 
-  cfg.show_line_num = line != 0;
-  cfg.show_col_num = show_col;
+    cfg.show_line_num = r.line != 0;
+    cfg.show_col_num = r.show_col;
+
+    _err.raise(r.error_no, &cfg);
+  }
+  _num_errors += found.errors;
 
-  _err.raise(error_no, &cfg);
-  _num_errors++;
+  for (auto fn : found.called_pending) {
+    if (_queued.insert(fn).second) {
+      _deferred.push_back(fn);
+    }
+  }
+  found = {};
 }
 
-bool analyzer::analyze()
+bool analyzer::analyze(std::vector<instructions::instruction_ptr> &items)
 {
   LOG(DEBUG) << TAG(APP_FILE_NAME) << "[" << APP_LINE
              << "]: Starting semeantic analysis" << std::endl;
 
-  uint64_t item_count = 0;
+  // Every call is checked as if it were the first, apart from the globals
+  auto checkpoint = _table.global_count();
+  _current_function = nullptr;
+  _num_errors = 0;
+  _deferred.clear();
 
-  for (auto &item : _tree) {
+  if (check(items)) {
+    return true;
+  }
 
-    if (_num_errors >= NUM_ERRORS_BEFORE_ABORT) {
-      return false;
-    }
+  // Bodies that were queued may not have been checked
+  _table.rollback_globals(checkpoint);
+  for (auto fn : _deferred) {
+    _queued.erase(fn);
+  }
+  return false;
+}
+
+bool analyzer::check(std::vector<instructions::instruction_ptr> &tree)
+{
+  //  Register every top level item in order, leaving function bodies for
+  //  later. Each body is then checked against the globals registered before
+  //  it, as checking the items in order would have, so the global table no
+  //  longer changes and bodies can be checked on separate threads
+  //
+  std::vector<findings> items(tree.size());
+  std::vector<size_t> with_body;
+  std::vector<uint64_t> registered_before(tree.size()); // Errors found so far
+  uint64_t registered = 0;
+  for (size_t idx = 0; idx < tree.size(); idx++) {
 
-    item_count++;
     LOG(DEBUG) << TAG(APP_FILE_NAME) << "[" << APP_LINE
-               << "]: Analyzing item number " << item_count << std::endl;
+               << "]: Analyzing item number " << idx + 1 << std::endl;
+
+    registered_before[idx] = registered;
+    tree[idx]->visit(*this);
+    registered += _found.errors;
+    items[idx] = std::move(_found);
+    _found = {};
+    if (items[idx].body) {
+      with_body.push_back(idx);
+    }
+  }
+
+  std::vector<findings> bodies(tree.size());
+  if (!with_body.empty()) {
+    auto workers = std::min(std::max<size_t>(_jobs, 1), with_body.size());
+    std::vector<std::unique_ptr<analyzer>> checkers(workers);
+
+    //  Errors of the run of bodies at the front of 'with_body' that have all
+    //  been checked. Along with what registering found, that many errors are
+    //  raised before any body still to be checked is reached, so one can be
+    //  skipped once raising them in order would abort first
+    //
+    std::mutex front_lock;
+    std::vector<bool> finished(with_body.size(), false);
+    size_t front = 0;
+    std::atomic<uint64_t> front_errors{0};
+
+    jobs::run(with_body.size(), workers, [&](size_t task, size_t worker) {
+      auto idx = with_body[task];
+      if (registered_before[idx] + front_errors < NUM_ERRORS_BEFORE_ABORT) {
+        auto &checker = checkers[worker];
+        if (!checker) {
+          checker.reset(new analyzer(*this));
+        }
+
+        checker->_table.set_visible_globals(items[idx].body->visible);
+        checker->analyze_body(*items[idx].body->fn);
+        bodies[idx] = std::move(checker->_found);
+        checker->_found = {};
+      }
 
-    item->visit(*this);
+      std::lock_guard<std::mutex> lock(front_lock);
+      finished[task] = true;
+      auto errors = front_errors.load();
+      for (; front < finished.size() && finished[front]; front++) {
+        errors += bodies[with_body[front]].errors;
+      }
+      front_errors = errors;
+    });
+  }
+
+  //  Errors are raised item by item in source order, stopping where
+  //  checking the items in order would have given up
+  //
+  for (size_t idx = 0; idx < tree.size(); idx++) {
+    if (aborted()) {
+      return false;
+    }
+    merge(items[idx]);
+    merge(bodies[idx]);
 
     LOG(DEBUG) << TAG(APP_FILE_NAME) << "[" << APP_LINE << "]: Item number "
-               << item_count << " complete" << std::endl;
+               << idx + 1 << " complete" << std::endl;
+  }
+
+  // Bodies of called functions that were not parsed up front. Checking one
+  // can find calls to more of them
+  for (size_t idx = 0; idx < _deferred.size(); idx++) {
+
+    if (aborted()) {
+      return false;
+    }
+
+    auto fn = _deferred[idx];
+    if (!fn->load_body()) {
+      _num_errors++;
+      continue;
+    }
+    analyze_body(*fn);
+    merge(_found);
   }
 
+  LOG(DEBUG) << TAG(APP_FILE_NAME) << "[" << APP_LINE << "]: Checked "
+             << _deferred.size() << " deferred function bodies" << std::endl;
+
   return _num_errors == 0;
 }
 
@@ -82,7 +210,7 @@ void analyzer::receive(instructions::import &ins)
   LOG(WARNING) << TAG(APP_FILE_NAME) << "[" << APP_LINE
                << "]: Import statement made its way to analyzer"
                << std::endl;
-  _num_errors++;
+  _found.errors++;
 }
 
 void analyzer::receive(instructions::function &ins)
@@ -91,10 +219,12 @@ void analyzer::receive(instructions::function &ins)
 
   //  Attempt to add the item - if it fails its a duplicate
   //
-  if (!_table.add_symbol(_current_function->name, _current_function)) {
-    std::string msg = "Duplicate function \"" + _current_function->name + "\"";
+  if (!_table.add_symbol(_current_function->id, _current_function)) {
+    std::string msg = "Duplicate function \"";
+    msg += _current_function->name;
+    msg += "\"";
 
-    auto item = _table.lookup(_current_function->name);
+    auto item = _table.lookup(_current_function->id);
     if (item != std::nullopt) {
 
       auto first_fn = item.value();
@@ -109,7 +239,7 @@ void analyzer::receive(instructions::function &ins)
         LOG(ERROR) << TAG(APP_FILE_NAME) << "[" << APP_LINE
                    << "] unexpected type from table during presecan :"
                    << std::endl;
-        _num_errors++;
+        _found.errors++;
         return;
       }
     }
@@ -118,14 +248,28 @@ void analyzer::receive(instructions::function &ins)
                  _current_function->col, msg, true, _current_function->file_name);
   }
 
+  //  A body that wasn't parsed waits until something calls it
+  //
+  if (ins.body_pending()) {
+    return;
+  }
+
+  _found.body = body_task{&ins, _table.global_count()};
+}
+
+void analyzer::analyze_body(instructions::function &fn)
+{
+  _current_function = &fn;
+
   //  Create a scope for the current function
   //
-  _table.add_scope_and_enter(_current_function->name);
+  _table.add_scope_and_enter(symbol::scope_kind::FUNCTION,
+                             _current_function->id);
 
   //  Check parameters
   //
   for (auto &param : _current_function->parameters) {
-    if (!_table.add_symbol(param->name, param.get())) {
+    if (!_table.add_symbol(param->id, param)) {
       report_error(error::analyzer::DUPLICATE_PARAMETER,
                    _current_function->line, _current_function->col, "");
       _table.pop_scope();
@@ -148,7 +292,7 @@ void analyzer::receive(instructions::define_user_struct &ins)
 {
   LOG(DEBUG) << TAG(APP_FILE_NAME) << "[" << APP_LINE
              << "]: User defined struct not yet implemented in analyzer" << std::endl;
-  _num_errors++;
+  _found.errors++;
 }
 
 void analyzer::receive(instructions::assignment_instruction &ins)
@@ -158,37 +302,42 @@ void analyzer::receive(instructions::assignment_instruction &ins)
 
   // Allow shadowing, report duplicates
   //
-  if (!_table.add_symbol(ins.var->name, &ins)) {
-    auto existing_item = _table.lookup(ins.var->name).value();
+  if (!_table.add_symbol(ins.var->id, &ins)) {
+    auto existing_item = _table.lookup(ins.var->id).value();
     std::string msg = "Duplicate variable name \"";
     msg += ins.var->name;
     msg += "\". Item first defined on line ";
     msg += std::to_string(existing_item.assignment->line);
+    LOG(DEBUG) << TAG(APP_FILE_NAME) << "[" << APP_LINE << "]: Duplicate in "
+               << _table.scope_name() << std::endl;
     report_error(error::analyzer::DUPLICATE_VARIABLE_DEF, ins.line,
                  0, msg, false);
     return;
   }
 
-  auto expression_result = analyze_expression(ins.expr.get());
+  auto expression_result = analyze_expression(ins.expr);
   
   if(ins.var->classification == instructions::variable_classification::BUILT_IN) {
 
     // Cast the thing to the built in type
     // create a vtd for the givent hing and update the next line
 
-    auto bit = reinterpret_cast<instructions::built_in_variable*>(ins.var.get());
+    auto bit = reinterpret_cast<instructions::built_in_variable*>(ins.var);
 
     std::string msg;
     if (!can_cast_to_expected({ bit->type, bit->depth }, expression_result, msg)) {
       report_error(error::analyzer::IMPLICIT_CAST_FAIL, ins.line, 0,
                    msg, false);
     }
+    else {
+      note_cast(ins.expr, {bit->type, bit->depth});
+    }
 
   } else {
 
     LOG(FATAL) << TAG(APP_FILE_NAME) << "[" << APP_LINE
                << "]: Analyzer does not yet handle given variable type" << std::endl;
-    _num_errors++;
+    _found.errors++;
     return;
   }
 }
@@ -200,7 +349,7 @@ void analyzer::receive(instructions::expression_instruction &ins)
 
   // Assignment expressions will be validated automatically
   //
-  analyze_expression(ins.expr.get());
+  analyze_expression(ins.expr);
 }
 
 void analyzer::receive(instructions::if_instruction &ins)
@@ -208,13 +357,10 @@ void analyzer::receive(instructions::if_instruction &ins)
   LOG(DEBUG) << TAG(APP_FILE_NAME) << "[" << APP_LINE << "]: If Statement"
              << std::endl;
 
-  std::string scope = "if_instruction_";
   for (auto &seg : ins.segments) {
+    _table.add_scope_and_enter(symbol::scope_kind::IF);
 
-    std::string current_scope = scope + std::to_string(_uid++);
-    _table.add_scope_and_enter(current_scope);
-
-    analyze_expression(seg.expr.get());
+    analyze_expression(seg.expr);
     for (auto &el : seg.instruction_list) {
       el->visit(*this);
     }
@@ -228,9 +374,8 @@ void analyzer::receive(instructions::while_instruction &ins)
   LOG(DEBUG) << TAG(APP_FILE_NAME) << "[" << APP_LINE << "]: While Statement"
              << std::endl;
 
-  std::string scope = "while_instruction_" + std::to_string(_uid++);
-  _table.add_scope_and_enter(scope);
-  analyze_expression(ins.condition.get());
+  _table.add_scope_and_enter(symbol::scope_kind::WHILE);
+  analyze_expression(ins.condition);
   for (auto &el : ins.body) {
     el->visit(*this);
   }
@@ -242,11 +387,10 @@ void analyzer::receive(instructions::for_instruction &ins)
   LOG(DEBUG) << TAG(APP_FILE_NAME) << "[" << APP_LINE << "]: For Statement"
              << std::endl;
 
-  std::string scope = "for_instruction_" + std::to_string(_uid++);
-  _table.add_scope_and_enter(scope);
+  _table.add_scope_and_enter(symbol::scope_kind::FOR);
   ins.assign->visit(*this);
-  analyze_expression(ins.condition.get());
-  analyze_expression(ins.modifier.get());
+  analyze_expression(ins.condition);
+  analyze_expression(ins.modifier);
   for (auto &el : ins.body) {
     el->visit(*this);
   }
@@ -258,18 +402,21 @@ void analyzer::receive(instructions::return_instruction &ins)
   LOG(DEBUG) << TAG(APP_FILE_NAME) << "[" << APP_LINE << "]: Return Statement"
              << std::endl;
 
-  auto var_type_data = retrieve_type_depth(_current_function->return_data.get());
+  auto var_type_data = retrieve_type_depth(_current_function->return_data);
 
   //  If the return has a statement ensure it matches the return statement
   //
-  if (ins.expr.get()) {
-    auto expression_result = analyze_expression(ins.expr.get());
+  if (ins.expr) {
+    auto expression_result = analyze_expression(ins.expr);
     std::string msg;
     if (!can_cast_to_expected(var_type_data, expression_result,
                               msg)) {
       report_error(error::analyzer::IMPLICIT_CAST_FAIL, ins.line,
                    ins.col, msg, false);
     }
+    else {
+      note_cast(ins.expr, var_type_data);
+    }
   }
   else {
     if (var_type_data.type != instructions::variable_types::UNDEF) {
@@ -284,52 +431,130 @@ void analyzer::receive(instructions::return_instruction &ins)
 analyzer::vtd analyzer::retrieve_type_depth(instructions::variable *var)
 {
   vtd var_type_data;
-  if(_current_function->return_data->classification == instructions::variable_classification::BUILT_IN) {
+  if(var->classification == instructions::variable_classification::BUILT_IN) {
     auto bit = reinterpret_cast<instructions::built_in_variable*>(var);
     var_type_data = { bit->type, bit->depth };
   } else {
     LOG(FATAL) << TAG(APP_FILE_NAME) << "[" << APP_LINE
                << "]: Analyzer does not yet handle given variable type" << std::endl;
-    _num_errors++;
+    _found.errors++;
   }
   return var_type_data;
 }
 
 analyzer::vtd analyzer::analyze_expression(instructions::expression *expr)
 {
+  auto base = _expr_stack.size();
+  _expr_stack.push_back({expr, _found.errors, 0, {}});
+
+  vtd checked{instructions::variable_types::UNDEF, 0};
+  while (true) {
+    auto &frame = _expr_stack.back();
+
+    vtd result;
+    instructions::expression *operand = nullptr;
+    if (!step_expression(frame, checked, operand, result)) {
+      _expr_stack.push_back({operand, _found.errors, 0, {}});
+      continue;
+    }
+
+    if (frame.expr && _found.errors == frame.errors) {
+      frame.expr->typed = true;
+      frame.expr->resolved_type = result.type;
+      frame.expr->resolved_depth = result.depth;
+    }
+    _expr_stack.pop_back();
+
+    checked = result;
+    if (_expr_stack.size() == base) {
+      return checked;
+    }
+  }
+}
+
+void analyzer::note_cast(instructions::expression *expr, vtd expected)
+{
+  if (expr && expr->typed && expr->resolved_type != expected.type) {
+    expr->cast_to = expected.type;
+  }
+}
+
+analyzer::vtd analyzer::expression_failed()
+{
+  _found.errors++;
+  LOG(DEBUG) << TAG(APP_FILE_NAME) << "[" << APP_LINE
+             << "]: Error in current expression" << std::endl;
+  return {instructions::variable_types::U8, 0};
+}
+
+bool analyzer::step_expression(expr_frame &frame, const vtd &checked,
+                               instructions::expression *&operand, vtd &out)
+{
+  auto expr = frame.expr;
   if (!expr) {
-    _num_errors++;
+    _found.errors++;
     LOG(ERROR) << TAG(APP_FILE_NAME) << "[" << APP_LINE
                << "]: Null expression passed to analyzer" << std::endl;
-    return {instructions::variable_types::U8, 0};
+    out = {instructions::variable_types::U8, 0};
+    return true;
   }
 
   switch (expr->type) {
 
   case instructions::node_type::ROOT: {
-    _num_errors++;
+    _found.errors++;
     LOG(ERROR) << TAG(APP_FILE_NAME) << "[" << APP_LINE
                << "]: Root expression passed to analyzer" << std::endl;
-    return {instructions::variable_types::U8, 0};
+    out = {instructions::variable_types::U8, 0};
+    return true;
   }
 
   case instructions::node_type::CALL: {
-    // Call validation broken out due to size
-    auto potential_type = validate_function_call(expr);
-    if (std::nullopt != potential_type) {
+    auto call = reinterpret_cast<instructions::function_call_expr *>(expr);
+    if (frame.next == 0) {
+      if (!validate_function_call(call)) {
+        break;
+      }
+    }
+    else {
+      // Ensure that the parameter just checked is convertable
+      auto idx = frame.next - 1;
+      std::string msg;
+      auto expected = retrieve_type_depth(call->target->parameters[idx]);
+      if (!can_cast_to_expected(expected, checked, msg)) {
+        report_error(error::analyzer::PARAM_TYPE_MISMATCH, expr->line,
+                     expr->col, "Invalid parameter type(s) passed to function");
+        break;
+      }
+      note_cast(call->params[idx], expected);
+    }
 
-      return {potential_type.value().type, potential_type.value().depth};
+    if (frame.next < call->params.size()) {
+      operand = call->params[frame.next++];
+      return false;
     }
-    break;
+    out = retrieve_type_depth(call->target->return_data);
+    return true;
   }
 
   case instructions::node_type::ARRAY_IDX: {
     auto array = reinterpret_cast<instructions::array_index_expr *>(expr);
-    auto arr_type = analyze_expression(array->arr.get());
-    auto arr_idx_type = analyze_expression(array->index.get());
-    if (static_cast<uint64_t>(arr_idx_type.type) <
+    if (frame.next == 0) {
+      frame.next++;
+      operand = array->arr;
+      return false;
+    }
+    if (frame.next == 1) {
+      frame.first = checked;
+      frame.next++;
+      operand = array->index;
+      return false;
+    }
+
+    if (static_cast<uint64_t>(checked.type) <
         static_cast<uint64_t>(instructions::variable_types::FLOAT)) {
-      return arr_type;
+      out = frame.first;
+      return true;
     }
 
     // Invalid non-integer type
@@ -340,23 +565,39 @@ analyzer::vtd analyzer::analyze_expression(instructions::expression *expr)
   }
 
   case instructions::node_type::INFIX: {
-    auto potential_type = validate_infix(expr);
+    auto infix = reinterpret_cast<instructions::infix_expr *>(expr);
+    if (frame.next == 0) {
+      frame.next++;
+      operand = infix->left;
+      return false;
+    }
+    if (frame.next == 1) {
+      frame.first = checked;
+      frame.next++;
+      operand = infix->right;
+      return false;
+    }
+
+    auto potential_type = validate_infix(infix, frame.first, checked);
     if (std::nullopt != potential_type) {
-      return {potential_type.value(), 0};
+      out = {potential_type.value(), 0};
+      return true;
     }
     break;
   }
 
   case instructions::node_type::PREFIX: {
-    auto potential_type = validate_prefix(expr);
-    if (std::nullopt != potential_type) {
-      return {potential_type.value(), 0};
+    if (frame.next == 0) {
+      frame.next++;
+      operand = reinterpret_cast<instructions::prefix_expr *>(expr)->right;
+      return false;
     }
-    break;
+    out = {checked.type, 0};
+    return true;
   }
 
   case instructions::node_type::ID: {
-    auto suspected_id = _table.lookup(expr->value);
+    auto suspected_id = _table.lookup(expr->id);
 
     if (suspected_id == std::nullopt) {
       std::string message = "Unknown variable \"";
@@ -370,7 +611,9 @@ analyzer::vtd analyzer::analyze_expression(instructions::expression *expr)
     if (suspected_id->type != symbol::variant_type::ASSIGNMENT) {
 
       if (suspected_id->type == symbol::variant_type::PARAMETER) {
-        return retrieve_type_depth(suspected_id.value().parameter_variable);
+        expr->target = suspected_id.value().parameter_variable;
+        out = retrieve_type_depth(expr->target);
+        return true;
       }
 
       std::string message = "Item \"";
@@ -381,51 +624,42 @@ analyzer::vtd analyzer::analyze_expression(instructions::expression *expr)
       break;
     }
 
-    return retrieve_type_depth(suspected_id.value().assignment->var.get());
-
+    expr->target = suspected_id.value().assignment->var;
+    out = retrieve_type_depth(expr->target);
+    return true;
   }
 
   case instructions::node_type::RAW_FLOAT: {
-    return {instructions::variable_types::FLOAT, 0};
+    out = {instructions::variable_types::FLOAT, 0};
+    return true;
   }
 
   case instructions::node_type::RAW_STRING: {
-    return {instructions::variable_types::STRING, 0};
+    out = {instructions::variable_types::STRING, 0};
+    return true;
   }
 
   case instructions::node_type::RAW_NUMBER: {
-    auto determined_type = determine_integer_type(expr->value);
-    if (std::nullopt == determined_type) {
-      std::string message = "Unable to determine integer type from value \"";
-      message += expr->value;
-      message += "\"";
-      report_error(
-          error::analyzer::INTERNAL_UNABLE_TO_DETERMINE_INT_VAL,
-          expr->line, expr->col, message);
-      break;
-    }
-
-    // Tag the type and value so we don't have to parse again later
+    // Type and value were decided when the literal was lexed
     auto raw = reinterpret_cast<instructions::raw_int_expr *>(expr);
-    raw->as = std::get<0>(determined_type.value());
-    raw->with_val = std::get<1>(determined_type.value());
-    return {raw->as, 0};
+    out = {raw->as, 0};
+    return true;
   }
 
   case instructions::node_type::ARRAY: {
     auto arr = reinterpret_cast<instructions::array_literal_expr *>(expr);
-    for (auto &e : arr->expressions) {
-      analyze_expression(e.get());
+    if (frame.next < arr->expressions.size()) {
+      operand = arr->expressions[frame.next++];
+      return false;
     }
-    return {instructions::variable_types::ARRAY, arr->expressions.size()};
+    out = {instructions::variable_types::ARRAY, arr->expressions.size()};
+    return true;
   }
 
   } // Switch
 
-  _num_errors++;
-  LOG(DEBUG) << TAG(APP_FILE_NAME) << "[" << APP_LINE
-             << "]: Error in current expression" << std::endl;
-  return {instructions::variable_types::U8, 0};
+  out = expression_failed();
+  return true;
 }
 
 bool analyzer::can_cast_to_expected(analyzer::vtd expected_vtd,
@@ -481,28 +715,34 @@ bool analyzer::can_cast_to_expected(analyzer::vtd expected_vtd,
   return true;
 }
 
-std::optional<analyzer::vtd>
-analyzer::validate_function_call(instructions::expression *expr)
+bool analyzer::validate_function_call(instructions::function_call_expr *call)
 {
-  auto call = reinterpret_cast<instructions::function_call_expr *>(expr);
-  auto suspected_fn = _table.lookup(call->fn->value);
+  auto suspected_fn = _table.lookup(call->fn->id);
 
   if (suspected_fn == std::nullopt) {
-    std::string message = "Unable to locate item \"" + call->fn->value + "\"";
-    report_error(error::analyzer::UNKNOWN_ID, expr->line, expr->col,
+    std::string message = "Unable to locate item \"";
+    message += call->fn->value;
+    message += "\"";
+    report_error(error::analyzer::UNKNOWN_ID, call->line, call->col,
                  message);
-    return std::nullopt;
+    return false;
   }
 
   if (suspected_fn->type != symbol::variant_type::FUNCTION) {
-    std::string message =
-        "Call to non-function type \"" + call->fn->value + "\"";
-    report_error(error::analyzer::UNMATCHED_CALL, expr->line,
-                 expr->col, message);
-    return std::nullopt;
+    std::string message = "Call to non-function type \"";
+    message += call->fn->value;
+    message += "\"";
+    report_error(error::analyzer::UNMATCHED_CALL, call->line,
+                 call->col, message);
+    return false;
   }
 
   auto fn = suspected_fn->function;
+  call->target = fn;
+
+  if (fn->body_pending()) {
+    _found.called_pending.push_back(fn);
+  }
 
   if (fn->parameters.size() != call->params.size()) {
     std::string message = "Expected ";
@@ -514,40 +754,15 @@ analyzer::validate_function_call(instructions::expression *expr)
     message += " parameters.";
     report_error(error::analyzer::PARAM_SIZE_MISMATCH, call->line,
                  call->col, message);
-    return std::nullopt;
-  }
-
-  for (size_t i = 0; i < fn->parameters.size(); i++) {
-
-    // Validate the parameter
-    auto actual = analyze_expression(call->params[i].get());
-
-    // Ensure that the parameters are convertable
-    std::string msg;
-    if (!can_cast_to_expected(retrieve_type_depth(fn->parameters[i].get()), actual, msg)) {
-      report_error(error::analyzer::PARAM_TYPE_MISMATCH, expr->line,
-                   expr->col, "Invalid parameter type(s) passed to function");
-      return std::nullopt;
-    }
+    return false;
   }
 
-  return retrieve_type_depth(fn->return_data.get());
-}
-
-std::optional<instructions::variable_types>
-analyzer::validate_prefix(instructions::expression *expr)
-{
-  auto prefix_expr = reinterpret_cast<instructions::prefix_expr *>(expr);
-  return analyze_expression(prefix_expr->right.get()).type;
+  return true;
 }
 
 std::optional<instructions::variable_types>
-analyzer::validate_infix(instructions::expression *expr)
+analyzer::validate_infix(instructions::infix_expr *expr, vtd lhs, vtd rhs)
 {
-  auto infix_expr = reinterpret_cast<instructions::infix_expr *>(expr);
-  auto lhs = analyze_expression(infix_expr->left.get());
-  auto rhs = analyze_expression(infix_expr->right.get());
-
   /*
    *  Check if expression type needs to be modified to allow expression
    *
@@ -585,49 +800,14 @@ analyzer::validate_infix(instructions::expression *expr)
     return std::nullopt;
   }
 
+  // The narrower operand is widened to the type of the other
   if (static_cast<uint8_t>(lhs.type) > static_cast<uint8_t>(rhs.type)) {
+    note_cast(expr->right, lhs);
     return lhs.type;
   }
 
+  note_cast(expr->left, rhs);
   return rhs.type;
 }
 
-std::optional<std::tuple<instructions::variable_types, long long>>
-analyzer::determine_integer_type(const std::string &data)
-{
-  long long value = 0;
-  std::istringstream iss(data);
-  iss >> value;
-
-  if (value >= 0) {
-    if (value <= std::numeric_limits<int8_t>::max()) {
-      return {{instructions::variable_types::I8, value}};
-    }
-    else if (value <= std::numeric_limits<int16_t>::max()) {
-      return {{instructions::variable_types::I16, value}};
-    }
-    else if (value <= std::numeric_limits<int32_t>::max()) {
-      return {{instructions::variable_types::I32, value}};
-    }
-    else {
-      return {{instructions::variable_types::I64, value}};
-    }
-  }
-  else {
-    if (value <= std::numeric_limits<uint8_t>::max()) {
-      return {{instructions::variable_types::U8, value}};
-    }
-    else if (value <= std::numeric_limits<uint16_t>::max()) {
-      return {{instructions::variable_types::U16, value}};
-    }
-    else if (value <= std::numeric_limits<uint32_t>::max()) {
-      return {{instructions::variable_types::I32, value}};
-    }
-    else {
-      return {{instructions::variable_types::U64, value}};
-    }
-  }
-  return std::nullopt;
-}
-
 } // namespace compiler
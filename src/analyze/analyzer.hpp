@@ -8,27 +8,77 @@
 #include <optional>
 #include <string>
 #include <tuple>
+#include <unordered_set>
 #include <vector>
 
 namespace titan {
 
+//  Checks parsed items for semantic errors.
+//
+//  An analyzer is a session: each call to analyze() checks the items given
+//  against the globals registered by earlier calls, and keeps the globals
+//  of those items for later calls (i.e one REPL line after another). The
+//  nodes checked must outlive the analyzer. A call that finds errors drops
+//  the globals it registered again
+//
 class analyzer : private instructions::ins_receiver {
 public:
-  analyzer(std::vector<instructions::instruction_ptr> &parse_tree);
+  analyzer();
 
-  bool analyze();
+  // Number of threads function bodies are checked on
+  void set_jobs(size_t jobs) { _jobs = jobs; }
+
+  bool analyze(std::vector<instructions::instruction_ptr> &items);
 
 private:
   static constexpr uint8_t NUM_ERRORS_BEFORE_ABORT = 10;
 
+  // Checks function bodies on a worker thread against the globals of
+  // 'owner', once the owner has registered every top level item
+  explicit analyzer(analyzer &owner);
+
   symbol::table _table;
-  std::vector<instructions::instruction_ptr> &_tree;
 
   instructions::function *_current_function;
-  uint8_t _num_errors;
-  uint64_t _uid;
+  size_t _jobs;
   error::manager _err;
 
+  // An error found while checking an item, raised once everything before
+  // the item has been checked so errors come out in source order
+  struct report {
+    uint64_t error_no;
+    size_t line;
+    size_t col;
+    std::string msg;
+    bool show_col;
+    std::string file;
+    bool no_source;         // Neither a function nor a file to point at
+    uint64_t errors_before; // Errors counted in the same item before this
+  };
+
+  // A function body left for the workers, and how many globals were
+  // registered when checking items in order would have reached it
+  struct body_task {
+    instructions::function *fn;
+    size_t visible;
+  };
+
+  // What checking an item turned up
+  struct findings {
+    uint64_t errors = 0; // Including those only logged
+    std::vector<report> reports;
+    std::vector<instructions::function *> called_pending;
+    std::optional<body_task> body;
+  };
+
+  findings _found; // Of the item being checked
+  uint64_t _num_errors; // Raised so far, over every item
+
+  // Functions whose bodies the parser skipped are only checked once a call
+  // to them is seen
+  std::vector<instructions::function *> _deferred;
+  std::unordered_set<instructions::function *> _queued;
+
   struct vtd {
     instructions::variable_types type;
     uint64_t depth;
@@ -48,24 +98,53 @@ private:
   virtual void receive(instructions::for_instruction &ins) override;
   virtual void receive(instructions::return_instruction &ins) override;
 
+  void analyze_body(instructions::function &fn);
+
+  bool check(std::vector<instructions::instruction_ptr> &items);
+
+  // Raise what an item turned up, and queue the pending bodies it called
+  void merge(findings &found);
+
+  bool aborted() const { return _num_errors >= NUM_ERRORS_BEFORE_ABORT; }
+
   vtd retrieve_type_depth(instructions::variable *var);
 
+  //  An expression being checked, waiting on the type of its next operand.
+  //  Expressions are checked off this stack rather than by recursing so
+  //  that nesting is only limited by memory, as it is for the parser
+  //
+  struct expr_frame {
+    instructions::expression *expr;
+    uint64_t errors; // Found before the expression was started
+    size_t next;     // Operands checked so far
+    vtd first;       // Type of the first operand, once it is known
+  };
+  std::vector<expr_frame> _expr_stack;
+
+  // Type of 'expr', recorded on the node when it and its operands check out
   vtd analyze_expression(instructions::expression *expr);
 
+  // Take the expression on top of the stack a step further, given the type
+  // of the operand last checked. Returns true once 'out' holds its type,
+  // otherwise 'operand' is the next operand to check
+  bool step_expression(expr_frame &frame, const vtd &checked,
+                       instructions::expression *&operand, vtd &out);
+
+  // Give up on an expression that failed to check
+  vtd expression_failed();
+
+  // Record that 'expr' is implicitly converted to 'expected' where it is used
+  void note_cast(instructions::expression *expr, vtd expected);
+
   bool can_cast_to_expected(vtd expected, vtd actual,
                             std::string &out);
 
-  std::optional<vtd>
-  validate_function_call(instructions::expression *expr);
+  // Checks made once a call's function is known, before its parameters.
+  // Returns false if the call can not be checked any further
+  bool validate_function_call(instructions::function_call_expr *call);
 
   std::optional<instructions::variable_types>
-  validate_prefix(instructions::expression *expr);
-
-  std::optional<instructions::variable_types>
-  validate_infix(instructions::expression *expr);
-
-  std::optional<std::tuple<instructions::variable_types, long long>>
-  determine_integer_type(const std::string &data);
+  validate_infix(instructions::infix_expr *expr, vtd lhs, vtd rhs);
 };
 
 } // namespace compiler
@@ -0,0 +1,734 @@
+#include "constant_folder.hpp"
+#include "app.hpp"
+#include "log/log.hpp"
+
+#include <cstdint>
+#include <cstdio>
+#include <limits>
+#include <string>
+
+namespace titan {
+
+namespace {
+
+using instructions::variable_types;
+using constant = constant_folder::constant;
+
+bool is_integer(variable_types type)
+{
+  return static_cast<uint8_t>(type) <= static_cast<uint8_t>(variable_types::I64);
+}
+
+bool is_signed(variable_types type)
+{
+  return type >= variable_types::I8 && type <= variable_types::I64;
+}
+
+unsigned width(variable_types type)
+{
+  switch (type) {
+  case variable_types::U8:
+  case variable_types::I8:
+    return 8;
+  case variable_types::U16:
+  case variable_types::I16:
+    return 16;
+  case variable_types::U32:
+  case variable_types::I32:
+    return 32;
+  default:
+    return 64;
+  }
+}
+
+// Truncate to the width of 'type', then extend as a value of it would be
+uint64_t wrap(uint64_t bits, variable_types type)
+{
+  auto w = width(type);
+  if (w == 64) {
+    return bits;
+  }
+  uint64_t mask = (uint64_t(1) << w) - 1;
+  bits &= mask;
+  if (is_signed(type) && (bits >> (w - 1)) & 1) {
+    bits |= ~mask;
+  }
+  return bits;
+}
+
+constant integer(variable_types type, uint64_t bits)
+{
+  return {type, wrap(bits, type), 0};
+}
+
+constant real(double value) { return {variable_types::FLOAT, 0, value}; }
+
+constant truth_of(variable_types type, bool value)
+{
+  if (type == variable_types::FLOAT) {
+    return real(value ? 1 : 0);
+  }
+  return integer(type, value ? 1 : 0);
+}
+
+bool is_true(const constant &value)
+{
+  if (value.type == variable_types::FLOAT) {
+    return value.real != 0;
+  }
+  return value.bits != 0;
+}
+
+// Value as converted to 'type'. Conversions the runtime would have to decide
+// on (floats to integers, anything to or from strings) are not made
+std::optional<constant> convert(const constant &value, variable_types type)
+{
+  if (value.type == type) {
+    return value;
+  }
+  if (is_integer(value.type) && is_integer(type)) {
+    return integer(type, value.bits);
+  }
+  if (is_integer(value.type) && type == variable_types::FLOAT) {
+    if (is_signed(value.type)) {
+      return real(static_cast<double>(static_cast<int64_t>(value.bits)));
+    }
+    return real(static_cast<double>(value.bits));
+  }
+  return std::nullopt;
+}
+
+std::optional<constant> fold_integers(Token op, variable_types type,
+                                      uint64_t lhs, uint64_t rhs)
+{
+  bool sign = is_signed(type);
+  auto slhs = static_cast<int64_t>(lhs);
+  auto srhs = static_cast<int64_t>(rhs);
+
+  switch (op) {
+  case Token::ADD:
+    return integer(type, lhs + rhs);
+  case Token::SUB:
+    return integer(type, lhs - rhs);
+  case Token::MUL:
+    return integer(type, lhs * rhs);
+  case Token::DIV:
+  case Token::MOD: {
+    if (rhs == 0 ||
+        (sign && slhs == std::numeric_limits<int64_t>::min() && srhs == -1)) {
+      return std::nullopt;
+    }
+    if (sign) {
+      auto result = (op == Token::DIV) ? slhs / srhs : slhs % srhs;
+      return integer(type, static_cast<uint64_t>(result));
+    }
+    return integer(type, (op == Token::DIV) ? lhs / rhs : lhs % rhs);
+  }
+  case Token::POW: {
+    if (sign && srhs < 0) {
+      return std::nullopt;
+    }
+    // Wrapping at 64 bits and then at the width of the type is the same as
+    // wrapping at the width of the type after every step
+    uint64_t result = 1;
+    for (auto base = lhs, exp = rhs; exp; exp >>= 1) {
+      if (exp & 1) {
+        result *= base;
+      }
+      base *= base;
+    }
+    return integer(type, result);
+  }
+  case Token::LSH:
+  case Token::RSH: {
+    if ((sign && srhs < 0) || rhs >= width(type)) {
+      return std::nullopt;
+    }
+    if (op == Token::LSH) {
+      return integer(type, lhs << rhs);
+    }
+    if (sign && slhs < 0) {
+      return integer(type, ~(~lhs >> rhs));
+    }
+    return integer(type, lhs >> rhs);
+  }
+  case Token::AMPERSAND:
+    return integer(type, lhs & rhs);
+  case Token::PIPE:
+    return integer(type, lhs | rhs);
+  case Token::HAT:
+    return integer(type, lhs ^ rhs);
+  case Token::EQ_EQ:
+    return truth_of(type, lhs == rhs);
+  case Token::EXCLAMATION_EQ:
+    return truth_of(type, lhs != rhs);
+  case Token::LT:
+    return truth_of(type, sign ? slhs < srhs : lhs < rhs);
+  case Token::GT:
+    return truth_of(type, sign ? slhs > srhs : lhs > rhs);
+  case Token::LTE:
+    return truth_of(type, sign ? slhs <= srhs : lhs <= rhs);
+  case Token::GTE:
+    return truth_of(type, sign ? slhs >= srhs : lhs >= rhs);
+  case Token::AND:
+    return truth_of(type, lhs && rhs);
+  case Token::OR:
+    return truth_of(type, lhs || rhs);
+  default:
+    return std::nullopt;
+  }
+}
+
+std::optional<constant> fold_reals(Token op, double lhs, double rhs)
+{
+  switch (op) {
+  case Token::ADD:
+    return real(lhs + rhs);
+  case Token::SUB:
+    return real(lhs - rhs);
+  case Token::MUL:
+    return real(lhs * rhs);
+  case Token::DIV:
+    if (rhs == 0) {
+      return std::nullopt;
+    }
+    return real(lhs / rhs);
+  case Token::EQ_EQ:
+    return truth_of(variable_types::FLOAT, lhs == rhs);
+  case Token::EXCLAMATION_EQ:
+    return truth_of(variable_types::FLOAT, lhs != rhs);
+  case Token::LT:
+    return truth_of(variable_types::FLOAT, lhs < rhs);
+  case Token::GT:
+    return truth_of(variable_types::FLOAT, lhs > rhs);
+  case Token::LTE:
+    return truth_of(variable_types::FLOAT, lhs <= rhs);
+  case Token::GTE:
+    return truth_of(variable_types::FLOAT, lhs >= rhs);
+  case Token::AND:
+    return truth_of(variable_types::FLOAT, lhs != 0 && rhs != 0);
+  case Token::OR:
+    return truth_of(variable_types::FLOAT, lhs != 0 || rhs != 0);
+  default:
+    return std::nullopt;
+  }
+}
+
+bool is_assignment(Token op)
+{
+  switch (op) {
+  case Token::EQ:
+  case Token::ADD_EQ:
+  case Token::SUB_EQ:
+  case Token::MUL_EQ:
+  case Token::DIV_EQ:
+  case Token::MOD_EQ:
+  case Token::POW_EQ:
+  case Token::LSH_EQ:
+  case Token::RSH_EQ:
+  case Token::HAT_EQ:
+  case Token::PIPE_EQ:
+  case Token::TILDE_EQ:
+  case Token::AMPERSAND_EQ:
+    return true;
+  default:
+    return false;
+  }
+}
+
+//  Collects the variables a function body writes to after declaring them
+//
+class write_finder : public instructions::ins_receiver {
+public:
+  explicit write_finder(std::unordered_set<const instructions::variable *> &out)
+      : _out(out)
+  {
+  }
+
+  void find(std::vector<instructions::instruction_ptr> &list)
+  {
+    for (auto &ins : list) {
+      ins->visit(*this);
+    }
+  }
+
+  virtual void receive(instructions::import &) override {}
+  virtual void receive(instructions::function &) override {}
+  virtual void receive(instructions::define_user_struct &) override {}
+
+  virtual void receive(instructions::assignment_instruction &ins) override
+  {
+    expression(ins.expr);
+  }
+
+  virtual void receive(instructions::expression_instruction &ins) override
+  {
+    expression(ins.expr);
+  }
+
+  virtual void receive(instructions::if_instruction &ins) override
+  {
+    for (auto &seg : ins.segments) {
+      expression(seg.expr);
+      find(seg.instruction_list);
+    }
+  }
+
+  virtual void receive(instructions::while_instruction &ins) override
+  {
+    expression(ins.condition);
+    find(ins.body);
+  }
+
+  virtual void receive(instructions::for_instruction &ins) override
+  {
+    ins.assign->visit(*this);
+    expression(ins.condition);
+    expression(ins.modifier);
+    find(ins.body);
+  }
+
+  virtual void receive(instructions::return_instruction &ins) override
+  {
+    expression(ins.expr);
+  }
+
+private:
+  std::unordered_set<const instructions::variable *> &_out;
+  std::vector<instructions::expression *> _pending;
+
+  // Any order will do, so operands are simply put on a list to look at
+  void expression(instructions::expression *expr)
+  {
+    _pending.push_back(expr);
+    while (!_pending.empty()) {
+      auto next = _pending.back();
+      _pending.pop_back();
+      if (next) {
+        operands_of(next);
+      }
+    }
+  }
+
+  void operands_of(instructions::expression *expr)
+  {
+    switch (expr->type) {
+    case instructions::node_type::INFIX: {
+      auto infix = static_cast<instructions::infix_expr *>(expr);
+      if (is_assignment(infix->op)) {
+        // Writing to an element writes to the array
+        auto place = infix->left;
+        while (place && place->type == instructions::node_type::ARRAY_IDX) {
+          place = static_cast<instructions::array_index_expr *>(place)->arr;
+        }
+        if (place && place->target) {
+          _out.insert(place->target);
+        }
+      }
+      _pending.push_back(infix->left);
+      _pending.push_back(infix->right);
+      break;
+    }
+    case instructions::node_type::PREFIX:
+      _pending.push_back(static_cast<instructions::prefix_expr *>(expr)->right);
+      break;
+    case instructions::node_type::CALL: {
+      auto &params = static_cast<instructions::function_call_expr *>(expr)->params;
+      _pending.insert(_pending.end(), params.begin(), params.end());
+      break;
+    }
+    case instructions::node_type::ARRAY: {
+      auto &elements =
+          static_cast<instructions::array_literal_expr *>(expr)->expressions;
+      _pending.insert(_pending.end(), elements.begin(), elements.end());
+      break;
+    }
+    case instructions::node_type::ARRAY_IDX: {
+      auto idx = static_cast<instructions::array_index_expr *>(expr);
+      _pending.push_back(idx->arr);
+      _pending.push_back(idx->index);
+      break;
+    }
+    default:
+      break;
+    }
+  }
+};
+
+} // namespace
+
+constant_folder::constant_folder(arena &nodes)
+    : _nodes(nodes), _in_function(false), _drop(false)
+{
+}
+
+void constant_folder::fold(std::vector<instructions::instruction_ptr> &items)
+{
+  LOG(DEBUG) << TAG(APP_FILE_NAME) << "[" << APP_LINE
+             << "]: Folding constants of " << items.size() << " items"
+             << std::endl;
+
+  fold_block(items);
+
+  LOG(DEBUG) << TAG(APP_FILE_NAME) << "[" << APP_LINE << "]: Folded "
+             << _counts.folded << " expressions, propagated "
+             << _counts.propagated << " constants, pruned " << _counts.pruned
+             << " if segments" << std::endl;
+}
+
+void constant_folder::fold_block(std::vector<instructions::instruction_ptr> &list)
+{
+  size_t kept = 0;
+  for (size_t idx = 0; idx < list.size(); idx++) {
+    _drop = false;
+    list[idx]->visit(*this);
+    if (!_drop) {
+      list[kept++] = list[idx];
+    }
+  }
+  list.resize(kept);
+  _drop = false;
+}
+
+void constant_folder::receive(instructions::import &) {}
+
+void constant_folder::receive(instructions::define_user_struct &) {}
+
+void constant_folder::receive(instructions::function &ins)
+{
+  // Bodies the analyzer never checked are left as they are
+  if (ins.body_pending()) {
+    return;
+  }
+
+  //  Locals can only be seen from the body declaring them, so the body is
+  //  all there is to search for writes
+  //
+  _written.clear();
+  _known.clear();
+  write_finder(_written).find(ins.instruction_list);
+
+  _in_function = true;
+  fold_block(ins.instruction_list);
+  _in_function = false;
+
+  _known.clear();
+}
+
+void constant_folder::receive(instructions::assignment_instruction &ins)
+{
+  auto value = fold_expression(ins.expr);
+
+  // Globals are left alone, a later REPL line could still write to them
+  if (!value || !_in_function || _written.count(ins.var) ||
+      ins.var->classification !=
+          instructions::variable_classification::BUILT_IN) {
+    return;
+  }
+
+  auto var = static_cast<instructions::built_in_variable *>(ins.var);
+  if (var->depth != 0) {
+    return;
+  }
+  if (auto held = convert(*value, var->type)) {
+    _known.emplace(ins.var, *held);
+  }
+}
+
+void constant_folder::receive(instructions::expression_instruction &ins)
+{
+  fold_expression(ins.expr);
+}
+
+void constant_folder::receive(instructions::if_instruction &ins)
+{
+  //  Segments never taken are dropped, and one always taken is the last
+  //  that can be reached. The body of a segment kept keeps its own scope
+  //
+  size_t kept = 0;
+  for (size_t idx = 0; idx < ins.segments.size(); idx++) {
+    auto value = fold_expression(ins.segments[idx].expr);
+    if (value && !is_true(*value)) {
+      continue;
+    }
+
+    fold_block(ins.segments[idx].instruction_list);
+    if (kept != idx) {
+      ins.segments[kept] = std::move(ins.segments[idx]);
+    }
+    kept++;
+
+    if (value) {
+      break;
+    }
+  }
+
+  _counts.pruned += ins.segments.size() - kept;
+  ins.segments.erase(ins.segments.begin() + kept, ins.segments.end());
+
+  _drop = ins.segments.empty();
+}
+
+void constant_folder::receive(instructions::while_instruction &ins)
+{
+  fold_expression(ins.condition);
+  fold_block(ins.body);
+}
+
+void constant_folder::receive(instructions::for_instruction &ins)
+{
+  ins.assign->visit(*this);
+  fold_expression(ins.condition);
+  fold_expression(ins.modifier);
+  fold_block(ins.body);
+}
+
+void constant_folder::receive(instructions::return_instruction &ins)
+{
+  if (ins.expr) {
+    fold_expression(ins.expr);
+  }
+}
+
+std::optional<constant_folder::constant>
+constant_folder::fold_expression(instructions::expr_ptr &slot)
+{
+  auto base = _stack.size();
+  _stack.push_back({&slot, 0, std::nullopt});
+
+  std::optional<constant> folded;
+  while (true) {
+    auto &frame = _stack.back();
+
+    std::optional<constant> result;
+    instructions::expr_ptr *operand = nullptr;
+    if (!step_expression(frame, folded, operand, result)) {
+      _stack.push_back({operand, 0, std::nullopt});
+      continue;
+    }
+    _stack.pop_back();
+
+    folded = result;
+    if (_stack.size() == base) {
+      return folded;
+    }
+  }
+}
+
+bool constant_folder::step_expression(fold_frame &frame,
+                                      const std::optional<constant> &folded,
+                                      instructions::expr_ptr *&operand,
+                                      std::optional<constant> &out)
+{
+  auto &slot = *frame.slot;
+  auto expr = slot;
+  if (!expr) {
+    return true;
+  }
+
+  switch (expr->type) {
+
+  case instructions::node_type::RAW_NUMBER: {
+    auto raw = static_cast<instructions::raw_int_expr *>(expr);
+    if (raw->typed && is_integer(raw->resolved_type)) {
+      out = integer(raw->resolved_type, raw->with_val);
+    }
+    return true;
+  }
+
+  case instructions::node_type::RAW_FLOAT: {
+    auto raw = static_cast<instructions::raw_float_expr *>(expr);
+    if (raw->typed) {
+      out = real(raw->with_val);
+    }
+    return true;
+  }
+
+  case instructions::node_type::ID: {
+    auto it = _known.find(expr->target);
+    if (!expr->typed || it == _known.end() ||
+        it->second.type != expr->resolved_type) {
+      return true;
+    }
+    out = it->second;
+    replace(slot, *out);
+    _counts.propagated++;
+    return true;
+  }
+
+  case instructions::node_type::INFIX: {
+    auto infix = static_cast<instructions::infix_expr *>(expr);
+
+    // The place written to is never replaced, only what indexes into it
+    if (is_assignment(infix->op)) {
+      if (frame.next == 0) {
+        frame.next = 1;
+        if (infix->left &&
+            infix->left->type == instructions::node_type::ARRAY_IDX) {
+          operand = &infix->left;
+          return false;
+        }
+      }
+      if (frame.next == 1) {
+        frame.next = 2;
+        operand = &infix->right;
+        return false;
+      }
+      return true;
+    }
+
+    if (frame.next == 0) {
+      frame.next = 1;
+      operand = &infix->left;
+      return false;
+    }
+    if (frame.next == 1) {
+      frame.first = folded;
+      frame.next = 2;
+      operand = &infix->right;
+      return false;
+    }
+
+    out = fold_infix(*infix, frame.first, folded);
+    if (out) {
+      replace(slot, *out);
+      _counts.folded++;
+    }
+    return true;
+  }
+
+  case instructions::node_type::PREFIX: {
+    auto prefix = static_cast<instructions::prefix_expr *>(expr);
+    if (frame.next == 0) {
+      frame.next = 1;
+      operand = &prefix->right;
+      return false;
+    }
+
+    out = fold_prefix(*prefix, folded);
+    if (out) {
+      replace(slot, *out);
+      _counts.folded++;
+    }
+    return true;
+  }
+
+  case instructions::node_type::CALL: {
+    auto &params = static_cast<instructions::function_call_expr *>(expr)->params;
+    if (frame.next < params.size()) {
+      operand = &params[frame.next++];
+      return false;
+    }
+    return true;
+  }
+
+  case instructions::node_type::ARRAY: {
+    auto &elements =
+        static_cast<instructions::array_literal_expr *>(expr)->expressions;
+    if (frame.next < elements.size()) {
+      operand = &elements[frame.next++];
+      return false;
+    }
+    return true;
+  }
+
+  case instructions::node_type::ARRAY_IDX: {
+    if (frame.next == 0) {
+      frame.next = 1;
+      operand = &static_cast<instructions::array_index_expr *>(expr)->index;
+      return false;
+    }
+    return true;
+  }
+
+  default:
+    return true;
+  }
+}
+
+std::optional<constant_folder::constant>
+constant_folder::fold_infix(instructions::infix_expr &expr,
+                            std::optional<constant> lhs,
+                            std::optional<constant> rhs)
+{
+  if (!lhs || !rhs || !expr.typed || expr.resolved_depth != 0) {
+    return std::nullopt;
+  }
+
+  // Operands are worked on as the type of the expression, the narrower one
+  // having been widened to it
+  lhs = convert(*lhs, expr.resolved_type);
+  rhs = convert(*rhs, expr.resolved_type);
+  if (!lhs || !rhs) {
+    return std::nullopt;
+  }
+
+  if (expr.resolved_type == variable_types::FLOAT) {
+    return fold_reals(expr.op, lhs->real, rhs->real);
+  }
+  return fold_integers(expr.op, expr.resolved_type, lhs->bits, rhs->bits);
+}
+
+std::optional<constant_folder::constant>
+constant_folder::fold_prefix(instructions::prefix_expr &expr,
+                             std::optional<constant> operand)
+{
+  if (!operand || !expr.typed || expr.resolved_depth != 0) {
+    return std::nullopt;
+  }
+  operand = convert(*operand, expr.resolved_type);
+  if (!operand) {
+    return std::nullopt;
+  }
+
+  auto type = expr.resolved_type;
+  if (type == variable_types::FLOAT) {
+    switch (expr.op) {
+    case Token::SUB:
+      return real(-operand->real);
+    case Token::EXCLAMATION:
+      return truth_of(type, operand->real == 0);
+    default:
+      return std::nullopt;
+    }
+  }
+
+  switch (expr.op) {
+  case Token::SUB:
+    return integer(type, 0 - operand->bits);
+  case Token::EXCLAMATION:
+    return truth_of(type, operand->bits == 0);
+  case Token::TILDE:
+    return integer(type, ~operand->bits);
+  default:
+    return std::nullopt;
+  }
+}
+
+void constant_folder::replace(instructions::expr_ptr &slot,
+                              const constant &value)
+{
+  instructions::expr_ptr literal;
+  if (value.type == variable_types::FLOAT) {
+    char text[32];
+    std::snprintf(text, sizeof(text), "%.17g", value.real);
+    literal = _nodes.make<instructions::raw_float_expr>(
+        slot->line, slot->col, atoms::intern(text), value.real);
+  }
+  else {
+    auto text = is_signed(value.type)
+                    ? std::to_string(static_cast<int64_t>(value.bits))
+                    : std::to_string(value.bits);
+    literal = _nodes.make<instructions::raw_int_expr>(
+        slot->line, slot->col, text, value.type, value.bits);
+  }
+
+  // The literal is used as what it replaces was
+  literal->typed = true;
+  literal->resolved_type = value.type;
+  literal->resolved_depth = 0;
+  literal->cast_to = slot->cast_to;
+  slot = literal;
+}
+
+} // namespace titan
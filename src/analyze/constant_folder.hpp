@@ -0,0 +1,110 @@
+#ifndef TITAN_CONSTANT_FOLDER_HPP
+#define TITAN_CONSTANT_FOLDER_HPP
+
+#include "lang/arena.hpp"
+#include "lang/instructions.hpp"
+
+#include <cstddef>
+#include <cstdint>
+#include <optional>
+#include <unordered_map>
+#include <unordered_set>
+#include <vector>
+
+namespace titan {
+
+//  Evaluates what it can of items that have been analyzed, before they are
+//  run.
+//
+//  Infix and prefix expressions whose operands are constant are replaced by
+//  a literal of their value. Integer results wrap to the width of the type
+//  the analyzer resolved for the expression, as they would at runtime;
+//  anything that would fault (a division by zero, a shift past the width)
+//  is left to be evaluated then. A 'let' in a function body that is never
+//  written to again has its constant value put in place of each use, and
+//  if segments whose condition is constant are dropped when never taken, or
+//  end the statement when always taken.
+//
+//  Only nodes the analyzer typed are folded. Replacements are made in
+//  'nodes', which must be the arena the items live in
+//
+class constant_folder : private instructions::ins_receiver {
+public:
+  struct counts {
+    size_t folded = 0;     // Infix and prefix expressions replaced
+    size_t propagated = 0; // Uses of a 'let' replaced by its value
+    size_t pruned = 0;     // If segments dropped
+  };
+
+  // A value as held by a variable of 'type'. Integers are kept sign or zero
+  // extended from the width of the type
+  struct constant {
+    instructions::variable_types type;
+    uint64_t bits;
+    double real;
+  };
+
+  explicit constant_folder(arena &nodes);
+
+  void fold(std::vector<instructions::instruction_ptr> &items);
+
+  // Totals over every call to fold()
+  const counts &totals() const { return _counts; }
+
+private:
+  arena &_nodes;
+  counts _counts;
+  bool _in_function;
+  bool _drop; // Set when the instruction just visited is to be removed
+
+  // Of the function being folded
+  std::unordered_set<const instructions::variable *> _written;
+  std::unordered_map<const instructions::variable *, constant> _known;
+
+  virtual void receive(instructions::import &ins) override;
+  virtual void receive(instructions::function &ins) override;
+  virtual void receive(instructions::define_user_struct &ins) override;
+  virtual void receive(instructions::assignment_instruction &ins) override;
+  virtual void receive(instructions::expression_instruction &ins) override;
+  virtual void receive(instructions::if_instruction &ins) override;
+  virtual void receive(instructions::while_instruction &ins) override;
+  virtual void receive(instructions::for_instruction &ins) override;
+  virtual void receive(instructions::return_instruction &ins) override;
+
+  void fold_block(std::vector<instructions::instruction_ptr> &list);
+
+  //  An expression being folded, waiting on the value of its next operand.
+  //  Kept on a stack of its own rather than recursing, as in the analyzer,
+  //  so that nesting is only limited by memory
+  //
+  struct fold_frame {
+    instructions::expr_ptr *slot;  // Where the expression is referred from
+    size_t next;                   // Operands folded so far
+    std::optional<constant> first; // Value of the first operand, if constant
+  };
+  std::vector<fold_frame> _stack;
+
+  // Fold what can be folded within 'slot', replacing it if it is constant.
+  // Returns the value when it is
+  std::optional<constant> fold_expression(instructions::expr_ptr &slot);
+
+  // Take the expression on top of the stack a step further, given the value
+  // of the operand last folded. Returns true once 'out' holds its value (if
+  // it has one), otherwise 'operand' refers to the next operand to fold
+  bool step_expression(fold_frame &frame,
+                       const std::optional<constant> &folded,
+                       instructions::expr_ptr *&operand,
+                       std::optional<constant> &out);
+
+  std::optional<constant> fold_infix(instructions::infix_expr &expr,
+                                     std::optional<constant> lhs,
+                                     std::optional<constant> rhs);
+  std::optional<constant> fold_prefix(instructions::prefix_expr &expr,
+                                      std::optional<constant> operand);
+
+  void replace(instructions::expr_ptr &slot, const constant &value);
+};
+
+} // namespace titan
+
+#endif
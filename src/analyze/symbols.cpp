@@ -1,152 +1,226 @@
 #include "symbols.hpp"
 
-#include <algorithm>
-
 namespace titan {
 
 namespace symbol {
 
-table::table() : _global_scope("global"), _curr_scope(&_global_scope) {}
+table::table()
+    : _depth(0), _next_id(1), _global_count(0), _globals(nullptr), _visible(0)
+{
+  _scopes.push_back({0, scope_kind::GLOBAL, empty_atom, {}});
+}
 
-void table::set_scope_to_global() { _curr_scope = &_global_scope; }
+table::table(const table *globals) : table()
+{
+  _globals = globals;
+  _visible = globals->global_count();
+}
 
-bool table::activate_top_level_scope(const std::string &name)
+void table::set_scope_to_global()
 {
-  auto locate = [&](const auto &item) { return item->name == name; };
-  auto iter = std::find_if(_global_scope.sub_scopes.begin(),
-                           _global_scope.sub_scopes.end(), locate);
+  while (_depth > 0) {
+    pop_scope();
+  }
+}
 
-  if (iter == _global_scope.sub_scopes.end()) {
+bool table::activate_top_level_scope(atom name)
+{
+  auto iter = _top_level.find(name);
+  if (iter == _top_level.end()) {
     return false;
   }
 
-  auto tmp = _curr_scope;
-  _curr_scope = *iter;
-  _curr_scope->prev_scope = tmp;
+  enter(scope_kind::FUNCTION, name);
+  for (auto &entry : iter->second) {
+    add(entry.name, entry.data);
+  }
   return true;
 }
 
-void table::add_scope(const std::string &name)
+void table::rollback_globals(size_t count)
+{
+  set_scope_to_global();
+
+  auto &names = _scopes[0].names;
+  while (names.size() > count) {
+    auto name = names.back();
+    names.pop_back();
+
+    auto iter = _symbols.find(name);
+    iter->second.pop_back();
+    if (iter->second.empty()) {
+      _symbols.erase(iter);
+    }
+    _top_level.erase(name);
+  }
+  _global_count = names.size();
+}
+
+void table::add_scope(atom name)
 {
-  _curr_scope->sub_scopes.push_back(new scope(name));
+  // Nothing is activated again in a linked table
+  if (_depth == 0 && !_globals) {
+    _top_level.emplace(name, std::vector<table_entry>{});
+  }
+}
+
+scope_id table::add_scope_and_enter(scope_kind kind, atom name)
+{
+  if (kind == scope_kind::FUNCTION) {
+    add_scope(name);
+  }
+  enter(kind, name);
+  return current_scope();
 }
 
-void table::add_scope_and_enter(const std::string &name)
+void table::enter(scope_kind kind, atom name)
 {
-  auto new_scope = new scope(name);
-  _curr_scope->sub_scopes.push_back(new_scope);
+  _depth++;
+  if (_depth == _scopes.size()) {
+    _scopes.push_back({});
+  }
 
-  auto tmp = _curr_scope;
-  _curr_scope = new_scope;
-  _curr_scope->prev_scope = tmp;
+  auto &entered = _scopes[_depth];
+  entered.id = _next_id++;
+  entered.kind = kind;
+  entered.name = name;
+  entered.names.clear();
 }
 
 void table::pop_scope()
 {
-  if (!_curr_scope->prev_scope) {
-    _curr_scope = &_global_scope;
+  if (_depth == 0) {
     return;
   }
 
-  _curr_scope = _curr_scope->prev_scope;
+  auto &current = _scopes[_depth];
+  bool top_level = _depth == 1 && current.kind == scope_kind::FUNCTION &&
+                   !_globals;
+
+  std::vector<table_entry> kept;
+  if (top_level) {
+    kept.reserve(current.names.size());
+  }
+  for (auto name : current.names) {
+    auto iter = _symbols.find(name);
+    if (top_level) {
+      kept.push_back({name, iter->second.back().data});
+    }
+    iter->second.pop_back();
+    if (iter->second.empty()) {
+      _symbols.erase(iter);
+    }
+  }
+
+  if (top_level) {
+    _top_level[current.name] = std::move(kept);
+  }
+  _depth--;
+}
+
+std::string table::scope_name() const
+{
+  auto &current = _scopes[_depth];
+  switch (current.kind) {
+  case scope_kind::GLOBAL:
+    return "global";
+  case scope_kind::FUNCTION:
+    return std::string(atoms::text(current.name));
+  case scope_kind::IF:
+    return "if_instruction_" + std::to_string(current.id);
+  case scope_kind::WHILE:
+    return "while_instruction_" + std::to_string(current.id);
+  case scope_kind::FOR:
+    return "for_instruction_" + std::to_string(current.id);
+  }
+  return {};
 }
 
-bool table::add_symbol(const std::string &name, instructions::function *func)
+bool table::add(atom name, const variant_data &data)
 {
-  if (exists(name, true)) {
+  auto &entries = _symbols[name];
+  if (!entries.empty() && entries.back().depth == _depth) {
     return false;
   }
 
+  entries.push_back({_depth, _global_count, data});
+  _scopes[_depth].names.push_back(name);
+  if (_depth == 0) {
+    _global_count++;
+  }
+  return true;
+}
+
+bool table::add_symbol(atom name, instructions::function *func)
+{
   variant_data v_data;
   v_data.type = variant_type::FUNCTION;
   v_data.function = func;
 
-  _curr_scope->entries.push_back({name, v_data});
+  if (!add(name, v_data)) {
+    return false;
+  }
   add_scope(name);
   return true;
 }
 
-bool table::add_symbol(const std::string &name,
-                       instructions::assignment_instruction *var)
+bool table::add_symbol(atom name, instructions::assignment_instruction *var)
 {
-  if (exists(name, true)) {
-    return false;
-  }
-
   variant_data v_data;
   v_data.type = variant_type::ASSIGNMENT;
   v_data.assignment = var;
-
-  _curr_scope->entries.push_back({name, v_data});
-  return true;
+  return add(name, v_data);
 }
 
-bool table::add_symbol(const std::string &name, instructions::variable *var)
+bool table::add_symbol(atom name, instructions::variable *var)
 {
-  if (exists(name, true)) {
-    return false;
-  }
-
   variant_data v_data;
   v_data.type = variant_type::PARAMETER;
   v_data.parameter_variable = var;
-
-  _curr_scope->entries.push_back({name, v_data});
-  return true;
+  return add(name, v_data);
 }
 
-bool table::exists(const std::string &v, bool current_only)
+const table::shadow *table::find(atom v, bool current_only)
 {
-  if (current_only) {
-    return scope_contains_item(_curr_scope, v);
-  }
-
-  scope *locator = _curr_scope;
-  while (locator) {
-    if (scope_contains_item(locator, v)) {
-      return true;
+  auto iter = _symbols.find(v);
+  if (iter == _symbols.end()) {
+    if (_globals && (!current_only || _depth == 0)) {
+      return _globals->find_global(v, _visible);
     }
-    locator = locator->prev_scope;
+    return nullptr;
   }
 
-  return false;
-}
-
-bool table::scope_contains_item(scope *s, const std::string &v)
-{
-  return s->entries.end() !=
-         std::find_if(s->entries.begin(), s->entries.end(),
-                      [&](const auto &item) { return item.name == v; });
+  auto &innermost = iter->second.back();
+  if (current_only && innermost.depth != _depth) {
+    return nullptr;
+  }
+  return &innermost;
 }
 
-std::optional<variant_data> table::lookup(const std::string &v,
-                                          bool current_only)
+const table::shadow *table::find_global(atom v, size_t visible) const
 {
-  scope *locator = _curr_scope;
-  auto locate = [&](const auto &item) { return item.name == v; };
-
-  auto iter =
-      std::find_if(locator->entries.begin(), locator->entries.end(), locate);
-
-  if (iter != locator->entries.end()) {
-    return std::optional<variant_data>((*iter).data);
+  auto iter = _symbols.find(v);
+  if (iter == _symbols.end()) {
+    return nullptr;
   }
 
-  if (current_only) {
-    return std::nullopt;
+  auto &outermost = iter->second.front();
+  if (outermost.depth != 0 || outermost.order >= visible) {
+    return nullptr;
   }
+  return &outermost;
+}
 
-  locator = locator->prev_scope;
-  while (locator) {
-    iter =
-        std::find_if(locator->entries.begin(), locator->entries.end(), locate);
+bool table::exists(atom v, bool current_only)
+{
+  return find(v, current_only) != nullptr;
+}
 
-    if (iter != locator->entries.end()) {
-      return std::optional<variant_data>((*iter).data);
-    }
-    locator = locator->prev_scope;
+std::optional<variant_data> table::lookup(atom v, bool current_only)
+{
+  if (auto entry = find(v, current_only)) {
+    return entry->data;
   }
-
   return std::nullopt;
 }
 
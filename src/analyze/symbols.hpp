@@ -6,6 +6,7 @@
 #include <optional>
 #include <string>
 #include <tuple>
+#include <unordered_map>
 #include <variant>
 #include <vector>
 
@@ -24,71 +25,132 @@ struct variant_data {
   };
 };
 
+// What opened a scope. Only used to name the scope when asked to
+enum class scope_kind { GLOBAL, FUNCTION, IF, WHILE, FOR };
+
+using scope_id = uint32_t;
+
+//  Scoped symbol table.
+//
+//  Every name maps to a stack of the entries that currently shadow one
+//  another, innermost last, so a lookup is a single hash probe whatever
+//  the depth. Each open scope records the names added within it, and
+//  leaving the scope pops exactly those. The symbols of a top level
+//  (function) scope are kept when it is left so it can be activated again
+//  later.
+//
+//  Scopes are known by number. Their records are pooled by depth and
+//  reused as scopes open and close; a name is only built when one is
+//  asked for.
+//
+//  A table can also be linked to the global scope of another, so function
+//  bodies can be checked on separate threads against one set of globals
+//  that no longer changes
+//
 class table {
 
 public:
   table();
 
+  // Table whose lookups fall back to the global scope of 'globals', which
+  // must not change while this table is in use
+  explicit table(const table *globals);
+
+  // Limit the linked globals to the first 'count' added to them
+  void set_visible_globals(size_t count) { _visible = count; }
+
+  // Number of symbols added to the global scope so far
+  size_t global_count() const { return _global_count; }
+
+  // Leave every scope and drop the global symbols added since there were
+  // 'count' of them, along with what their top level scopes kept
+  void rollback_globals(size_t count);
+
   // Set to top level scope
   void set_scope_to_global();
 
-  // Add a subscope with name, but do not enter
-  void add_scope(const std::string &name);
+  // Add a top level scope for the function 'name', but do not enter
+  void add_scope(atom name);
 
-  // Add a subscope with name, and enter
-  void add_scope_and_enter(const std::string &name);
+  // Add a subscope and enter it. 'name' is the function of a function scope
+  scope_id add_scope_and_enter(scope_kind kind, atom name = empty_atom);
 
   // Leave scope for parent scope (if no parent scope will stop at global)
   void pop_scope();
 
-  // Begin operating within a top level scope with name
-  bool activate_top_level_scope(const std::string &name);
+  // Begin operating within the top level scope of the function 'name'
+  bool activate_top_level_scope(atom name);
+
+  // Scope currently being populated
+  scope_id current_scope() const { return _scopes[_depth].id; }
+
+  // Name of the current scope for diagnostics (i.e "while_instruction_12")
+  std::string scope_name() const;
 
   // Add a function to the current scope's symbol table
-  bool add_symbol(const std::string &name, instructions::function *);
+  bool add_symbol(atom name, instructions::function *);
 
   // Add a variable to the current scope's symbol table
-  bool add_symbol(const std::string &name, instructions::assignment_instruction *);
+  bool add_symbol(atom name, instructions::assignment_instruction *);
 
   // Add a parameter variable
-  bool add_symbol(const std::string &name, instructions::variable *);
+  bool add_symbol(atom name, instructions::variable *);
 
   //  Check to see if a symbol exists within reach
   //  Marking current_only will limit search to current scope
-  bool exists(const std::string &v, bool current_only = false);
+  bool exists(atom v, bool current_only = false);
 
   //  Attempt to find a symbol
   //  Marking current_only will limit search to current scope
-  std::optional<variant_data> lookup(const std::string &v,
-                                     bool current_only = false);
+  std::optional<variant_data> lookup(atom v, bool current_only = false);
 
 private:
   // Table entry for a given scope
   struct table_entry {
-    std::string name;
+    atom name;
+    variant_data data;
+  };
+
+  // An entry along with the depth of the scope that added it and how
+  // many symbols the global scope held before it
+  struct shadow {
+    size_t depth;
+    size_t order;
     variant_data data;
   };
 
-  // Scope that contains data, and potentially contains sub scopes
-  class scope {
-  public:
-    scope(const std::string &name) : name(name), prev_scope(nullptr) {}
-    ~scope()
-    {
-      for (auto &s : sub_scopes) {
-        delete s;
-      }
-    }
-    std::string name;
-    scope *prev_scope;                // So search can happen from scope
-    std::vector<table_entry> entries; // Data in scope (usually assignments)
-    std::vector<scope *> sub_scopes;  // Inner scopes from current
+  // Open scope, and the names added within it
+  struct scope {
+    scope_id id;
+    scope_kind kind;
+    atom name;
+    std::vector<atom> names;
   };
 
-  scope _global_scope; // Program global scope (functions)
-  scope *_curr_scope;  // Scope currently being populated
+  std::unordered_map<atom, std::vector<shadow>> _symbols;
+
+  // Records of the open scopes are [0, _depth], global first. Those past
+  // _depth are kept to be reused, along with their capacity
+  std::vector<scope> _scopes;
+  size_t _depth;
+  scope_id _next_id;
+  size_t _global_count;
+
+  const table *_globals;
+  size_t _visible;
+
+  // Symbols of each top level scope as of when it was last left
+  std::unordered_map<atom, std::vector<table_entry>> _top_level;
+
+  // Entry for 'v' visible from the current scope, or nullptr
+  const shadow *find(atom v, bool current_only);
+
+  // Entry for 'v' in the global scope if it was among the first 'visible'
+  // symbols added there
+  const shadow *find_global(atom v, size_t visible) const;
 
-  bool scope_contains_item(scope *s, const std::string &v);
+  bool add(atom name, const variant_data &data);
+  void enter(scope_kind kind, atom name);
 };
 } // namespace symbol
 } // namespace compiler
@@ -0,0 +1,102 @@
+//
+//  Lexer throughput benchmark
+//
+//    lexer_bench [megabytes]
+//
+//  Reports MB/s for the raw character class scans and for lexing a whole
+//  buffer, once per scanning implementation supported by the machine
+//
+#include "lang/lexer.hpp"
+#include "lang/scan.hpp"
+
+#include <chrono>
+#include <cstdio>
+#include <cstdlib>
+#include <string>
+#include <vector>
+
+namespace {
+
+// Representative source, heavy on identifiers, numbers and strings
+const char *sample = R"(fn compute_checksum(buffer_length:u64, input_data:u8[4096]) -> u64 {
+    let accumulated_checksum:u64 = 14695981039346656037;
+    let scale_factor:float = 1099511628.211;
+    for (let index:u64 = 0; index < buffer_length; index += 1) {
+        accumulated_checksum ^= input_data[index];
+        accumulated_checksum *= 1099511628211;
+    }
+    let description:string = "checksum computed over the entire input buffer";
+    return accumulated_checksum;
+}
+
+)";
+
+std::string build_source(size_t bytes)
+{
+  std::string source;
+  source.reserve(bytes + 1024);
+  while (source.size() < bytes) {
+    source += sample;
+  }
+  return source;
+}
+
+template <class Fn> double mb_per_sec(size_t bytes, size_t rounds, Fn &&fn)
+{
+  auto start = std::chrono::steady_clock::now();
+  for (size_t i = 0; i < rounds; i++) {
+    fn();
+  }
+  std::chrono::duration<double> elapsed =
+      std::chrono::steady_clock::now() - start;
+  return (static_cast<double>(bytes) * rounds) / (1024.0 * 1024.0) /
+         elapsed.count();
+}
+
+// Walk the whole buffer alternating between classes the way the lexer
+// does, so every byte is examined by one of the scans
+size_t scan_all(std::string_view source)
+{
+  size_t pos = 0;
+  size_t runs = 0;
+  while (pos < source.size()) {
+    auto next = titan::scan::space_end(source, pos);
+    next = titan::scan::ident_end(source, next);
+    next = titan::scan::string_end(source, next);
+    pos = (next == pos) ? pos + 1 : next;
+    runs++;
+  }
+  return runs;
+}
+
+} // namespace
+
+int main(int argc, char **argv)
+{
+  size_t megabytes = (argc > 1) ? std::strtoul(argv[1], nullptr, 10) : 16;
+  auto source = build_source(megabytes * 1024 * 1024);
+
+  std::printf("%-8s %14s %14s\n", "mode", "scan MB/s", "lex MB/s");
+
+  for (auto m : {titan::scan::mode::SCALAR, titan::scan::mode::SSE2,
+                 titan::scan::mode::AVX2}) {
+    if (!titan::scan::set_mode(m)) {
+      std::printf("%-8s %14s %14s\n", titan::scan::mode_to_str(m),
+                  "unsupported", "-");
+      continue;
+    }
+
+    volatile size_t sink = 0;
+    auto scan_rate = mb_per_sec(source.size(), 10,
+                                [&]() { sink = sink + scan_all(source); });
+
+    auto lex_rate = mb_per_sec(source.size(), 3, [&]() {
+      titan::lexer l;
+      sink = sink + l.lex_buffer(source).size();
+    });
+
+    std::printf("%-8s %14.1f %14.1f\n", titan::scan::mode_to_str(m), scan_rate,
+                lex_rate);
+  }
+  return 0;
+}
@@ -0,0 +1,112 @@
+//
+//  Parser benchmark
+//
+//    parser_bench [megabytes] [max jobs]
+//
+//  Parses a generated source from an already lexed token buffer and reports
+//  the parse rate along with how many times the parser looked at a token
+//  for every token in the source. The parse is repeated with 1, 2, 4 ..
+//  jobs up to 'max jobs' (one per core by default)
+//
+#include "jobs/jobs.hpp"
+#include "lang/arena.hpp"
+#include "lang/imports.hpp"
+#include "lang/lexer.hpp"
+#include "lang/parser.hpp"
+#include "lang/token_buffer.hpp"
+#include "lang/token_stream.hpp"
+#include "log/log.hpp"
+
+#include <algorithm>
+#include <chrono>
+#include <cstdio>
+#include <cstdlib>
+#include <string>
+
+namespace {
+
+// Every kind of statement, at the top level and within functions
+const char *sample = R"(let limit:u64 = 4096;
+
+fn accumulate(count:u64, values:u32[64]) -> u64 {
+    let total:u64 = 0;
+    for (let idx:u64 = 0; idx < count; idx += 1) {
+        if (values[idx] > limit) {
+            total = total + limit;
+        } else if (values[idx] == 0) {
+            total -= 1;
+        } else {
+            total = total + values[idx] * 2;
+        }
+    }
+    while (total > limit) {
+        total = total >> 1;
+    }
+    report(total, {1, 2, 3});
+    return total;
+}
+
+)";
+
+std::string build_source(size_t bytes)
+{
+  std::string source;
+  source.reserve(bytes + 1024);
+  while (source.size() < bytes) {
+    source += sample;
+  }
+  return source;
+}
+
+} // namespace
+
+int main(int argc, char **argv)
+{
+  size_t megabytes = (argc > 1) ? std::strtoul(argv[1], nullptr, 10) : 8;
+  size_t max_jobs = (argc > 2) ? std::strtoul(argv[2], nullptr, 10)
+                               : titan::jobs::hardware_workers();
+  auto source = build_source(megabytes * 1024 * 1024);
+
+  // Keep debug logging out of the measurement
+  AixLog::Log::init<AixLog::SinkCout>(AixLog::Severity::error);
+
+  titan::token_buffer buffer;
+  titan::lexer l;
+  l.lex_buffer(source, buffer);
+
+  titan::imports no_imports(
+      [](std::string) { return titan::token_stream_ptr(); }, {});
+
+  constexpr size_t rounds = 3;
+  double serial_rate = 0;
+
+  for (size_t jobs = 1; jobs <= std::max<size_t>(max_jobs, 1); jobs *= 2) {
+    size_t visits = 0;
+    size_t items = 0;
+
+    auto start = std::chrono::steady_clock::now();
+    for (size_t i = 0; i < rounds; i++) {
+      titan::arena nodes;
+      titan::parser p(no_imports, nodes);
+      p.set_jobs(jobs);
+      titan::buffer_token_stream tokens(buffer);
+      items = p.parse("bench", tokens).size();
+      visits = p.token_visits();
+    }
+    std::chrono::duration<double> elapsed =
+        std::chrono::steady_clock::now() - start;
+
+    auto tokens_per_sec = static_cast<double>(buffer.size()) * rounds /
+                          elapsed.count();
+    if (jobs == 1) {
+      serial_rate = tokens_per_sec;
+      std::printf("%zu tokens, %zu top level items\n", buffer.size(), items);
+    }
+
+    std::printf("%2zu jobs: %.1f M tokens/s (x%.2f), %.2f visits per token\n",
+                jobs, tokens_per_sec / 1e6, tokens_per_sec / serial_rate,
+                static_cast<double>(visits) /
+                    static_cast<double>(buffer.size()));
+  }
+  return 0;
+}
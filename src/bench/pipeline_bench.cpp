@@ -0,0 +1,110 @@
+//
+//  Pipeline benchmark
+//
+//    pipeline_bench [megabytes]
+//
+//  Parses a generated source file twice: lexed up front into a token buffer
+//  and then parsed, and lexed on its own thread while it is being parsed.
+//  Reports the wall clock time of each and what the pipeline saves
+//
+#include "lang/arena.hpp"
+#include "lang/imports.hpp"
+#include "lang/parser.hpp"
+#include "lang/token_stream.hpp"
+#include "log/log.hpp"
+
+#include <chrono>
+#include <cstdio>
+#include <cstdlib>
+#include <filesystem>
+#include <fstream>
+#include <string>
+
+namespace {
+
+const char *sample = R"(let limit:u64 = 4096;
+
+fn accumulate(count:u64, values:u32[64]) -> u64 {
+    let total:u64 = 0;
+    for (let idx:u64 = 0; idx < count; idx += 1) {
+        if (values[idx] > limit) {
+            total = total + limit;
+        } else {
+            total = total + values[idx] * 2;
+        }
+    }
+    let description:string = "accumulated over every value given";
+    return total;
+}
+
+)";
+
+std::string build_source(size_t bytes)
+{
+  std::string source;
+  source.reserve(bytes + 1024);
+  while (source.size() < bytes) {
+    source += sample;
+  }
+  return source;
+}
+
+// Best of a few rounds of opening and parsing the file with 'stream_type'
+template <class stream_type>
+double best_seconds(const std::string &path, titan::imports &no_imports,
+                    size_t &items)
+{
+  constexpr size_t rounds = 3;
+  double best = 0;
+  for (size_t i = 0; i < rounds; i++) {
+    auto start = std::chrono::steady_clock::now();
+    titan::arena nodes;
+    titan::parser p(no_imports, nodes);
+    stream_type tokens;
+    if (!tokens.open(path)) {
+      std::printf("Unable to open %s\n", path.c_str());
+      std::exit(1);
+    }
+    items = p.parse("bench", tokens).size();
+    std::chrono::duration<double> elapsed =
+        std::chrono::steady_clock::now() - start;
+    if (i == 0 || elapsed.count() < best) {
+      best = elapsed.count();
+    }
+  }
+  return best;
+}
+
+} // namespace
+
+int main(int argc, char **argv)
+{
+  size_t megabytes = (argc > 1) ? std::strtoul(argv[1], nullptr, 10) : 16;
+
+  auto path = (std::filesystem::temp_directory_path() / "pipeline_bench.tl")
+                  .string();
+  {
+    auto source = build_source(megabytes * 1024 * 1024);
+    std::ofstream out(path, std::ios::binary | std::ios::trunc);
+    out << source;
+  }
+
+  // Keep debug logging out of the measurement
+  AixLog::Log::init<AixLog::SinkCout>(AixLog::Severity::error);
+
+  titan::imports no_imports(
+      [](std::string) { return titan::token_stream_ptr(); }, {});
+
+  size_t items = 0;
+  auto serial = best_seconds<titan::file_token_stream>(path, no_imports, items);
+  std::printf("%zu MB, %zu top level items\n", megabytes, items);
+  auto pipelined =
+      best_seconds<titan::pipelined_token_stream>(path, no_imports, items);
+
+  std::printf("lex then parse : %.3f s\n", serial);
+  std::printf("pipelined      : %.3f s (%.1f%% saved)\n", pipelined,
+              (serial - pipelined) * 100.0 / serial);
+
+  std::filesystem::remove(path);
+  return 0;
+}
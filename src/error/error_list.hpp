@@ -6,6 +6,7 @@ namespace error {
 namespace lexer {
   static constexpr uint16_t TARGET_NOT_FILE = 100;
   static constexpr uint16_t TARGET_CANT_OPEN = 101;
+  static constexpr uint16_t LITERAL_OUT_OF_RANGE = 102;
 } // end lexer
 
 namespace parser {
@@ -17,10 +18,11 @@ namespace parser {
   static constexpr uint16_t EXPECTED_CONDITIONAL = 302;
   static constexpr uint16_t EXPECTED_ASSIGNMENT = 303;
   static constexpr uint16_t UNEXPECTED_TOKEN = 304;
+  static constexpr uint16_t CYCLIC_IMPORT = 305;
 } // end parser
 
 namespace analyzer {
-  static constexpr uint16_t INTERNAL_UNABLE_TO_DETERMINE_INT_VAL = 1000;
+  //static constexpr uint16_t INTERNAL_UNABLE_TO_DETERMINE_INT_VAL = 1000;
   static constexpr uint16_t DUPLICATE_FUNCTION_DEF = 1100;
   static constexpr uint16_t DUPLICATE_VARIABLE_DEF = 1101;
   //static constexpr uint16_t ENTRY_NOT_FOUND = 1102;
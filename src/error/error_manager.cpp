@@ -10,6 +10,7 @@ manager::manager(std::string reporter) : _num_errors(0), _reporter(reporter) {
 
   _error_map[error::lexer::TARGET_NOT_FILE]  = "Given item is not a file";
   _error_map[error::lexer::TARGET_CANT_OPEN] = "Can not open file";
+  _error_map[error::lexer::LITERAL_OUT_OF_RANGE] = "Numeric literal out of range";
   
   _error_map[error::parser::INTERNAL_MARK_UNSET] = "Internal - Mark unset";
   _error_map[error::parser::INTERNAL_NO_FN_FOR_TOK] = "Internal - No function to handle token";
@@ -19,8 +20,8 @@ manager::manager(std::string reporter) : _num_errors(0), _reporter(reporter) {
   _error_map[error::parser::EXPECTED_CONDITIONAL] = "Expected a conditional";
   _error_map[error::parser::EXPECTED_ASSIGNMENT] = "Expeccted an assignment";
   _error_map[error::parser::UNEXPECTED_TOKEN] = "Unexpected token";
+  _error_map[error::parser::CYCLIC_IMPORT] = "Cyclic import";
 
-  _error_map[error::analyzer::INTERNAL_UNABLE_TO_DETERMINE_INT_VAL] = "Can't determine base type for int";
   _error_map[error::analyzer::DUPLICATE_FUNCTION_DEF] = "Duplicate function name";
   _error_map[error::analyzer::DUPLICATE_VARIABLE_DEF] = "Duplicate variable name";
   _error_map[error::analyzer::RETURN_EXPECTED_EXPRESSION] = "Return expects expression for non-nil function";
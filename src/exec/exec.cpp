@@ -54,6 +54,11 @@ void exec::receive(instructions::function &ins)
 {
   std::cout << "EXEC : fn" << std::endl;
 
+  // Bodies skipped by the parser are parsed the first time they are needed
+  if (!ins.load_body()) {
+    return;
+  }
+
   // New top level scope
 
   for(auto& var : ins.parameters) {
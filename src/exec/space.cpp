@@ -92,17 +92,29 @@ void space::leave_scope()
 }
 
 instructions::variable *space::get_variable(const std::string& name) 
+{
+  // Names that were never interned can not belong to any variable
+  atom id = atoms::find(name);
+  if(id == empty_atom) {
+    return nullptr;
+  }
+  return get_variable(id);
+}
+
+instructions::variable *space::get_variable(atom id)
 {
   // Check current scope
-  if(_operating_scope->members.find(name) != _operating_scope->members.end()) {
-    return _operating_scope->members.at(name).get();
+  auto iter = _operating_scope->members.find(id);
+  if(iter != _operating_scope->members.end()) {
+    return iter->second.get();
   }
 
   // Check all parents
   auto tmp = _operating_scope->parent;
   while(tmp) {
-    if(tmp->members.find(name) != tmp->members.end()) {
-      return tmp->members.at(name).get();
+    iter = tmp->members.find(id);
+    if(iter != tmp->members.end()) {
+      return iter->second.get();
     }
     tmp = tmp->parent;
   }
@@ -111,18 +123,25 @@ instructions::variable *space::get_variable(const std::string& name)
 }
 
 bool space::delete_var(const std::string& name)
+{
+  atom id = atoms::find(name);
+  if(id == empty_atom) {
+    return false;
+  }
+  return delete_var(id);
+}
+
+bool space::delete_var(atom id)
 {
   // Check current scope
-  if(_operating_scope->members.find(name) != _operating_scope->members.end()) {
-    _operating_scope->members.erase(name);
+  if(_operating_scope->members.erase(id)) {
     return true;
   }
 
   // Check all parents
   auto tmp = _operating_scope->parent;
   while(tmp) {
-    if(tmp->members.find(name) != tmp->members.end()) {
-      tmp->members.erase(name);
+    if(tmp->members.erase(id)) {
       return true;
     }
     tmp = tmp->parent;
@@ -137,7 +156,8 @@ bool space::new_var(instructions::variable *var)
     return false;
   }
 
-  _operating_scope->members[var->name] = instructions::variable_ptr(var);
+  _operating_scope->members[var->id] =
+      std::unique_ptr<instructions::variable>(var);
   return true;
 }
 
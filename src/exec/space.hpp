@@ -1,8 +1,10 @@
 #ifndef TITAN_SPACE_HPP
 #define TITAN_SPACE_HPP
 
+#include "lang/atoms.hpp"
 #include "lang/instructions.hpp"
 
+#include <memory>
 #include <unordered_map>
 #include <stack>
 
@@ -25,9 +27,11 @@ public:
 
   // Attempt to get a variable from the space
   instructions::variable *get_variable(const std::string& name);
+  instructions::variable *get_variable(atom id);
 
   // Attempt to delete a variable
   bool delete_var(const std::string& name);
+  bool delete_var(atom id);
 
   // Attempt to create a new variable
   bool new_var(instructions::variable *var);
@@ -37,7 +41,7 @@ private:
   {
     scope  *parent;
     scope *sub_scope;
-    std::unordered_map<std::string, instructions::variable_ptr> members;
+    std::unordered_map<atom, std::unique_ptr<instructions::variable>> members;
   };
 
   uint64_t _scope_depth;
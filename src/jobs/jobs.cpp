@@ -0,0 +1,42 @@
+#include "jobs.hpp"
+
+#include <algorithm>
+#include <atomic>
+#include <thread>
+#include <vector>
+
+namespace titan {
+namespace jobs {
+
+size_t hardware_workers()
+{
+  return std::max<size_t>(1, std::thread::hardware_concurrency());
+}
+
+void run(size_t tasks, size_t workers,
+         const std::function<void(size_t task, size_t worker)> &fn)
+{
+  workers = std::max<size_t>(1, std::min(workers, tasks));
+
+  std::atomic<size_t> next{0};
+  auto work = [&](size_t worker) {
+    for (auto task = next++; task < tasks; task = next++) {
+      fn(task, worker);
+    }
+  };
+
+  std::vector<std::thread> threads;
+  threads.reserve(workers - 1);
+  for (size_t worker = 1; worker < workers; worker++) {
+    threads.emplace_back(work, worker);
+  }
+
+  work(0);
+
+  for (auto &t : threads) {
+    t.join();
+  }
+}
+
+} // namespace jobs
+} // namespace titan
@@ -0,0 +1,25 @@
+#ifndef TITAN_JOBS_HPP
+#define TITAN_JOBS_HPP
+
+#include <cstddef>
+#include <functional>
+
+namespace titan {
+namespace jobs {
+
+//  Number of threads the machine can run at once (at least 1)
+extern size_t hardware_workers();
+
+//  Run fn(task, worker) for every task in [0, tasks) using up to 'workers'
+//  threads, the calling thread included. Tasks are handed out in order as
+//  threads free up. 'worker' identifies the thread running the task (the
+//  caller is 0) so per thread state can be indexed by it. Returns once
+//  every task has finished
+//
+extern void run(size_t tasks, size_t workers,
+                const std::function<void(size_t task, size_t worker)> &fn);
+
+} // namespace jobs
+} // namespace titan
+
+#endif
@@ -0,0 +1,80 @@
+#ifndef TITAN_SPSC_QUEUE_HPP
+#define TITAN_SPSC_QUEUE_HPP
+
+#include <atomic>
+#include <cstddef>
+#include <thread>
+#include <utility>
+#include <vector>
+
+namespace titan {
+namespace jobs {
+
+//  Bounded queue between exactly one producing and one consuming thread.
+//
+//  Neither side takes a lock: each owns one end of a ring of slots and
+//  publishes its progress through an atomic index. A side that finds the
+//  ring full (or empty) yields until the other catches up or the queue is
+//  closed. Either side may close the queue; the producer does so once it
+//  has nothing more to give, the consumer to let a blocked producer go
+//  when it stops reading early.
+//
+template <class T> class spsc_queue {
+public:
+  explicit spsc_queue(size_t capacity)
+      : _slots(capacity + 1), _head(0), _tail(0), _closed(false)
+  {
+  }
+
+  spsc_queue(const spsc_queue &) = delete;
+  spsc_queue &operator=(const spsc_queue &) = delete;
+
+  // Producer only. Returns false, dropping 'item', if the queue was closed
+  bool push(T item)
+  {
+    auto tail = _tail.load(std::memory_order_relaxed);
+    auto next = (tail + 1) % _slots.size();
+    while (next == _head.load(std::memory_order_acquire)) {
+      if (_closed.load(std::memory_order_acquire)) {
+        return false;
+      }
+      std::this_thread::yield();
+    }
+    if (_closed.load(std::memory_order_acquire)) {
+      return false;
+    }
+    _slots[tail] = std::move(item);
+    _tail.store(next, std::memory_order_release);
+    return true;
+  }
+
+  // Consumer only. Returns false once the queue is closed and drained
+  bool pop(T &item)
+  {
+    auto head = _head.load(std::memory_order_relaxed);
+    while (head == _tail.load(std::memory_order_acquire)) {
+      // Anything pushed before the close is still handed out
+      if (_closed.load(std::memory_order_acquire) &&
+          head == _tail.load(std::memory_order_acquire)) {
+        return false;
+      }
+      std::this_thread::yield();
+    }
+    item = std::move(_slots[head]);
+    _head.store((head + 1) % _slots.size(), std::memory_order_release);
+    return true;
+  }
+
+  void close() { _closed.store(true, std::memory_order_release); }
+
+private:
+  std::vector<T> _slots; // One always left empty to tell full from empty
+  alignas(64) std::atomic<size_t> _head;
+  alignas(64) std::atomic<size_t> _tail;
+  std::atomic<bool> _closed;
+};
+
+} // namespace jobs
+} // namespace titan
+
+#endif
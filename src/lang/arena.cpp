@@ -0,0 +1,62 @@
+#include "arena.hpp"
+
+#include <cstdint>
+
+namespace titan {
+
+arena::arena() : _offset(0), _used(0) {}
+
+arena::~arena() { release(); }
+
+void *arena::allocate(size_t size, size_t align)
+{
+  if (!_blocks.empty()) {
+    auto &current = _blocks.back();
+    auto base = reinterpret_cast<uintptr_t>(current.data.get());
+    auto start = (base + _offset + align - 1) & ~(uintptr_t(align) - 1);
+    auto end = start - base + size;
+    if (end <= current.size) {
+      _used += size;
+      _offset = end;
+      return reinterpret_cast<void *>(start);
+    }
+  }
+
+  // Blocks come from new[] so they are aligned for anything a node holds
+  add_block(size);
+  _used += size;
+  _offset = size;
+  return _blocks.back().data.get();
+}
+
+void arena::release()
+{
+  for (auto it = _cleanups.rbegin(); it != _cleanups.rend(); ++it) {
+    it->destroy(it->object);
+  }
+  _cleanups.clear();
+
+  // Keep the first block around for whatever comes next
+  if (_blocks.size() > 1) {
+    _blocks.resize(1);
+  }
+  _offset = 0;
+  _used = 0;
+}
+
+size_t arena::bytes_reserved() const
+{
+  size_t total = 0;
+  for (auto &b : _blocks) {
+    total += b.size;
+  }
+  return total;
+}
+
+void arena::add_block(size_t min_size)
+{
+  size_t size = min_size > block_size ? min_size : block_size;
+  _blocks.push_back({std::unique_ptr<std::byte[]>(new std::byte[size]), size});
+}
+
+} // namespace titan
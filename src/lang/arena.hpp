@@ -0,0 +1,77 @@
+#ifndef TITAN_ARENA_HPP
+#define TITAN_ARENA_HPP
+
+#include <cstddef>
+#include <memory>
+#include <new>
+#include <type_traits>
+#include <utility>
+#include <vector>
+
+namespace titan {
+
+//  Bump allocator that owns the nodes built for a compilation unit.
+//
+//  Objects are placed one after another in large blocks and are never freed
+//  on their own; pointers handed out by make() do not own anything. The
+//  whole lot is dropped at once by release() (or when the arena goes away),
+//  which runs the destructors of objects that have one and rewinds to the
+//  first block. Objects that are trivially destructible cost nothing to
+//  release.
+//
+class arena {
+public:
+  static constexpr size_t block_size = 64 * 1024;
+
+  arena();
+  ~arena();
+
+  arena(const arena &) = delete;
+  arena &operator=(const arena &) = delete;
+
+  // Construct a T within the arena
+  template <class T, class... Args> T *make(Args &&...args)
+  {
+    T *object = new (allocate(sizeof(T), alignof(T)))
+        T(std::forward<Args>(args)...);
+    if constexpr (!std::is_trivially_destructible_v<T>) {
+      _cleanups.push_back(
+          {object, [](void *p) { static_cast<T *>(p)->~T(); }});
+    }
+    return object;
+  }
+
+  // Raw, uninitialized memory that lives as long as the arena's contents
+  void *allocate(size_t size, size_t align);
+
+  // Destroy everything made so far. Pointers from before are left dangling
+  void release();
+
+  // Bytes handed out since the last release
+  size_t bytes_used() const { return _used; }
+
+  // Bytes held in blocks
+  size_t bytes_reserved() const;
+
+private:
+  struct block {
+    std::unique_ptr<std::byte[]> data;
+    size_t size;
+  };
+
+  struct cleanup {
+    void *object;
+    void (*destroy)(void *);
+  };
+
+  std::vector<block> _blocks;
+  std::vector<cleanup> _cleanups;
+  size_t _offset; // Next free byte in the last block
+  size_t _used;
+
+  void add_block(size_t min_size);
+};
+
+} // namespace titan
+
+#endif
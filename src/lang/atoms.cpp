@@ -0,0 +1,128 @@
+#include "atoms.hpp"
+
+#include <cstring>
+#include <memory>
+#include <mutex>
+#include <shared_mutex>
+#include <unordered_map>
+#include <vector>
+
+namespace titan {
+namespace atoms {
+
+namespace {
+
+//  Text is copied into large fixed blocks that are never moved or freed so
+//  views handed out by the table stay valid for the life of the process
+//
+class atom_table {
+public:
+  static constexpr size_t block_size = 64 * 1024;
+
+  atom_table() : _block_used(block_size)
+  {
+    _texts.emplace_back();
+    _lookup[_texts.back()] = empty_atom;
+  }
+
+  atom intern(std::string_view text)
+  {
+    {
+      std::shared_lock<std::shared_mutex> lock(_mutex);
+      auto iter = _lookup.find(text);
+      if (iter != _lookup.end()) {
+        return iter->second;
+      }
+    }
+
+    std::unique_lock<std::shared_mutex> lock(_mutex);
+
+    // Another thread may have interned it between the locks
+    auto iter = _lookup.find(text);
+    if (iter != _lookup.end()) {
+      return iter->second;
+    }
+
+    auto stored = store(text);
+    atom id = static_cast<atom>(_texts.size());
+    _texts.push_back(stored);
+    _lookup[stored] = id;
+    return id;
+  }
+
+  atom find(std::string_view text)
+  {
+    std::shared_lock<std::shared_mutex> lock(_mutex);
+    auto iter = _lookup.find(text);
+    if (iter == _lookup.end()) {
+      return empty_atom;
+    }
+    return iter->second;
+  }
+
+  std::string_view text(atom a)
+  {
+    std::shared_lock<std::shared_mutex> lock(_mutex);
+    if (a >= _texts.size()) {
+      return {};
+    }
+    return _texts[a];
+  }
+
+  size_t count()
+  {
+    std::shared_lock<std::shared_mutex> lock(_mutex);
+    return _texts.size();
+  }
+
+private:
+  std::shared_mutex _mutex;
+  std::vector<std::unique_ptr<char[]>> _blocks;
+  std::vector<std::unique_ptr<char[]>> _large;
+  size_t _block_used;
+  std::vector<std::string_view> _texts;
+  std::unordered_map<std::string_view, atom> _lookup;
+
+  std::string_view store(std::string_view text)
+  {
+    if (text.empty()) {
+      return {};
+    }
+
+    // Oversized text gets a block of its own
+    if (text.size() > block_size / 4) {
+      _large.emplace_back(new char[text.size()]);
+      std::memcpy(_large.back().get(), text.data(), text.size());
+      return {_large.back().get(), text.size()};
+    }
+
+    if (_block_used + text.size() > block_size) {
+      _blocks.emplace_back(new char[block_size]);
+      _block_used = 0;
+    }
+
+    char *dest = _blocks.back().get() + _block_used;
+    std::memcpy(dest, text.data(), text.size());
+    _block_used += text.size();
+    return {dest, text.size()};
+  }
+};
+
+atom_table &table()
+{
+  static atom_table instance;
+  return instance;
+}
+
+} // namespace
+
+atom intern(std::string_view text) { return table().intern(text); }
+
+atom find(std::string_view text) { return table().find(text); }
+
+std::string_view text(atom a) { return table().text(a); }
+
+size_t count() { return table().count(); }
+
+} // namespace atoms
+} // namespace titan
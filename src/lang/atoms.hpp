@@ -0,0 +1,38 @@
+#ifndef TITAN_ATOMS_HPP
+#define TITAN_ATOMS_HPP
+
+#include <cstdint>
+#include <string_view>
+
+namespace titan {
+
+//  A small integer standing in for an interned piece of source text
+//  (identifiers, literals). Two atoms are equal iff their text is equal,
+//  so atoms can be compared and hashed in place of strings.
+//
+using atom = uint32_t;
+
+//  Atom of the empty string, also used as "no atom"
+static constexpr atom empty_atom = 0;
+
+namespace atoms {
+
+//  Intern the given text in the process-wide table and return its atom.
+//  Safe to call from multiple threads
+extern atom intern(std::string_view text);
+
+//  Find the atom for the given text without interning it.
+//  Returns empty_atom if the text has never been interned
+extern atom find(std::string_view text);
+
+//  Retrieve the text of an atom. The view remains valid for the
+//  lifetime of the process
+extern std::string_view text(atom a);
+
+//  Number of atoms currently interned
+extern size_t count();
+
+} // namespace atoms
+} // namespace titan
+
+#endif
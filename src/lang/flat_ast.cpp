@@ -0,0 +1,790 @@
+#include "flat_ast.hpp"
+
+#include <cstring>
+#include <unordered_map>
+
+namespace titan {
+
+namespace {
+
+using kind = flat_ast::kind;
+
+bool is_expression(kind k) { return k <= kind::ARRAY_IDX; }
+
+bool is_instruction(kind k)
+{
+  return k >= kind::ASSIGN && k != kind::IF_SEGMENT;
+}
+
+template <class T> void append(std::string &out, const T *items, size_t count)
+{
+  out.append(reinterpret_cast<const char *>(items), count * sizeof(T));
+}
+
+template <class T>
+bool take(std::string_view bytes, size_t &pos, std::vector<T> &items,
+          size_t count)
+{
+  if ((bytes.size() - pos) / sizeof(T) < count) {
+    return false;
+  }
+  items.resize(count);
+  if (count != 0) {
+    std::memcpy(items.data(), bytes.data() + pos, count * sizeof(T));
+  }
+  pos += count * sizeof(T);
+  return true;
+}
+
+// Operands of an expression, in the order they are flattened
+size_t operand_count(const instructions::expression &expr)
+{
+  switch (expr.type) {
+  case instructions::node_type::PREFIX:
+    return 1;
+  case instructions::node_type::INFIX:
+  case instructions::node_type::ARRAY_IDX:
+    return 2;
+  case instructions::node_type::ARRAY:
+    return static_cast<const instructions::array_literal_expr &>(expr)
+        .expressions.size();
+  case instructions::node_type::CALL:
+    return 1 + static_cast<const instructions::function_call_expr &>(expr)
+                   .params.size();
+  default:
+    return 0;
+  }
+}
+
+instructions::expression *operand(const instructions::expression &expr,
+                                  size_t n)
+{
+  switch (expr.type) {
+  case instructions::node_type::PREFIX:
+    return static_cast<const instructions::prefix_expr &>(expr).right;
+  case instructions::node_type::INFIX: {
+    auto &infix = static_cast<const instructions::infix_expr &>(expr);
+    return (n == 0) ? infix.left : infix.right;
+  }
+  case instructions::node_type::ARRAY_IDX: {
+    auto &idx = static_cast<const instructions::array_index_expr &>(expr);
+    return (n == 0) ? idx.arr : idx.index;
+  }
+  case instructions::node_type::ARRAY:
+    return static_cast<const instructions::array_literal_expr &>(expr)
+        .expressions[n];
+  case instructions::node_type::CALL: {
+    auto &call = static_cast<const instructions::function_call_expr &>(expr);
+    return (n == 0) ? call.fn : call.params[n - 1];
+  }
+  default:
+    return nullptr;
+  }
+}
+
+} // namespace
+
+//  Walks the instruction tree and appends each node after its children
+//
+class flat_ast::builder : private instructions::ins_receiver {
+public:
+  builder(flat_ast &ast) : _ast(ast), _last(none) {}
+
+  uint32_t add(instructions::instruction *ins)
+  {
+    _last = none;
+    if (ins) {
+      ins->visit(*this);
+    }
+    return _last;
+  }
+
+  uint32_t add(instructions::expression *expr);
+
+  uint32_t add(instructions::variable *var);
+
+  template <class T> uint32_t add_list(const std::vector<T> &items)
+  {
+    std::vector<uint32_t> indices;
+    indices.reserve(items.size());
+    for (auto &item : items) {
+      if (auto idx = add(item); idx != none) {
+        indices.push_back(idx);
+      }
+    }
+    return push_list(indices);
+  }
+
+private:
+  flat_ast &_ast;
+  uint32_t _last;
+
+  //  Expressions waiting on their operands. Walked off a stack rather than
+  //  by recursing, as the analyzer does, so nesting is only limited by
+  //  memory. Each operand added leaves its index on '_operands' for the
+  //  expression it belongs to
+  //
+  struct frame {
+    instructions::expression *expr;
+    size_t next; // Operands added so far
+  };
+  std::vector<frame> _frames;
+  std::vector<uint32_t> _operands;
+
+  // Push 'expr' once its 'count' operands, on top of '_operands', are added
+  uint32_t push_expression(instructions::expression *expr, size_t count);
+
+  uint32_t push(kind type, size_t line, size_t col, uint32_t lhs,
+                uint32_t rhs = none, Token op = Token::EOS)
+  {
+    _ast._nodes.push_back({type, op, static_cast<uint32_t>(line),
+                           static_cast<uint32_t>(col), lhs, rhs});
+    return static_cast<uint32_t>(_ast._nodes.size() - 1);
+  }
+
+  uint32_t push_list(const std::vector<uint32_t> &items)
+  {
+    auto index = static_cast<uint32_t>(_ast._extra.size());
+    _ast._extra.push_back(static_cast<uint32_t>(items.size()));
+    _ast._extra.insert(_ast._extra.end(), items.begin(), items.end());
+    return index;
+  }
+
+  uint32_t push_literal(instructions::variable_types as, uint64_t integer)
+  {
+    literal lit;
+    lit.as = as;
+    lit.integer = integer;
+    _ast._literals.push_back(lit);
+    return static_cast<uint32_t>(_ast._literals.size() - 1);
+  }
+
+  uint32_t push_literal(double real)
+  {
+    literal lit;
+    lit.as = instructions::variable_types::FLOAT;
+    lit.real = real;
+    _ast._literals.push_back(lit);
+    return static_cast<uint32_t>(_ast._literals.size() - 1);
+  }
+
+  virtual void receive(instructions::define_user_struct &) override {}
+  virtual void receive(instructions::assignment_instruction &ins) override;
+  virtual void receive(instructions::expression_instruction &ins) override;
+  virtual void receive(instructions::if_instruction &ins) override;
+  virtual void receive(instructions::while_instruction &ins) override;
+  virtual void receive(instructions::for_instruction &ins) override;
+  virtual void receive(instructions::return_instruction &ins) override;
+  virtual void receive(instructions::import &ins) override;
+  virtual void receive(instructions::function &ins) override;
+};
+
+uint32_t flat_ast::builder::add(instructions::expression *expr)
+{
+  auto base = _frames.size();
+  _frames.push_back({expr, 0});
+
+  while (true) {
+    auto &top = _frames.back();
+    auto count = top.expr ? operand_count(*top.expr) : 0;
+    if (top.next < count) {
+      _frames.push_back({operand(*top.expr, top.next++), 0});
+      continue;
+    }
+
+    auto done = top.expr;
+    _frames.pop_back();
+    auto index = push_expression(done, count);
+    if (_frames.size() == base) {
+      return index;
+    }
+    _operands.push_back(index);
+  }
+}
+
+uint32_t flat_ast::builder::push_expression(instructions::expression *expr,
+                                            size_t count)
+{
+  std::vector<uint32_t> added(_operands.end() - count, _operands.end());
+  _operands.resize(_operands.size() - count);
+
+  // Lists leave out what has no node, as add_list() does
+  auto list_of = [&](size_t first) {
+    std::vector<uint32_t> indices;
+    indices.reserve(added.size() - first);
+    for (auto i = first; i < added.size(); i++) {
+      if (added[i] != none) {
+        indices.push_back(added[i]);
+      }
+    }
+    return push_list(indices);
+  };
+
+  if (!expr) {
+    return none;
+  }
+
+  switch (expr->type) {
+  case instructions::node_type::ID:
+    return push(kind::ID, expr->line, expr->col, expr->id);
+
+  case instructions::node_type::RAW_STRING:
+    return push(kind::RAW_STRING, expr->line, expr->col, expr->id);
+
+  case instructions::node_type::RAW_NUMBER: {
+    auto n = static_cast<instructions::raw_int_expr *>(expr);
+    return push(kind::RAW_NUMBER, n->line, n->col,
+                push_literal(n->as, n->with_val), n->id);
+  }
+
+  case instructions::node_type::RAW_FLOAT: {
+    auto n = static_cast<instructions::raw_float_expr *>(expr);
+    return push(kind::RAW_FLOAT, n->line, n->col, push_literal(n->with_val),
+                n->id);
+  }
+
+  case instructions::node_type::PREFIX: {
+    auto n = static_cast<instructions::prefix_expr *>(expr);
+    return push(kind::PREFIX, n->line, n->col, added[0], none, n->op);
+  }
+
+  case instructions::node_type::INFIX: {
+    auto n = static_cast<instructions::infix_expr *>(expr);
+    return push(kind::INFIX, n->line, n->col, added[0], added[1], n->op);
+  }
+
+  case instructions::node_type::ARRAY:
+    return push(kind::ARRAY, expr->line, expr->col, list_of(0));
+
+  case instructions::node_type::ARRAY_IDX:
+    return push(kind::ARRAY_IDX, expr->line, expr->col, added[0], added[1]);
+
+  case instructions::node_type::CALL: {
+    auto params = list_of(1);
+    return push(kind::CALL, expr->line, expr->col, added[0], params);
+  }
+
+  default:
+    return none;
+  }
+}
+
+uint32_t flat_ast::builder::add(instructions::variable *var)
+{
+  if (!var) {
+    return none;
+  }
+
+  variable flat{var->id, instructions::variable_types::UNDEF, 0,
+                static_cast<uint32_t>(_ast._segments.size()), 0};
+
+  if (var->classification == instructions::variable_classification::BUILT_IN) {
+    auto bit = static_cast<instructions::built_in_variable *>(var);
+    flat.type = bit->type;
+    flat.depth = bit->depth;
+    flat.segment_count = static_cast<uint32_t>(bit->segments.size());
+    _ast._segments.insert(_ast._segments.end(), bit->segments.begin(),
+                          bit->segments.end());
+  }
+
+  _ast._variables.push_back(flat);
+  return static_cast<uint32_t>(_ast._variables.size() - 1);
+}
+
+void flat_ast::builder::receive(instructions::assignment_instruction &ins)
+{
+  auto var = add(ins.var);
+  auto value = add(ins.expr);
+  _last = push(kind::ASSIGN, ins.line, ins.col, var, value);
+}
+
+void flat_ast::builder::receive(instructions::expression_instruction &ins)
+{
+  auto expr = add(ins.expr);
+  _last = push(kind::EXPRESSION, ins.line, ins.col, expr);
+}
+
+void flat_ast::builder::receive(instructions::if_instruction &ins)
+{
+  std::vector<uint32_t> segments;
+  segments.reserve(ins.segments.size());
+  for (auto &seg : ins.segments) {
+    auto condition = add(seg.expr);
+    auto body = add_list(seg.instruction_list);
+    segments.push_back(
+        push(kind::IF_SEGMENT, ins.line, ins.col, condition, body));
+  }
+  _last = push(kind::IF, ins.line, ins.col, push_list(segments));
+}
+
+void flat_ast::builder::receive(instructions::while_instruction &ins)
+{
+  auto condition = add(ins.condition);
+  auto body = add_list(ins.body);
+  _last = push(kind::WHILE, ins.line, ins.col, condition, body);
+}
+
+void flat_ast::builder::receive(instructions::for_instruction &ins)
+{
+  auto assign = add(ins.assign);
+  auto condition = add(ins.condition);
+  auto modifier = add(ins.modifier);
+  auto body = add_list(ins.body);
+
+  auto operands = static_cast<uint32_t>(_ast._extra.size());
+  _ast._extra.insert(_ast._extra.end(), {assign, condition, modifier});
+  _last = push(kind::FOR, ins.line, ins.col, operands, body);
+}
+
+void flat_ast::builder::receive(instructions::return_instruction &ins)
+{
+  auto expr = add(ins.expr);
+  _last = push(kind::RETURN, ins.line, ins.col, expr);
+}
+
+void flat_ast::builder::receive(instructions::import &ins)
+{
+  _last = push(kind::IMPORT, ins.line, ins.col, atoms::intern(ins.target));
+}
+
+void flat_ast::builder::receive(instructions::function &ins)
+{
+  auto return_data = add(ins.return_data);
+  auto parameters = add_list(ins.parameters);
+  auto body = add_list(ins.instruction_list);
+
+  auto operands = static_cast<uint32_t>(_ast._extra.size());
+  _ast._extra.insert(_ast._extra.end(), {ins.id, atoms::intern(ins.file_name),
+                                         return_data, parameters});
+  _last = push(kind::FUNCTION, ins.line, ins.col, operands, body);
+}
+
+//  Rebuilds instructions from the nodes front to back. Operands come before
+//  the nodes using them so each one has been built by the time it is needed
+//
+class flat_ast::expander {
+public:
+  expander(const flat_ast &ast, arena &nodes)
+      : _ast(ast), _nodes(nodes), _built(ast.size(), nullptr)
+  {
+  }
+
+  std::vector<instructions::instruction_ptr> expand()
+  {
+    for (uint32_t i = 0; i < _ast.size(); i++) {
+      _built[i] = build(_ast.at(i));
+    }
+    return instructions_of(_ast._roots);
+  }
+
+private:
+  const flat_ast &_ast;
+  arena &_nodes;
+  std::vector<void *> _built;
+
+  void *build(const node &n);
+
+  instructions::expr_ptr expr(uint32_t i) const
+  {
+    return (i == none) ? nullptr
+                       : static_cast<instructions::expr_ptr>(_built[i]);
+  }
+
+  instructions::instruction_ptr instruction(uint32_t i) const
+  {
+    return (i == none) ? nullptr
+                       : static_cast<instructions::instruction_ptr>(_built[i]);
+  }
+
+  instructions::variable_ptr variable(uint32_t i)
+  {
+    if (i == none) {
+      return nullptr;
+    }
+    auto &var = _ast.variable_at(i);
+    std::vector<uint64_t> segments(
+        _ast._segments.begin() + var.segments,
+        _ast._segments.begin() + var.segments + var.segment_count);
+    return _nodes.make<instructions::built_in_variable>(
+        var.id, var.type, var.depth, std::move(segments));
+  }
+
+  std::vector<instructions::expr_ptr> expressions_of(uint32_t list) const
+  {
+    std::vector<instructions::expr_ptr> result;
+    for (auto i : _ast.items(list)) {
+      result.push_back(expr(i));
+    }
+    return result;
+  }
+
+  std::vector<instructions::instruction_ptr>
+  instructions_of(uint32_t list) const
+  {
+    std::vector<instructions::instruction_ptr> result;
+    for (auto i : _ast.items(list)) {
+      result.push_back(instruction(i));
+    }
+    return result;
+  }
+
+  // Stored as their base pointer so expr() and instruction() can cast back
+  void *keep(instructions::expr_ptr expr) { return expr; }
+  void *keep(instructions::instruction_ptr ins) { return ins; }
+};
+
+void *flat_ast::expander::build(const node &n)
+{
+  using namespace instructions;
+
+  switch (n.type) {
+  case kind::ID:
+    return keep(_nodes.make<expression>(n.line, n.col, node_type::ID, n.lhs));
+
+  case kind::RAW_STRING:
+    return keep(
+        _nodes.make<expression>(n.line, n.col, node_type::RAW_STRING, n.lhs));
+
+  case kind::RAW_NUMBER: {
+    auto &lit = _ast.literal_at(n.lhs);
+    return keep(_nodes.make<raw_int_expr>(n.line, n.col, n.rhs, lit.as,
+                                          lit.integer));
+  }
+
+  case kind::RAW_FLOAT:
+    return keep(_nodes.make<raw_float_expr>(n.line, n.col, n.rhs,
+                                            _ast.literal_at(n.lhs).real));
+
+  case kind::PREFIX:
+    return keep(_nodes.make<prefix_expr>(n.line, n.col, n.op, expr(n.lhs)));
+
+  case kind::INFIX:
+    return keep(_nodes.make<infix_expr>(n.line, n.col, n.op, expr(n.lhs),
+                                        expr(n.rhs)));
+
+  case kind::ARRAY: {
+    auto arr = _nodes.make<array_literal_expr>(n.line, n.col);
+    arr->expressions = expressions_of(n.lhs);
+    return keep(arr);
+  }
+
+  case kind::ARRAY_IDX:
+    return keep(_nodes.make<array_index_expr>(n.line, n.col, expr(n.lhs),
+                                              expr(n.rhs)));
+
+  case kind::CALL:
+    return keep(_nodes.make<function_call_expr>(n.line, n.col, expr(n.lhs),
+                                                expressions_of(n.rhs)));
+
+  case kind::ASSIGN:
+    return keep(_nodes.make<assignment_instruction>(
+        n.line, n.col, variable(n.lhs), expr(n.rhs)));
+
+  case kind::EXPRESSION:
+    return keep(
+        _nodes.make<expression_instruction>(n.line, n.col, expr(n.lhs)));
+
+  // Built along with the IF holding it
+  case kind::IF_SEGMENT:
+    return nullptr;
+
+  case kind::IF: {
+    auto branch = _nodes.make<if_instruction>(n.line, n.col);
+    for (auto i : _ast.items(n.lhs)) {
+      auto &seg = _ast.at(i);
+      branch->segments.emplace_back(expr(seg.lhs), instructions_of(seg.rhs));
+    }
+    return keep(branch);
+  }
+
+  case kind::WHILE:
+    return keep(_nodes.make<while_instruction>(n.line, n.col, expr(n.lhs),
+                                               instructions_of(n.rhs)));
+
+  case kind::FOR:
+    return keep(_nodes.make<for_instruction>(
+        n.line, n.col, instruction(_ast.extra(n.lhs, 0)),
+        expr(_ast.extra(n.lhs, 1)), expr(_ast.extra(n.lhs, 2)),
+        instructions_of(n.rhs)));
+
+  case kind::RETURN:
+    return keep(_nodes.make<return_instruction>(n.line, n.col, expr(n.lhs)));
+
+  case kind::IMPORT:
+    return keep(_nodes.make<import>(std::string(atoms::text(n.lhs)), n.line,
+                                    n.col));
+
+  case kind::FUNCTION: {
+    auto fn = _nodes.make<function>(n.line, n.col);
+    fn->id = _ast.extra(n.lhs, 0);
+    fn->name = atoms::text(fn->id);
+    fn->file_name = std::string(atoms::text(_ast.extra(n.lhs, 1)));
+    fn->return_data = variable(_ast.extra(n.lhs, 2));
+    for (auto i : _ast.items(_ast.extra(n.lhs, 3))) {
+      fn->parameters.push_back(variable(i));
+    }
+    fn->instruction_list = instructions_of(n.rhs);
+    return keep(fn);
+  }
+  }
+  return nullptr;
+}
+
+flat_ast::flat_ast() : _roots(0) { _extra.push_back(0); }
+
+flat_ast::flat_ast(const std::vector<instructions::instruction_ptr> &module)
+{
+  builder b(*this);
+  _roots = b.add_list(module);
+
+  _nodes.shrink_to_fit();
+  _extra.shrink_to_fit();
+  _literals.shrink_to_fit();
+  _variables.shrink_to_fit();
+  _segments.shrink_to_fit();
+}
+
+size_t flat_ast::memory_usage() const
+{
+  return _nodes.capacity() * sizeof(node) +
+         _extra.capacity() * sizeof(uint32_t) +
+         _literals.capacity() * sizeof(literal) +
+         _variables.capacity() * sizeof(variable) +
+         _segments.capacity() * sizeof(uint64_t);
+}
+
+std::vector<instructions::instruction_ptr> flat_ast::expand(arena &nodes) const
+{
+  return expander(*this, nodes).expand();
+}
+
+template <class Fn> void flat_ast::for_each_atom(Fn fn)
+{
+  for (auto &n : _nodes) {
+    switch (n.type) {
+    case kind::ID:
+    case kind::RAW_STRING:
+    case kind::IMPORT:
+      fn(n.lhs);
+      break;
+    case kind::RAW_NUMBER:
+    case kind::RAW_FLOAT:
+      fn(n.rhs);
+      break;
+    case kind::FUNCTION:
+      fn(_extra[n.lhs]);
+      fn(_extra[n.lhs + 1]);
+      break;
+    default:
+      break;
+    }
+  }
+  for (auto &var : _variables) {
+    fn(var.id);
+  }
+}
+
+void flat_ast::write(std::string &out) const
+{
+  // Atoms become indices into a table of their text
+  flat_ast local = *this;
+  std::unordered_map<atom, uint32_t> indices;
+  std::vector<std::string_view> texts;
+  local.for_each_atom([&](atom &a) {
+    auto [it, added] = indices.emplace(a, static_cast<uint32_t>(texts.size()));
+    if (added) {
+      texts.push_back(atoms::text(a));
+    }
+    a = it->second;
+  });
+
+  counts c{static_cast<uint32_t>(_nodes.size()),
+           static_cast<uint32_t>(_extra.size()),
+           static_cast<uint32_t>(_literals.size()),
+           static_cast<uint32_t>(_variables.size()),
+           static_cast<uint32_t>(_segments.size()),
+           static_cast<uint32_t>(texts.size()),
+           _roots};
+  append(out, &c, 1);
+
+  // Padding is cleared so the same tree always writes the same bytes
+  for (auto &n : local._nodes) {
+    node clean;
+    std::memset(&clean, 0, sizeof(clean));
+    clean.type = n.type;
+    clean.op = n.op;
+    clean.line = n.line;
+    clean.col = n.col;
+    clean.lhs = n.lhs;
+    clean.rhs = n.rhs;
+    append(out, &clean, 1);
+  }
+  append(out, local._extra.data(), local._extra.size());
+  for (auto &lit : local._literals) {
+    literal clean;
+    std::memset(&clean, 0, sizeof(clean));
+    clean.as = lit.as;
+    clean.integer = lit.integer;
+    append(out, &clean, 1);
+  }
+  for (auto &var : local._variables) {
+    variable clean;
+    std::memset(&clean, 0, sizeof(clean));
+    clean.id = var.id;
+    clean.type = var.type;
+    clean.depth = var.depth;
+    clean.segments = var.segments;
+    clean.segment_count = var.segment_count;
+    append(out, &clean, 1);
+  }
+  append(out, local._segments.data(), local._segments.size());
+  for (auto text : texts) {
+    auto length = static_cast<uint32_t>(text.size());
+    append(out, &length, 1);
+    out.append(text);
+  }
+}
+
+bool flat_ast::read(std::string_view bytes)
+{
+  *this = flat_ast();
+
+  std::vector<counts> c;
+  size_t pos = 0;
+  if (!take(bytes, pos, c, 1)) {
+    return false;
+  }
+
+  std::vector<uint32_t> lengths;
+  std::vector<atom> interned;
+  bool okay = take(bytes, pos, _nodes, c[0].nodes) &&
+              take(bytes, pos, _extra, c[0].extra) &&
+              take(bytes, pos, _literals, c[0].literals) &&
+              take(bytes, pos, _variables, c[0].variables) &&
+              take(bytes, pos, _segments, c[0].segments);
+  for (uint32_t i = 0; okay && i < c[0].atoms; i++) {
+    okay = take(bytes, pos, lengths, 1) &&
+           bytes.size() - pos >= lengths[0];
+    if (okay) {
+      interned.push_back(atoms::intern(bytes.substr(pos, lengths[0])));
+      pos += lengths[0];
+    }
+  }
+  _roots = c[0].roots;
+
+  okay = okay && pos == bytes.size() && well_formed();
+  if (okay) {
+    for_each_atom([&](atom &a) {
+      okay = okay && a < interned.size();
+      a = okay ? interned[a] : empty_atom;
+    });
+  }
+
+  if (!okay) {
+    *this = flat_ast();
+  }
+  return okay;
+}
+
+//  Check every operand refers to something that exists, and is of a kind
+//  expand() can use where it is found, before trusting a tree that was read
+//
+bool flat_ast::well_formed() const
+{
+  auto is_list = [&](uint32_t l, uint32_t limit, auto fits) {
+    if (l >= _extra.size() || _extra[l] > _extra.size() - l - 1) {
+      return false;
+    }
+    for (auto i : items(l)) {
+      if (i >= limit || !fits(i)) {
+        return false;
+      }
+    }
+    return true;
+  };
+  auto has_extra = [&](uint32_t index, uint32_t count) {
+    return index < _extra.size() && count <= _extra.size() - index;
+  };
+
+  for (uint32_t i = 0; i < _nodes.size(); i++) {
+    auto &n = _nodes[i];
+    auto expr = [&](uint32_t e) {
+      return e == none || (e < i && is_expression(_nodes[e].type));
+    };
+    auto ins = [&](uint32_t e) {
+      return e == none || (e < i && is_instruction(_nodes[e].type));
+    };
+    auto var = [&](uint32_t v) {
+      return v == none || v < _variables.size();
+    };
+    auto any = [](uint32_t) { return true; };
+
+    if (n.type > kind::FUNCTION || static_cast<size_t>(n.op) >= TOKEN_COUNT) {
+      return false;
+    }
+
+    bool okay = true;
+    switch (n.type) {
+    case kind::ID:
+    case kind::RAW_STRING:
+    case kind::IMPORT:
+      break;
+    case kind::RAW_NUMBER:
+    case kind::RAW_FLOAT:
+      okay = n.lhs < _literals.size();
+      break;
+    case kind::PREFIX:
+    case kind::EXPRESSION:
+    case kind::RETURN:
+      okay = expr(n.lhs);
+      break;
+    case kind::INFIX:
+    case kind::ARRAY_IDX:
+      okay = expr(n.lhs) && expr(n.rhs);
+      break;
+    case kind::ASSIGN:
+      okay = var(n.lhs) && expr(n.rhs);
+      break;
+    case kind::ARRAY:
+      okay = is_list(n.lhs, i, expr);
+      break;
+    case kind::IF:
+      okay = is_list(n.lhs, i, [&](uint32_t s) {
+        return _nodes[s].type == kind::IF_SEGMENT;
+      });
+      break;
+    case kind::CALL:
+      okay = expr(n.lhs) && is_list(n.rhs, i, expr);
+      break;
+    case kind::IF_SEGMENT:
+    case kind::WHILE:
+      okay = expr(n.lhs) && is_list(n.rhs, i, ins);
+      break;
+    case kind::FOR:
+      okay = has_extra(n.lhs, 3) && ins(extra(n.lhs, 0)) &&
+             expr(extra(n.lhs, 1)) && expr(extra(n.lhs, 2)) &&
+             is_list(n.rhs, i, ins);
+      break;
+    case kind::FUNCTION:
+      okay = has_extra(n.lhs, 4) && var(extra(n.lhs, 2)) &&
+             is_list(extra(n.lhs, 3), _variables.size(), any) &&
+             is_list(n.rhs, i, ins);
+      break;
+    }
+    if (!okay) {
+      return false;
+    }
+  }
+
+  for (auto &var : _variables) {
+    if (var.segments > _segments.size() ||
+        var.segment_count > _segments.size() - var.segments) {
+      return false;
+    }
+  }
+
+  return is_list(_roots, static_cast<uint32_t>(_nodes.size()),
+                 [&](uint32_t i) { return is_instruction(_nodes[i].type); });
+}
+
+} // namespace titan
@@ -0,0 +1,192 @@
+#ifndef TITAN_FLAT_AST_HPP
+#define TITAN_FLAT_AST_HPP
+
+#include "arena.hpp"
+#include "atoms.hpp"
+#include "instructions.hpp"
+#include "tokens.hpp"
+
+#include <cstdint>
+#include <string>
+#include <string_view>
+#include <vector>
+
+namespace titan {
+
+//  Flattened form of a parsed module.
+//
+//  Every expression and instruction becomes a fixed size node in a single
+//  array and nodes refer to each other by index. Children are always added
+//  before their parent, so walking the array front to back reaches the
+//  operands of a node before the node itself without recursion or pointer
+//  chasing. What lhs and rhs hold depends on the kind of node:
+//
+//    ID, RAW_STRING         lhs atom of the text
+//    RAW_NUMBER, RAW_FLOAT  lhs literal, rhs atom of the text
+//    PREFIX                 op, lhs operand
+//    INFIX                  op, lhs and rhs operands
+//    ARRAY                  lhs list of elements
+//    ARRAY_IDX              lhs array, rhs index
+//    CALL                   lhs function, rhs list of parameters
+//    ASSIGN                 lhs variable, rhs value
+//    EXPRESSION             lhs expression
+//    IF                     lhs list of IF_SEGMENTs
+//    IF_SEGMENT             lhs condition, rhs list of body instructions
+//    WHILE                  lhs condition, rhs body list
+//    FOR                    lhs extra {assign, condition, modifier},
+//                           rhs body list
+//    RETURN                 lhs expression
+//    IMPORT                 lhs atom of the target
+//    FUNCTION               lhs extra {name atom, file atom, return variable,
+//                           parameter list}, rhs body list
+//
+//  A function whose body was skipped by the parser and never loaded has an
+//  empty body list.
+//
+//  Lists and the extra operands of larger nodes share one array of indices.
+//  A list is stored as its length followed by its items. Missing operands
+//  are 'none'.
+//
+class flat_ast {
+public:
+  static constexpr uint32_t none = UINT32_MAX;
+
+  enum class kind : uint8_t {
+    ID,
+    CALL,
+    RAW_FLOAT,
+    RAW_NUMBER,
+    RAW_STRING,
+    PREFIX,
+    INFIX,
+    ARRAY,
+    ARRAY_IDX,
+    ASSIGN,
+    EXPRESSION,
+    IF,
+    IF_SEGMENT,
+    WHILE,
+    FOR,
+    RETURN,
+    IMPORT,
+    FUNCTION
+  };
+
+  struct node {
+    kind type;
+    Token op;
+    uint32_t line;
+    uint32_t col;
+    uint32_t lhs;
+    uint32_t rhs;
+  };
+
+  struct literal {
+    instructions::variable_types as;
+    union {
+      uint64_t integer;
+      double real;
+    };
+  };
+
+  struct variable {
+    atom id;
+    instructions::variable_types type;
+    uint64_t depth;
+    uint32_t segments; // Index of the first segment
+    uint32_t segment_count;
+  };
+
+  // View of a list of node (or variable) indices
+  class list {
+  public:
+    list(const uint32_t *items, uint32_t count) : _items(items), _count(count)
+    {
+    }
+    const uint32_t *begin() const { return _items; }
+    const uint32_t *end() const { return _items + _count; }
+    uint32_t size() const { return _count; }
+    bool empty() const { return _count == 0; }
+    uint32_t operator[](uint32_t i) const { return _items[i]; }
+
+  private:
+    const uint32_t *_items;
+    uint32_t _count;
+  };
+
+  flat_ast();
+
+  // Flatten the top level items of a module
+  explicit flat_ast(const std::vector<instructions::instruction_ptr> &module);
+
+  const std::vector<node> &nodes() const { return _nodes; }
+  const node &at(uint32_t i) const { return _nodes[i]; }
+  size_t size() const { return _nodes.size(); }
+
+  // Top level items, in source order
+  list roots() const { return items(_roots); }
+
+  // List stored at 'index' (i.e an ARRAY's lhs)
+  list items(uint32_t index) const
+  {
+    return list(&_extra[index + 1], _extra[index]);
+  }
+
+  // The n'th extra operand of a FOR or FUNCTION node
+  uint32_t extra(uint32_t index, uint32_t n) const
+  {
+    return _extra[index + n];
+  }
+
+  const literal &literal_at(uint32_t i) const { return _literals[i]; }
+  const variable &variable_at(uint32_t i) const { return _variables[i]; }
+  uint64_t segment(const variable &var, uint32_t n) const
+  {
+    return _segments[var.segments + n];
+  }
+
+  // Bytes held by the tree
+  size_t memory_usage() const;
+
+  // Build the instruction tree back up in 'nodes'. Returns the top level
+  // items
+  std::vector<instructions::instruction_ptr> expand(arena &nodes) const;
+
+  // Append the tree to 'out' in a form another process can read. Atoms
+  // are written out as their text
+  void write(std::string &out) const;
+
+  // Replace the tree with one written by write(), interning its atoms.
+  // Returns false, leaving the tree empty, if 'bytes' does not hold one
+  bool read(std::string_view bytes);
+
+private:
+  class builder;
+  class expander;
+
+  struct counts {
+    uint32_t nodes;
+    uint32_t extra;
+    uint32_t literals;
+    uint32_t variables;
+    uint32_t segments;
+    uint32_t atoms;
+    uint32_t roots;
+  };
+
+  // Apply 'fn' to every atom held by the tree
+  template <class Fn> void for_each_atom(Fn fn);
+
+  bool well_formed() const;
+
+  std::vector<node> _nodes;
+  std::vector<uint32_t> _extra;
+  std::vector<literal> _literals;
+  std::vector<variable> _variables;
+  std::vector<uint64_t> _segments;
+  uint32_t _roots;
+};
+
+} // namespace titan
+
+#endif
@@ -0,0 +1,112 @@
+#include "import_resolver.hpp"
+
+namespace titan {
+
+namespace {
+
+bool modified_time(const std::filesystem::path &dir,
+                   std::filesystem::file_time_type &mtime)
+{
+  std::error_code ec;
+  if (!std::filesystem::is_directory(dir, ec)) {
+    return false;
+  }
+  mtime = std::filesystem::last_write_time(dir, ec);
+  return !ec;
+}
+
+} // namespace
+
+std::tuple<bool, std::string>
+import_resolver::resolve(const std::vector<std::string> &dirs,
+                         const std::string &target)
+{
+  if (!_ready) {
+    setup(dirs);
+  }
+
+  if (auto it = _resolved.find(target); it != _resolved.end()) {
+    return {!it->second.empty(), it->second};
+  }
+
+  std::string found;
+  auto name = std::filesystem::path(target).filename().string();
+  if (!name.empty()) {
+    for (auto &root : _roots) {
+      auto item_path = root / target;
+      auto &files = list(item_path.parent_path()).files;
+      if (files.find(name) != files.end()) {
+        found = item_path.string();
+        break;
+      }
+    }
+  }
+
+  _resolved.emplace(target, found);
+  return {!found.empty(), found};
+}
+
+void import_resolver::refresh(const std::vector<std::string> &dirs)
+{
+  if (!_ready || dirs != _dirs ||
+      _roots.front() != std::filesystem::current_path()) {
+    setup(dirs);
+    return;
+  }
+
+  bool changed = false;
+  for (auto it = _listings.begin(); it != _listings.end();) {
+    std::filesystem::file_time_type mtime;
+    bool exists = modified_time(it->first, mtime);
+    if (exists != it->second.exists || (exists && mtime != it->second.mtime)) {
+      it = _listings.erase(it);
+      changed = true;
+    }
+    else {
+      ++it;
+    }
+  }
+
+  // Any directory could now hold what an earlier one did not
+  if (changed) {
+    _resolved.clear();
+  }
+}
+
+void import_resolver::setup(const std::vector<std::string> &dirs)
+{
+  _dirs = dirs;
+  _roots.clear();
+  _roots.push_back(std::filesystem::current_path());
+  _roots.insert(_roots.end(), dirs.begin(), dirs.end());
+  _listings.clear();
+  _resolved.clear();
+  _ready = true;
+}
+
+const import_resolver::listing &
+import_resolver::list(const std::filesystem::path &dir)
+{
+  auto key = dir.string();
+  if (auto it = _listings.find(key); it != _listings.end()) {
+    return it->second;
+  }
+
+  // The time is taken first so a file added while listing shows up as a
+  // change on the next refresh
+  listing l;
+  l.exists = modified_time(dir, l.mtime);
+  if (l.exists) {
+    std::error_code ec;
+    for (auto &entry : std::filesystem::directory_iterator(dir, ec)) {
+      if (entry.is_regular_file(ec)) {
+        l.files.insert(entry.path().filename().string());
+      }
+    }
+  }
+  _scans++;
+
+  return _listings.emplace(key, std::move(l)).first->second;
+}
+
+} // namespace titan
@@ -0,0 +1,56 @@
+#ifndef TITAN_IMPORT_RESOLVER_HPP
+#define TITAN_IMPORT_RESOLVER_HPP
+
+#include <filesystem>
+#include <string>
+#include <tuple>
+#include <unordered_map>
+#include <unordered_set>
+#include <vector>
+
+namespace titan {
+
+//  Finds the file an import names. The working directory is searched
+//  first, then the include directories in order.
+//
+//  Each directory is listed once into an index of the files in it, and
+//  the outcome of every lookup is kept, found or not, so resolving a
+//  target again is a single hash lookup however many directories there
+//  are. refresh() drops whatever a directory whose modification time has
+//  changed since it was listed could have answered.
+//
+//  Not thread safe.
+//
+class import_resolver {
+public:
+  // Path of 'target' as found in the first directory holding it
+  std::tuple<bool, std::string> resolve(const std::vector<std::string> &dirs,
+                                        const std::string &target);
+
+  // Search 'dirs' from now on and forget anything that may be stale
+  void refresh(const std::vector<std::string> &dirs);
+
+  // Times a directory has been read, for tests
+  size_t directory_scans() const { return _scans; }
+
+private:
+  struct listing {
+    bool exists = false;
+    std::filesystem::file_time_type mtime;
+    std::unordered_set<std::string> files;
+  };
+
+  bool _ready = false;
+  size_t _scans = 0;
+  std::vector<std::string> _dirs;
+  std::vector<std::filesystem::path> _roots; // Working directory, then _dirs
+  std::unordered_map<std::string, listing> _listings; // By directory
+  std::unordered_map<std::string, std::string> _resolved; // Empty if missing
+
+  void setup(const std::vector<std::string> &dirs);
+  const listing &list(const std::filesystem::path &dir);
+};
+
+} // namespace titan
+
+#endif
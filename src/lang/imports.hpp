@@ -1,48 +1,114 @@
 #ifndef IMPORTS_HPP
 #define IMPORTS_HPP
 
-#include "tokens.hpp"
+#include "import_resolver.hpp"
+#include "instructions.hpp"
+#include "token_stream.hpp"
 
-#include <map>
+#include <filesystem>
 #include <memory>
 #include <string>
 #include <tuple>
 #include <functional>
+#include <unordered_map>
 
 namespace titan {
 class imports {
 public:
   
-  imports(std::function<std::vector<TD_Pair>(std::string)> importer,
+  imports(std::function<token_stream_ptr(std::string)> importer,
       std::vector<std::string> include_dirs) : 
     import_file(importer), include_directories(include_dirs){}
 
-  bool has_been_imported(const std::string target) const
+  // Path of the file 'target' names, searching the working directory and
+  // then the include directories
+  std::tuple<bool, std::string> locate(const std::string &target)
   {
-    if (_imported.empty()) {
-      return false;
-    }
-    return _imported.find(target) != _imported.end();
+    return _resolver.resolve(include_directories, target);
+  }
+
+  //  Modules imported by the current run, by canonical path. A module is
+  //  PARSING until all of its items have been parsed, so meeting it again
+  //  before then means the imports form a cycle. Once DONE its items are
+  //  already in the tree and later imports of it are skipped
+  //
+  enum class module_state { NONE, PARSING, DONE };
+
+  static std::string module_key(const std::string &path)
+  {
+    std::error_code ec;
+    auto canonical = std::filesystem::weakly_canonical(path, ec);
+    return ec ? path : canonical.string();
+  }
+
+  module_state state_of(const std::string &module) const
+  {
+    auto it = _modules.find(module);
+    return (it == _modules.end()) ? module_state::NONE : it->second;
+  }
+
+  void set_state(const std::string &module, module_state state)
+  {
+    _modules[module] = state;
   }
 
-  void store_target_path(const std::string &target, const std::string &path)
+  //  A module lexed and parsed ahead of time (see parser::preload_imports).
+  //  The module's own imports are left in 'items' to be expanded in order,
+  //  'imports' says where they are and where errors about them go
+  //
+  struct pending_import {
+    size_t index;
+    size_t line;
+    size_t col;
+  };
+
+  struct preloaded_module {
+    token_stream_ptr tokens;
+    std::vector<instructions::instruction_ptr> items;
+    std::vector<pending_import> imports;
+    bool okay = false;
+  };
+
+  // Returns nullptr if the module was not preloaded
+  preloaded_module *preloaded(const std::string &module)
   {
-    _imported[target] = path;
+    auto it = _preloaded.find(module);
+    return (it == _preloaded.end()) ? nullptr : &it->second;
   }
 
-  std::tuple<bool, std::string> get_target_path(const std::string &target)
+  void add_preloaded(const std::string &module, preloaded_module loaded)
   {
-    if (!has_been_imported(target)) {
-      return {false, {}};
+    _preloaded.emplace(module, std::move(loaded));
+  }
+
+  // Pick up changes to the include directories while keeping the modules
+  // imported so far (i.e from earlier REPL lines)
+  void refresh() { _resolver.refresh(include_directories); }
+
+  // Forget the modules of the last run and any located paths that may have
+  // gone stale. 'root' is the file being run, if any, which stays PARSING
+  // for the whole run
+  void reset_modules(const std::string &root = {})
+  {
+    _resolver.refresh(include_directories);
+    _modules.clear();
+    _preloaded.clear();
+    if (!root.empty()) {
+      _modules[module_key(root)] = module_state::PARSING;
     }
-    return {true, _imported.at(target)};
   }
 
-  std::function<std::vector<TD_Pair>(std::string)> import_file;
+  std::function<token_stream_ptr(std::string)> import_file;
+
+  // Lexes a module like import_file without reporting errors, returning
+  // nullptr if it can not be opened. Imports are only preloaded when it is set
+  std::function<token_stream_ptr(std::string)> preload_file;
   std::vector<std::string> include_directories;
 
 private:
-  std::map<std::string, std::string> _imported;
+  import_resolver _resolver;
+  std::unordered_map<std::string, module_state> _modules;
+  std::unordered_map<std::string, preloaded_module> _preloaded;
 };
 
 } // namespace titan
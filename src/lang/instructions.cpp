@@ -1,8 +1,27 @@
 #include "instructions.hpp"
+#include "word_table.hpp"
 
 namespace titan {
 namespace instructions {
 
+namespace {
+
+constexpr word_table<variable_types, 10, 32> type_names({
+    {"u8", variable_types::U8},
+    {"u16", variable_types::U16},
+    {"u32", variable_types::U32},
+    {"u64", variable_types::U64},
+    {"i8", variable_types::I8},
+    {"i16", variable_types::I16},
+    {"i32", variable_types::I32},
+    {"i64", variable_types::I64},
+    {"float", variable_types::FLOAT},
+    {"string", variable_types::STRING},
+});
+static_assert(type_names.is_perfect(), "Unable to build perfect type hash");
+
+} // namespace
+
 void define_user_struct::visit(ins_receiver &ir) { ir.receive(*this); }
 void assignment_instruction::visit(ins_receiver &ir) { ir.receive(*this); }
 void expression_instruction::visit(ins_receiver &ir) { ir.receive(*this); }
@@ -13,44 +32,46 @@ void return_instruction::visit(ins_receiver &ir) { ir.receive(*this); }
 void import::visit(ins_receiver &ir) { ir.receive(*this); }
 void function::visit(ins_receiver &ir) { ir.receive(*this); }
 
-variable_types string_to_variable_type(const std::string &s)
+bool function::load_body()
 {
-  if (s == "u8") {
-    return variable_types::U8;
-  }
-  if (s == "u16") {
-    return variable_types::U16;
+  if (parse_body) {
+    auto parse = std::move(parse_body);
+    parse_body = nullptr;
+    _body_okay = parse(*this);
   }
-  if (s == "u32") {
-    return variable_types::U32;
-  }
-  if (s == "u64") {
-    return variable_types::U64;
-  }
-  if (s == "i8") {
+  return _body_okay;
+}
+
+variable_types string_to_variable_type(std::string_view s)
+{
+  /*
+   *    NOTE : User defined times not handled here
+   *    TODO : When user created constructs are created we will
+   *           need to do something to handle it here
+   */
+  variable_types type = variable_types::UNDEF;
+  type_names.find(s, type);
+  return type;
+}
+
+variable_types literal_to_variable_type(literal_type type)
+{
+  switch (type) {
+  case literal_type::I8:
     return variable_types::I8;
-  }
-  if (s == "i16") {
+  case literal_type::I16:
     return variable_types::I16;
-  }
-  if (s == "i32") {
+  case literal_type::I32:
     return variable_types::I32;
-  }
-  if (s == "i64") {
+  case literal_type::I64:
     return variable_types::I64;
-  }
-  if (s == "float") {
+  case literal_type::U64:
+    return variable_types::U64;
+  case literal_type::FLOAT:
     return variable_types::FLOAT;
+  default:
+    return variable_types::UNDEF;
   }
-  if (s == "string") {
-    return variable_types::STRING;
-  }
-  /*
-   *    NOTE : User defined times not handled here
-   *    TODO : When user created constructs are created we will
-   *           need to do something to handle it here
-   */
-  return variable_types::UNDEF;
 }
 
 void display_expr_tree(const std::string &prefix, expression *n, bool is_left)
@@ -82,16 +103,16 @@ void display_expr_tree(const std::string &prefix, expression *n, bool is_left)
   }
   else if (n->type == node_type::INFIX) {
     auto i = reinterpret_cast<infix_expr *>(n);
-    std::cout << " " << i->op << std::endl;
-    display_expr_tree(prefix + (is_left ? "│   " : "    "), i->left.get(),
+    std::cout << " " << fixed_token_text(i->op) << std::endl;
+    display_expr_tree(prefix + (is_left ? "│   " : "    "), i->left,
                       true);
-    display_expr_tree(prefix + (is_left ? "│   " : "    "), i->right.get(),
+    display_expr_tree(prefix + (is_left ? "│   " : "    "), i->right,
                       false);
   }
   else if (n->type == node_type::PREFIX) {
     auto i = reinterpret_cast<prefix_expr *>(n);
-    std::cout << " " << i->op << std::endl;
-    display_expr_tree(prefix + (is_left ? "│   " : "    "), i->right.get(),
+    std::cout << " " << fixed_token_text(i->op) << std::endl;
+    display_expr_tree(prefix + (is_left ? "│   " : "    "), i->right,
                       false);
   }
   else {
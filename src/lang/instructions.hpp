@@ -28,15 +28,23 @@
 #ifndef TITAN_INSTRUCTIONS_HPP
 #define TITAN_INSTRUCTIONS_HPP
 
+#include "atoms.hpp"
 #include "tokens.hpp"
+#include <functional>
 #include <iostream>
 #include <memory>
+#include <string>
+#include <string_view>
 #include <utility>
 #include <vector>
 
 namespace titan {
 namespace instructions {
 
+//  Nodes built by the parser live in its arena (see arena.hpp). The *_ptr
+//  names are plain pointers into it and do not own what they point at
+//
+
 enum class variable_types {
   U8 = 0,
   U16,
@@ -54,45 +62,66 @@ enum class variable_types {
 
 enum class variable_classification { UNDEF, BUILT_IN, USER_DEFINED };
 
-extern variable_types string_to_variable_type(const std::string &s);
+extern variable_types string_to_variable_type(std::string_view s);
+
+//  Type of a numeric literal as decided by the lexer
+extern variable_types literal_to_variable_type(literal_type type);
 
+//  Names of variables, functions and identifiers are interned (see atoms.hpp)
+//  so each node holds the atom and a view of the interned text rather than
+//  its own copy of the string
+//
 class variable {
 public:
-  variable() : name(""), classification(variable_classification::UNDEF) {}
-  variable(const std::string name, variable_classification vc)
-      : name(name), classification(vc)
+  variable() : id(empty_atom), classification(variable_classification::UNDEF)
+  {
+  }
+  variable(atom id, variable_classification vc)
+      : id(id), name(atoms::text(id)), classification(vc)
+  {
+  }
+  variable(std::string_view name, variable_classification vc)
+      : variable(atoms::intern(name), vc)
   {
   }
   virtual ~variable() = default;
 
-  std::string name;
+  atom id;
+  std::string_view name;
   variable_classification classification;
 };
-using variable_ptr = std::unique_ptr<variable>;
+using variable_ptr = variable *;
 
 class built_in_variable : public variable {
 public:
-  built_in_variable(const std::string name)
+  built_in_variable(std::string_view name)
       : variable(name, variable_classification::BUILT_IN)
   {
   }
 
-  built_in_variable(const std::string name, variable_types type, uint64_t depth,
+  built_in_variable(std::string_view name, variable_types type, uint64_t depth,
                     std::vector<uint64_t> seg)
       : variable(name, variable_classification::BUILT_IN), type(type),
         depth(depth), segments(seg)
   {
   }
 
+  built_in_variable(atom id, variable_types type, uint64_t depth,
+                    std::vector<uint64_t> seg)
+      : variable(id, variable_classification::BUILT_IN), type(type),
+        depth(depth), segments(seg)
+  {
+  }
+
   variable_types type;
   uint64_t depth;
   std::vector<uint64_t> segments;
 };
-using built_in_variable_ptr = std::unique_ptr<built_in_variable>;
+using built_in_variable_ptr = built_in_variable *;
 
 class user_defined_variable : public variable {
 public:
-  user_defined_variable(const std::string name)
+  user_defined_variable(std::string_view name)
       : variable(name, variable_classification::USER_DEFINED)
   {
   }
@@ -100,7 +129,7 @@ public:
   std::string type; // Name of the user type so it can be mapped
                     // to a definition later
 };
-using user_defined_variable_ptr = std::unique_ptr<user_defined_variable>;
+using user_defined_variable_ptr = user_defined_variable *;
 
 class user_struct {
 public:
@@ -136,25 +165,39 @@ enum class node_type {
 
 class expression {
 public:
-  expression() : type(node_type::ROOT) {}
-  expression(node_type t) : type(t) {}
+  expression() : type(node_type::ROOT), id(empty_atom) {}
+  expression(node_type t) : type(t), id(empty_atom) {}
   expression(size_t line, size_t col, node_type t)
-      : line(line), col(col), type(t)
+      : line(line), col(col), type(t), id(empty_atom)
   {
   }
-  expression(node_type t, std::string val) : type(t), value(val) {}
-  expression(size_t line, size_t col, node_type t, std::string val)
-      : line(line), col(col), type(t), value(val)
+  expression(size_t line, size_t col, node_type t, atom id)
+      : line(line), col(col), type(t), id(id), value(atoms::text(id))
+  {
+  }
+  expression(size_t line, size_t col, node_type t, std::string_view val)
+      : expression(line, col, t, atoms::intern(val))
   {
   }
-  virtual ~expression() = default;
 
   size_t line;
   size_t col;
   node_type type;
-  std::string value;
+  atom id;
+  std::string_view value;
+
+  //  Filled in by the analyzer. An expression is typed once it and its
+  //  operands have checked out; 'cast_to' is the type its value is
+  //  implicitly converted to where it is used (UNDEF if it is used as is)
+  //  and 'target' is the variable an ID names
+  //
+  bool typed = false;
+  variable_types resolved_type = variable_types::UNDEF;
+  uint64_t resolved_depth = 0;
+  variable_types cast_to = variable_types::UNDEF;
+  variable *target = nullptr;
 };
-using expr_ptr = std::unique_ptr<expression>;
+using expr_ptr = expression *;
 
 /*
  *  prefix / infix and other expression implementations are used to construct
@@ -166,51 +209,58 @@ extern void display_expr_tree(const std::string &prefix, expression *n,
 
 class raw_int_expr : public expression {
 public:
-  raw_int_expr(size_t line, size_t col, std::string val)
-      : expression(line, col, node_type::RAW_NUMBER, val),
-        as(variable_types::I64), with_val(0)
+  raw_int_expr(size_t line, size_t col, atom val, variable_types as,
+               uint64_t ival)
+      : expression(line, col, node_type::RAW_NUMBER, val), as(as),
+        with_val(ival)
   {
   }
-  raw_int_expr(size_t line, size_t col, std::string val, variable_types as,
-               long long ival)
+  raw_int_expr(size_t line, size_t col, std::string_view val, variable_types as,
+               uint64_t ival)
       : expression(line, col, node_type::RAW_NUMBER, val), as(as),
         with_val(ival)
   {
   }
   variable_types as;
-  long long with_val;
+  uint64_t with_val;
 };
-using raw_int_expr_ptr = std::unique_ptr<raw_int_expr>;
+using raw_int_expr_ptr = raw_int_expr *;
+
+class raw_float_expr : public expression {
+public:
+  raw_float_expr(size_t line, size_t col, atom val, double fval)
+      : expression(line, col, node_type::RAW_FLOAT, val), with_val(fval)
+  {
+  }
+  double with_val;
+};
+using raw_float_expr_ptr = raw_float_expr *;
 
 class prefix_expr : public expression {
 public:
-  prefix_expr(size_t line, size_t col, std::string op, expr_ptr right)
-      : expression(line, col, node_type::PREFIX), op(op),
-        right(std::move(right))
+  prefix_expr(size_t line, size_t col, Token op, expr_ptr right)
+      : expression(line, col, node_type::PREFIX), op(op), right(right)
   {
   }
-  std::string op;
-  Token tok_op;
+  Token op;
   expr_ptr right;
 };
-using prefix_expr_ptr = std::unique_ptr<prefix_expr>;
+using prefix_expr_ptr = prefix_expr *;
 
 class infix_expr : public expression {
 public:
-  infix_expr(size_t line, size_t col, std::string op, expr_ptr left,
-             expr_ptr right)
-      : expression(line, col, node_type::INFIX), op(op), left(std::move(left)),
-        right(std::move(right))
+  infix_expr(size_t line, size_t col, Token op, expr_ptr left, expr_ptr right)
+      : expression(line, col, node_type::INFIX), op(op), left(left),
+        right(right)
   {
   }
 
-  std::string op;
-  Token tok_op;
+  Token op;
 
   expr_ptr left;
   expr_ptr right;
 };
-using infix_expr_ptr = std::unique_ptr<infix_expr>;
+using infix_expr_ptr = infix_expr *;
 
 class array_literal_expr : public expression {
 public:
@@ -221,7 +271,7 @@ public:
 
   std::vector<expr_ptr> expressions;
 };
-using array_literal_expr_ptr = std::unique_ptr<array_literal_expr>;
+using array_literal_expr_ptr = array_literal_expr *;
 
 class array_index_expr : public expression {
 public:
@@ -230,15 +280,17 @@ public:
   {
   }
   array_index_expr(size_t line, size_t col, expr_ptr arr, expr_ptr idx)
-      : expression(line, col, node_type::ARRAY_IDX), arr(std::move(arr)),
-        index(std::move(idx))
+      : expression(line, col, node_type::ARRAY_IDX), arr(arr),
+        index(idx)
   {
   }
 
   expr_ptr arr;
   expr_ptr index;
 };
-using array_index_expr_ptr = std::unique_ptr<array_index_expr>;
+using array_index_expr_ptr = array_index_expr *;
+
+class function;
 
 class function_call_expr : public expression {
 public:
@@ -247,20 +299,21 @@ public:
   {
   }
   function_call_expr(size_t line, size_t col, expr_ptr fn)
-      : expression(line, col, node_type::CALL), fn(std::move(fn))
+      : expression(line, col, node_type::CALL), fn(fn)
   {
   }
   function_call_expr(size_t line, size_t col, expr_ptr fn,
                      std::vector<expr_ptr> p)
-      : expression(line, col, node_type::CALL), fn(std::move(fn)),
+      : expression(line, col, node_type::CALL), fn(fn),
         params(std::move(p))
   {
   }
 
   expr_ptr fn;
   std::vector<expr_ptr> params;
+  function *target = nullptr; // Function called, set by the analyzer
 };
-using function_call_expr_ptr = std::unique_ptr<function_call_expr>;
+using function_call_expr_ptr = function_call_expr *;
 
 class ins_receiver;
 
@@ -273,7 +326,7 @@ public:
   size_t line;
   size_t col;
 };
-using instruction_ptr = std::unique_ptr<instruction>;
+using instruction_ptr = instruction *;
 
 class define_user_struct : public instruction {
 public:
@@ -286,12 +339,12 @@ public:
 
   virtual void visit(ins_receiver &v) override;
 };
-using define_user_struct_ptr = std::unique_ptr<define_user_struct>;
+using define_user_struct_ptr = define_user_struct *;
 
 class assignment_instruction : public instruction {
 public:
   assignment_instruction(size_t line, size_t col, variable_ptr var, expr_ptr node)
-      : instruction(line, col), var(std::move(var)), expr(std::move(node))
+      : instruction(line, col), var(var), expr(node)
   {
   }
 
@@ -300,16 +353,14 @@ public:
 
   virtual void visit(ins_receiver &v) override;
 };
-using assignment_instruction_ptr = std::unique_ptr<assignment_instruction>;
+using assignment_instruction_ptr = assignment_instruction *;
 
 class if_instruction : public instruction {
 public:
   class segment {
   public:
     segment(expr_ptr expr, std::vector<instruction_ptr> instruction_list)
-        :
-
-          expr(std::move(expr)), instruction_list(std::move(instruction_list))
+        : expr(expr), instruction_list(std::move(instruction_list))
     {
     }
 
@@ -322,12 +373,12 @@ public:
 
   virtual void visit(ins_receiver &v) override;
 };
-using if_instruction_ptr = std::unique_ptr<if_instruction>;
+using if_instruction_ptr = if_instruction *;
 
 class expression_instruction : public instruction {
 public:
   expression_instruction(size_t line, size_t col, expr_ptr node)
-      : instruction(line, col), expr(std::move(node))
+      : instruction(line, col), expr(node)
   {
   }
 
@@ -335,7 +386,7 @@ public:
 
   virtual void visit(ins_receiver &v) override;
 };
-using expression_instruction_ptr = std::unique_ptr<expression_instruction>;
+using expression_instruction_ptr = expression_instruction *;
 
 class while_instruction : public instruction {
 public:
@@ -345,7 +396,7 @@ public:
   }
   while_instruction(size_t line, size_t col, expr_ptr c,
                     std::vector<instruction_ptr> body)
-      : instruction(line, col), condition(std::move(c)), body(std::move(body))
+      : instruction(line, col), condition(c), body(std::move(body))
   {
   }
 
@@ -354,7 +405,7 @@ public:
 
   virtual void visit(ins_receiver &v) override;
 };
-using while_instruction_ptr = std::unique_ptr<while_instruction>;
+using while_instruction_ptr = while_instruction *;
 
 class for_instruction : public instruction {
 public:
@@ -365,8 +416,8 @@ public:
   for_instruction(size_t line, size_t col, instruction_ptr assign,
                   expr_ptr condition, expr_ptr modifier,
                   std::vector<instruction_ptr> body)
-      : instruction(line, col), assign(std::move(assign)),
-        condition(std::move(condition)), modifier(std::move(modifier)),
+      : instruction(line, col), assign(assign),
+        condition(condition), modifier(modifier),
         body(std::move(body))
   {
   }
@@ -378,19 +429,19 @@ public:
 
   virtual void visit(ins_receiver &v) override;
 };
-using for_instruction_ptr = std::unique_ptr<for_instruction>;
+using for_instruction_ptr = for_instruction *;
 
 class return_instruction : public instruction {
 public:
   return_instruction(size_t line, size_t col, expr_ptr node)
-      : instruction(line, col), expr(std::move(node))
+      : instruction(line, col), expr(node)
   {
   }
   expr_ptr expr;
 
   virtual void visit(ins_receiver &v) override;
 };
-using return_instruction_ptr = std::unique_ptr<return_instruction>;
+using return_instruction_ptr = return_instruction *;
 
 class import : public instruction {
 public:
@@ -402,19 +453,37 @@ public:
   std::string target;
   virtual void visit(ins_receiver &v) override;
 };
-using import_ptr = std::unique_ptr<import>;
+using import_ptr = import *;
 
 class function : public instruction {
 public:
-  function(size_t line, size_t col) : instruction(line, col) {}
-  std::string name;
+  function(size_t line, size_t col)
+      : instruction(line, col), id(empty_atom), _body_okay(true)
+  {
+  }
+  atom id;
+  std::string_view name;
   std::string file_name;
   variable_ptr return_data;
   std::vector<variable_ptr> parameters;
   std::vector<instruction_ptr> instruction_list;
+
+  // Set when the parser skipped the body (see parser::set_lazy_bodies).
+  // Parses the body into instruction_list, returning false on errors
+  std::function<bool(function &)> parse_body;
+
+  bool body_pending() const { return static_cast<bool>(parse_body); }
+
+  // Make sure instruction_list holds the body, parsing it if it was
+  // skipped. Returns false if the body has errors
+  bool load_body();
+
   virtual void visit(ins_receiver &v) override;
+
+private:
+  bool _body_okay;
 };
-using function_ptr = std::unique_ptr<function>;
+using function_ptr = function *;
 
 /*
 
@@ -1,62 +1,200 @@
 #include "lexer.hpp"
+#include "scan.hpp"
+#include "word_table.hpp"
+
+#include "alert/alert.hpp"
+#include "error/error_list.hpp"
 
 #include <algorithm>
-#include <filesystem>
-#include <fstream>
+#include <charconv>
 #include <iostream>
-#include <locale>
+#include <limits>
 
 namespace titan {
 
-lexer::lexer() : _idx(0) {}
+namespace {
+
+literal_type narrowest_integer(uint64_t value)
+{
+  if (value <= std::numeric_limits<int8_t>::max()) {
+    return literal_type::I8;
+  }
+  if (value <= std::numeric_limits<int16_t>::max()) {
+    return literal_type::I16;
+  }
+  if (value <= std::numeric_limits<int32_t>::max()) {
+    return literal_type::I32;
+  }
+  if (value <= std::numeric_limits<int64_t>::max()) {
+    return literal_type::I64;
+  }
+  return literal_type::U64;
+}
+
+constexpr word_table<Token, 9, 32> keywords({
+    {"fn", Token::FN},
+    {"while", Token::WHILE},
+    {"for", Token::FOR},
+    {"if", Token::IF},
+    {"else", Token::ELSE},
+    {"return", Token::RETURN},
+    {"break", Token::BREAK},
+    {"let", Token::LET},
+    {"import", Token::IMPORT},
+});
+static_assert(keywords.is_perfect(), "Unable to build perfect keyword hash");
+
+} // namespace
+
+lexer::lexer() : lexer(std::string()) {}
+
+lexer::lexer(std::string source_name)
+    : _source_name(std::move(source_name)), _err("lexer"), _quiet(false),
+      _hold_errors(false),
+      _out(nullptr),
+      _buffer(nullptr), _idx(0), _source_pos(0), _source_line(0)
+{
+}
 
 void lexer::clear()
 {
-  _tokens.clear();
-  _current_line.clear();
+  _current_line = {};
   _idx = 0;
+  load({});
 }
 
 std::vector<TD_Pair> lexer::lex(size_t line_no, std::string line)
 {
+  std::vector<TD_Pair> tokens;
+  _out = &tokens;
   _current_line = line;
+  lex_line(line_no);
+  _current_line = {};
+  _out = nullptr;
+  return tokens;
+}
+
+std::vector<TD_Pair> lexer::lex_buffer(std::string_view source)
+{
+  std::vector<TD_Pair> tokens;
+
+  // Rough estimate of token density to avoid repeated regrowth on large files
+  tokens.reserve(source.size() / 6);
+
+  load(source);
+  while (lex_next(tokens, std::numeric_limits<size_t>::max())) {
+  }
+  return tokens;
+}
+
+void lexer::lex_buffer(std::string_view source, token_buffer &out)
+{
+  out.clear();
+  out.reserve(source.size() / 6);
+
+  // Lines are recorded by lex_next as they are reached, so every token in
+  // a batch already has the start of its line in the table
+  std::vector<TD_Pair> batch;
+  _buffer = &out;
+  load(source);
+  while (lex_next(batch, 256)) {
+    for (auto &td : batch) {
+      out.push(td.token, out.line_start(td.line) + static_cast<uint32_t>(td.col),
+               td.id, td.value);
+    }
+    batch.clear();
+  }
+  _buffer = nullptr;
+  out.shrink_to_fit();
+}
+
+void lexer::load(std::string_view source)
+{
+  _source = source;
+  _source_pos = 0;
+  _source_line = 0;
+}
+
+bool lexer::lex_next(std::vector<TD_Pair> &out, size_t min_tokens)
+{
+  size_t first = out.size();
+  _out = &out;
+
+  while (_source_pos < _source.size() && out.size() - first < min_tokens) {
+    _source_line++;
+
+    size_t end = _source.find('\n', _source_pos);
+    if (end == std::string_view::npos) {
+      end = _source.size();
+    }
+
+    // Trim the line in place
+    size_t begin = _source_pos;
+    _source_pos = end + 1;
+    begin = scan::space_end(_source.substr(0, end), begin);
+    while (end > begin && scan::is_space(_source[end - 1])) {
+      end--;
+    }
+    if (_buffer) {
+      _buffer->add_line(static_cast<uint32_t>(begin));
+    }
+
+    // Skip empty and comment lines
+    if (begin == end) {
+      continue;
+    }
+    if (end - begin >= 2 && _source[begin] == '/' &&
+        _source[begin + 1] == '/') {
+      continue;
+    }
 
+    _current_line = _source.substr(begin, end - begin);
+    lex_line(_source_line);
+  }
+
+  _current_line = {};
+  _out = nullptr;
+  return out.size() != first;
+}
+
+void lexer::lex_line(size_t line_no)
+{
   for (_idx = 0; _idx < _current_line.size(); advance()) {
     switch (_current_line[_idx]) {
     case '(':
-      _tokens.emplace_back(TD_Pair{Token::L_PAREN, "(", line_no, _idx});
+      _out->emplace_back(TD_Pair{Token::L_PAREN, "(", line_no, _idx});
       break;
 
     case ')':
-      _tokens.emplace_back(TD_Pair{Token::R_PAREN, ")", line_no, _idx});
+      _out->emplace_back(TD_Pair{Token::R_PAREN, ")", line_no, _idx});
       break;
 
     case '[':
-      _tokens.emplace_back(TD_Pair{Token::L_BRACKET, "[", line_no, _idx});
+      _out->emplace_back(TD_Pair{Token::L_BRACKET, "[", line_no, _idx});
       break;
 
     case ']':
-      _tokens.emplace_back(TD_Pair{Token::R_BRACKET, "]", line_no, _idx});
+      _out->emplace_back(TD_Pair{Token::R_BRACKET, "]", line_no, _idx});
       break;
 
     case '{':
-      _tokens.emplace_back(TD_Pair{Token::L_BRACE, "{", line_no, _idx});
+      _out->emplace_back(TD_Pair{Token::L_BRACE, "{", line_no, _idx});
       break;
 
     case '}':
-      _tokens.emplace_back(TD_Pair{Token::R_BRACE, "}", line_no, _idx});
+      _out->emplace_back(TD_Pair{Token::R_BRACE, "}", line_no, _idx});
       break;
 
     case ':':
-      _tokens.emplace_back(TD_Pair{Token::COLON, ":", line_no, _idx});
+      _out->emplace_back(TD_Pair{Token::COLON, ":", line_no, _idx});
       break;
 
     case ';':
-      _tokens.emplace_back(TD_Pair{Token::SEMICOLON, ";", line_no, _idx});
+      _out->emplace_back(TD_Pair{Token::SEMICOLON, ";", line_no, _idx});
       break;
 
     case ',':
-      _tokens.emplace_back(TD_Pair{Token::COMMA, ",", line_no, _idx});
+      _out->emplace_back(TD_Pair{Token::COMMA, ",", line_no, _idx});
       break;
 
     case '>':
@@ -64,18 +202,18 @@ std::vector<TD_Pair> lexer::lex(size_t line_no, std::string line)
         advance();
         if (peek() == '=') {
           advance();
-          _tokens.emplace_back(TD_Pair{Token::RSH_EQ, ">>=", line_no, _idx});
+          _out->emplace_back(TD_Pair{Token::RSH_EQ, ">>=", line_no, _idx});
         }
         else {
-          _tokens.emplace_back(TD_Pair{Token::RSH, ">>", line_no, _idx});
+          _out->emplace_back(TD_Pair{Token::RSH, ">>", line_no, _idx});
         }
       }
       else if (peek() == '=') {
         advance();
-        _tokens.emplace_back(TD_Pair{Token::GTE, ">=", line_no, _idx});
+        _out->emplace_back(TD_Pair{Token::GTE, ">=", line_no, _idx});
       }
       else {
-        _tokens.emplace_back(TD_Pair{Token::GT, ">", line_no, _idx});
+        _out->emplace_back(TD_Pair{Token::GT, ">", line_no, _idx});
       }
       break;
 
@@ -84,179 +222,190 @@ std::vector<TD_Pair> lexer::lex(size_t line_no, std::string line)
         advance();
         if (peek() == '=') {
           advance();
-          _tokens.emplace_back(TD_Pair{Token::LSH_EQ, "<<=", line_no, _idx});
+          _out->emplace_back(TD_Pair{Token::LSH_EQ, "<<=", line_no, _idx});
         }
         else {
-          _tokens.emplace_back(TD_Pair{Token::LSH, "<<", line_no, _idx});
+          _out->emplace_back(TD_Pair{Token::LSH, "<<", line_no, _idx});
         }
       }
       else if (peek() == '=') {
         advance();
-        _tokens.emplace_back(TD_Pair{Token::LTE, "<=", line_no, _idx});
+        _out->emplace_back(TD_Pair{Token::LTE, "<=", line_no, _idx});
       }
       else {
-        _tokens.emplace_back(TD_Pair{Token::LT, "<", line_no, _idx});
+        _out->emplace_back(TD_Pair{Token::LT, "<", line_no, _idx});
       }
       break;
 
     case '@':
-      _tokens.emplace_back(TD_Pair{Token::AT, "@", line_no, _idx});
+      _out->emplace_back(TD_Pair{Token::AT, "@", line_no, _idx});
       break;
 
     case '$':
-      _tokens.emplace_back(TD_Pair{Token::DOLLAR, "$", line_no, _idx});
+      _out->emplace_back(TD_Pair{Token::DOLLAR, "$", line_no, _idx});
       break;
 
     case '\'':
-      _tokens.emplace_back(TD_Pair{Token::SINGLE_QUOTE, "'", line_no, _idx});
+      _out->emplace_back(TD_Pair{Token::SINGLE_QUOTE, "'", line_no, _idx});
       break;
 
     case '?':
-      _tokens.emplace_back(TD_Pair{Token::QUESTION_MARK, "?", line_no, _idx});
+      _out->emplace_back(TD_Pair{Token::QUESTION_MARK, "?", line_no, _idx});
       break;
 
     case '.':
-      _tokens.emplace_back(TD_Pair{Token::PERIOD, ".", line_no, _idx});
+      _out->emplace_back(TD_Pair{Token::PERIOD, ".", line_no, _idx});
       break;
 
     case '#':
-      _tokens.emplace_back(TD_Pair{Token::OCTOTHORPE, "#", line_no, _idx});
+      _out->emplace_back(TD_Pair{Token::OCTOTHORPE, "#", line_no, _idx});
       break;
 
     case '!':
       if (peek() == '=') {
         advance();
-        _tokens.emplace_back(
+        _out->emplace_back(
             TD_Pair{Token::EXCLAMATION_EQ, "!=", line_no, _idx});
       }
       else {
-        _tokens.emplace_back(TD_Pair{Token::EXCLAMATION, "!", line_no, _idx});
+        _out->emplace_back(TD_Pair{Token::EXCLAMATION, "!", line_no, _idx});
       }
       break;
 
     case '-':
       if (peek() == '>') {
         advance();
-        _tokens.emplace_back(TD_Pair{Token::ARROW, "->", line_no, _idx});
+        _out->emplace_back(TD_Pair{Token::ARROW, "->", line_no, _idx});
       }
       else if (peek() == '=') {
         advance();
-        _tokens.emplace_back(TD_Pair{Token::SUB_EQ, "-=", line_no, _idx});
+        _out->emplace_back(TD_Pair{Token::SUB_EQ, "-=", line_no, _idx});
       }
       else {
-        _tokens.emplace_back(TD_Pair{Token::SUB, "-", line_no, _idx});
+        _out->emplace_back(TD_Pair{Token::SUB, "-", line_no, _idx});
       }
       break;
 
     case '+':
       if (peek() == '=') {
         advance();
-        _tokens.emplace_back(TD_Pair{Token::ADD_EQ, "+=", line_no, _idx});
+        _out->emplace_back(TD_Pair{Token::ADD_EQ, "+=", line_no, _idx});
       }
       else {
-        _tokens.emplace_back(TD_Pair{Token::ADD, "+", line_no, _idx});
+        _out->emplace_back(TD_Pair{Token::ADD, "+", line_no, _idx});
       }
       break;
 
     case '/':
       if (peek() == '=') {
         advance();
-        _tokens.emplace_back(TD_Pair{Token::DIV_EQ, "/=", line_no, _idx});
+        _out->emplace_back(TD_Pair{Token::DIV_EQ, "/=", line_no, _idx});
       }
       else {
-        _tokens.emplace_back(TD_Pair{Token::DIV, "/", line_no, _idx});
+        _out->emplace_back(TD_Pair{Token::DIV, "/", line_no, _idx});
       }
       break;
 
     case '*':
       if (peek() == '=') {
         advance();
-        _tokens.emplace_back(TD_Pair{Token::MUL_EQ, "*=", line_no, _idx});
+        _out->emplace_back(TD_Pair{Token::MUL_EQ, "*=", line_no, _idx});
       }
       else if (peek() == '*') {
         advance();
         if (peek() == '=') {
           advance();
-          _tokens.emplace_back(TD_Pair{Token::POW_EQ, "**=", line_no, _idx});
+          _out->emplace_back(TD_Pair{Token::POW_EQ, "**=", line_no, _idx});
         }
         else {
-          _tokens.emplace_back(TD_Pair{Token::POW, "**", line_no, _idx});
+          _out->emplace_back(TD_Pair{Token::POW, "**", line_no, _idx});
         }
       }
       else {
-        _tokens.emplace_back(TD_Pair{Token::MUL, "*", line_no, _idx});
+        _out->emplace_back(TD_Pair{Token::MUL, "*", line_no, _idx});
       }
       break;
 
     case '%':
       if (peek() == '=') {
         advance();
-        _tokens.emplace_back(TD_Pair{Token::MOD_EQ, "%=", line_no, _idx});
+        _out->emplace_back(TD_Pair{Token::MOD_EQ, "%=", line_no, _idx});
       }
       else {
-        _tokens.emplace_back(TD_Pair{Token::MOD, "%", line_no, _idx});
+        _out->emplace_back(TD_Pair{Token::MOD, "%", line_no, _idx});
       }
       break;
 
     case '&':
       if (peek() == '=') {
         advance();
-        _tokens.emplace_back(TD_Pair{Token::AMPERSAND_EQ, "&=", line_no, _idx});
+        _out->emplace_back(TD_Pair{Token::AMPERSAND_EQ, "&=", line_no, _idx});
       }
       else if (peek() == '&') {
         advance();
-        _tokens.emplace_back(TD_Pair{Token::AND, "&&", line_no, _idx});
+        _out->emplace_back(TD_Pair{Token::AND, "&&", line_no, _idx});
       }
       else {
-        _tokens.emplace_back(TD_Pair{Token::AMPERSAND, "&", line_no, _idx});
+        _out->emplace_back(TD_Pair{Token::AMPERSAND, "&", line_no, _idx});
       }
       break;
 
     case '|':
       if (peek() == '=') {
         advance();
-        _tokens.emplace_back(TD_Pair{Token::PIPE_EQ, "|=", line_no, _idx});
+        _out->emplace_back(TD_Pair{Token::PIPE_EQ, "|=", line_no, _idx});
       }
       else if (peek() == '|') {
         advance();
-        _tokens.emplace_back(TD_Pair{Token::OR, "||", line_no, _idx});
+        _out->emplace_back(TD_Pair{Token::OR, "||", line_no, _idx});
       }
       else {
-        _tokens.emplace_back(TD_Pair{Token::PIPE, "|", line_no, _idx});
+        _out->emplace_back(TD_Pair{Token::PIPE, "|", line_no, _idx});
       }
       break;
 
     case '~':
       if (peek() == '=') {
         advance();
-        _tokens.emplace_back(TD_Pair{Token::TILDE_EQ, "~=", line_no, _idx});
+        _out->emplace_back(TD_Pair{Token::TILDE_EQ, "~=", line_no, _idx});
       }
       else {
-        _tokens.emplace_back(TD_Pair{Token::TILDE, "~", line_no, _idx});
+        _out->emplace_back(TD_Pair{Token::TILDE, "~", line_no, _idx});
       }
       break;
 
     case '^':
       if (peek() == '=') {
         advance();
-        _tokens.emplace_back(TD_Pair{Token::HAT_EQ, "^=", line_no, _idx});
+        _out->emplace_back(TD_Pair{Token::HAT_EQ, "^=", line_no, _idx});
       }
       else {
-        _tokens.emplace_back(TD_Pair{Token::HAT, "^", line_no, _idx});
+        _out->emplace_back(TD_Pair{Token::HAT, "^", line_no, _idx});
       }
       break;
 
     case '=':
       if (peek() == '=') {
         advance();
-        _tokens.emplace_back(TD_Pair{Token::EQ_EQ, "==", line_no, _idx});
+        _out->emplace_back(TD_Pair{Token::EQ_EQ, "==", line_no, _idx});
       }
       else {
-        _tokens.emplace_back(TD_Pair{Token::EQ, "=", line_no, _idx});
+        _out->emplace_back(TD_Pair{Token::EQ, "=", line_no, _idx});
       }
       break;
 
     case '"': {
+      // Plain strings (no escapes) are the common case, hand back a view
+      // of the source when the closing quote is found before any backslash
+      auto close = scan::string_end(_current_line, _idx + 1);
+      if (close > _idx + 1 && close < _current_line.size() &&
+          _current_line[close] == '"') {
+        auto body = _current_line.substr(_idx + 1, close - _idx - 1);
+        _idx = close;
+        add_text(Token::STRING, body, line_no);
+        break;
+      }
+
       std::string value;
       bool consume_string = true;
       while (consume_string && peek() != '\0') {
@@ -281,81 +430,118 @@ std::vector<TD_Pair> lexer::lex(size_t line_no, std::string line)
         advance();
       }
 
-      _tokens.emplace_back(TD_Pair{Token::STRING, value, line_no, _idx});
+      add_text(Token::STRING, value, line_no);
       break;
     }
     default:
-      if (isspace(_current_line[_idx])) {
+      if (scan::is_space(_current_line[_idx])) {
+        _idx = scan::space_end(_current_line, _idx) - 1;
         break;
       }
 
-      if (std::isdigit(_current_line[_idx])) {
+      if (scan::is_digit(_current_line[_idx])) {
+        // A single '.' may follow the leading digits. It only makes the
+        // number a float if something numeric follows it, in which case a
+        // second '.' is also swallowed before the trailing digits
         bool is_float = false;
-        std::string item;
-        while (std::isdigit(peek()) || (!is_float && peek() == '.')) {
-          item += _current_line[_idx];
-          if (_current_line[_idx] == '.') {
+        size_t start = _idx;
+        size_t end = scan::digit_end(_current_line, _idx);
+        if (end < _current_line.size() && _current_line[end] == '.') {
+          end++;
+          if (end < _current_line.size() &&
+              (scan::is_digit(_current_line[end]) ||
+               _current_line[end] == '.')) {
             is_float = true;
+            end = scan::digit_end(_current_line, end + 1);
           }
-          advance();
         }
-        item += _current_line[_idx];
+        _idx = end - 1;
+        auto item = _current_line.substr(start, end - start);
 
-        if (is_float) {
-          _tokens.emplace_back(
-              TD_Pair{Token::LITERAL_FLOAT, item, line_no, _idx});
-        }
-        else {
-          _tokens.emplace_back(
-              TD_Pair{Token::LITERAL_NUMBER, item, line_no, _idx});
-        }
+        add_number(is_float, item, line_no);
         break;
       }
 
       // Eat some word, could be a reserved word or an identifier
-      std::string word;
-      while (std::isalnum(peek()) || std::isdigit(peek()) || peek() == '_') {
-        word += _current_line[_idx];
-        advance();
-      }
-      word += _current_line[_idx];
+      size_t start = _idx;
+      _idx = scan::ident_end(_current_line, _idx + 1) - 1;
+      auto word = _current_line.substr(start, _idx - start + 1);
 
       // Check against reserved words, default to assuming its an identifier
-      if (word == "fn") {
-        _tokens.emplace_back(TD_Pair{Token::FN, {}, line_no, _idx});
-      }
-      else if (word == "while") {
-        _tokens.emplace_back(TD_Pair{Token::WHILE, {}, line_no, _idx});
-      }
-      else if (word == "for") {
-        _tokens.emplace_back(TD_Pair{Token::FOR, {}, line_no, _idx});
-      }
-      else if (word == "if") {
-        _tokens.emplace_back(TD_Pair{Token::IF, {}, line_no, _idx});
-      }
-      else if (word == "else") {
-        _tokens.emplace_back(TD_Pair{Token::ELSE, {}, line_no, _idx});
-      }
-      else if (word == "return") {
-        _tokens.emplace_back(TD_Pair{Token::RETURN, {}, line_no, _idx});
-      }
-      else if (word == "break") {
-        _tokens.emplace_back(TD_Pair{Token::BREAK, {}, line_no, _idx});
-      }
-      else if (word == "let") {
-        _tokens.emplace_back(TD_Pair{Token::LET, {}, line_no, _idx});
-      }
-      else if (word == "import") {
-        _tokens.emplace_back(TD_Pair{Token::IMPORT, {}, line_no, _idx});
+      Token reserved;
+      if (keywords.find(word, reserved)) {
+        _out->emplace_back(TD_Pair{reserved, {}, line_no, _idx});
       }
       else {
-        _tokens.emplace_back(TD_Pair{Token::IDENTIFIER, word, line_no, _idx});
+        add_text(Token::IDENTIFIER, word, line_no);
       }
       break;
     }
   }
+}
+
+void lexer::add_text(Token token, std::string_view text, size_t line_no)
+{
+  // Token text is interned so tokens and the nodes built from them
+  // can refer to it without owning a copy
+  atom id = atoms::intern(text);
+  _out->emplace_back(TD_Pair{token, atoms::text(id), line_no, _idx, id});
+}
+
+void lexer::add_number(bool is_float, std::string_view text, size_t line_no)
+{
+  // Decoding stops at anything that is not part of the number so a
+  // trailing '.' (i.e "1.") is ignored
+  literal_value value{};
+  std::from_chars_result result;
+  if (is_float) {
+    value.type = literal_type::FLOAT;
+    result =
+        std::from_chars(text.data(), text.data() + text.size(), value.real);
+  }
+  else {
+    result =
+        std::from_chars(text.data(), text.data() + text.size(), value.integer);
+    value.type = narrowest_integer(value.integer);
+  }
+
+  if (result.ec != std::errc()) {
+    std::string message = "Numeric literal out of range: ";
+    message += text;
+    report_error(error::lexer::LITERAL_OUT_OF_RANGE, line_no, message);
+
+    // Error token in its place, the parser stops when it reaches it
+    add_text(Token::ERT, text, line_no);
+    return;
+  }
+
+  add_text(is_float ? Token::LITERAL_FLOAT : Token::LITERAL_NUMBER, text,
+           line_no);
+  _out->back().value = value;
+}
+
+void lexer::report_error(uint16_t error_no, size_t line_no,
+                         const std::string &message)
+{
+  if (_quiet) {
+    return;
+  }
+  if (_hold_errors) {
+    _held.push_back({error_no, line_no, _idx, message});
+    return;
+  }
+  report({error_no, line_no, _idx, message});
+}
+
+void lexer::report(const error_report &error)
+{
+  bool show_full = !_source_name.empty() && _source_name != "repl";
 
-  return _tokens;
+  alert::config cfg;
+  cfg.set_basic(_source_name, error.message, error.line, error.col);
+  cfg.set_show_chunk(show_full);
+  cfg.set_all_attn(show_full);
+  _err.raise(error.error_no, &cfg);
 }
 
 void lexer::advance() { _idx++; }
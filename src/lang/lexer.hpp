@@ -2,8 +2,12 @@
 #define TITAN_LEXER_HPP
 
 #include <string>
+#include <string_view>
 #include <vector>
 
+#include "error/error_manager.hpp"
+
+#include "token_buffer.hpp"
 #include "tokens.hpp"
 
 namespace titan {
@@ -12,18 +16,76 @@ class lexer {
 
 public:
   lexer();
+
+  // Name of the source being lexed, used when reporting errors
+  explicit lexer(std::string source_name);
   void clear();
+
+  // Leave errors unreported. Error tokens are still produced
+  void set_quiet(bool quiet) { _quiet = quiet; }
+
+  // An error found while lexing, to be reported later on
+  struct error_report {
+    uint16_t error_no;
+    size_t line;
+    size_t col;
+    std::string message;
+  };
+
+  // Keep errors for take_errors() rather than reporting them as they are
+  // found (i.e when lexing on another thread)
+  void set_hold_errors(bool hold) { _hold_errors = hold; }
+
+  // Errors held since the last call
+  std::vector<error_report> take_errors()
+  {
+    std::vector<error_report> held;
+    held.swap(_held);
+    return held;
+  }
+
+  // Report an error as if it had just been found
+  void report(const error_report &error);
+
+  // Lex a single line of source
   std::vector<TD_Pair> lex(size_t line_no, std::string line);
 
+  // Lex an entire source buffer (i.e a mapped file) in a single pass.
+  // Lines are trimmed and '//' comment lines are skipped in place so
+  // line and column numbers match those of lexing line by line
+  std::vector<TD_Pair> lex_buffer(std::string_view source);
+
+  // Lex an entire source buffer into compact storage. The source must be
+  // no larger than token_buffer::max_source_size
+  void lex_buffer(std::string_view source, token_buffer &out);
+
+  // Incrementally lex a source buffer. The buffer must outlive the lexing.
+  // Each call to lex_next lexes whole lines until at least 'min_tokens'
+  // have been appended to 'out' or the buffer is exhausted, returning
+  // false once there is nothing left to lex
+  void load(std::string_view source);
+  bool lex_next(std::vector<TD_Pair> &out, size_t min_tokens);
+
 private:
-  std::vector<TD_Pair> _tokens;
-  struct SourceLine {
-    std::string data;
-    size_t line_no;
-  };
-  std::string _current_line;
+  std::string _source_name;
+  error::manager _err;
+  bool _quiet;
+  bool _hold_errors;
+  std::vector<error_report> _held;
+  std::vector<TD_Pair> *_out;
+  token_buffer *_buffer;
+  std::string_view _current_line;
   size_t _idx;
 
+  std::string_view _source;
+  size_t _source_pos;
+  size_t _source_line;
+
+  void lex_line(size_t line_no);
+  void add_text(Token token, std::string_view text, size_t line_no);
+  void add_number(bool is_float, std::string_view text, size_t line_no);
+  void report_error(uint16_t error_no, size_t line_no,
+                    const std::string &message);
   void advance();
   char peek(size_t ahead = 1);
 };
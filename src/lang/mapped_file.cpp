@@ -0,0 +1,99 @@
+#include "mapped_file.hpp"
+
+#ifdef _WIN32
+#include <fstream>
+#include <iterator>
+#else
+#include <fcntl.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <unistd.h>
+#endif
+
+namespace titan {
+
+mapped_file::mapped_file() : _is_open(false), _data(nullptr), _size(0) {}
+
+mapped_file::~mapped_file() { close(); }
+
+#ifdef _WIN32
+
+bool mapped_file::open(const std::string &path)
+{
+  close();
+
+  std::ifstream ifs(path, std::ios::binary);
+  if (!ifs.is_open()) {
+    return false;
+  }
+
+  _fallback.assign(std::istreambuf_iterator<char>(ifs),
+                   std::istreambuf_iterator<char>());
+  _data = _fallback.data();
+  _size = _fallback.size();
+  _is_open = true;
+  return true;
+}
+
+void mapped_file::close()
+{
+  _fallback.clear();
+  _data = nullptr;
+  _size = 0;
+  _is_open = false;
+}
+
+#else
+
+bool mapped_file::open(const std::string &path)
+{
+  close();
+
+  int fd = ::open(path.c_str(), O_RDONLY);
+  if (fd < 0) {
+    return false;
+  }
+
+  struct stat st;
+  if (::fstat(fd, &st) != 0) {
+    ::close(fd);
+    return false;
+  }
+
+  // Empty files can not be mapped, but they are still valid (empty) input
+  if (st.st_size == 0) {
+    ::close(fd);
+    _is_open = true;
+    return true;
+  }
+
+  void *mapped = ::mmap(nullptr, static_cast<size_t>(st.st_size), PROT_READ,
+                        MAP_PRIVATE, fd, 0);
+  ::close(fd);
+
+  if (mapped == MAP_FAILED) {
+    return false;
+  }
+
+  // The lexer makes a single forward pass over the data
+  ::madvise(mapped, static_cast<size_t>(st.st_size), MADV_SEQUENTIAL);
+
+  _data = static_cast<const char *>(mapped);
+  _size = static_cast<size_t>(st.st_size);
+  _is_open = true;
+  return true;
+}
+
+void mapped_file::close()
+{
+  if (_data && _size) {
+    ::munmap(const_cast<char *>(_data), _size);
+  }
+  _data = nullptr;
+  _size = 0;
+  _is_open = false;
+}
+
+#endif
+
+} // namespace titan
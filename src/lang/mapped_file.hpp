@@ -0,0 +1,43 @@
+#ifndef TITAN_MAPPED_FILE_HPP
+#define TITAN_MAPPED_FILE_HPP
+
+#include <string>
+#include <string_view>
+
+namespace titan {
+
+//  Read-only view of an entire file on disk. On POSIX systems the file
+//  is memory mapped so the lexer can walk it without copying it into
+//  a string first.
+//
+class mapped_file {
+public:
+  mapped_file();
+  ~mapped_file();
+
+  mapped_file(const mapped_file &) = delete;
+  mapped_file &operator=(const mapped_file &) = delete;
+
+  // Map the given file. Returns false if the file could not be opened
+  bool open(const std::string &path);
+
+  // Release the mapping (called automatically on destruction)
+  void close();
+
+  bool is_open() const { return _is_open; }
+
+  // The full contents of the file
+  std::string_view view() const { return {_data, _size}; }
+
+private:
+  bool _is_open;
+  const char *_data;
+  size_t _size;
+#ifdef _WIN32
+  std::string _fallback;
+#endif
+};
+
+} // namespace titan
+
+#endif
@@ -0,0 +1,168 @@
+#include "module_cache.hpp"
+
+#include "flat_ast.hpp"
+#include "mapped_file.hpp"
+
+#include <cstring>
+#include <filesystem>
+#include <fstream>
+#include <random>
+#include <string_view>
+
+namespace titan {
+namespace module_cache {
+
+namespace {
+
+struct header {
+  char magic[4];
+  uint32_t version;
+  uint64_t source_size;
+  uint64_t source_hash;
+  uint32_t name_length;
+  uint32_t imports;
+};
+
+constexpr char magic[4] = {'T', 'L', 'C', '\0'};
+
+// Eight bytes at a time, mixing the high bits back down after each word
+uint64_t hash_bytes(std::string_view bytes)
+{
+  constexpr uint64_t prime = 0x9E3779B97F4A7C15ull;
+  uint64_t h = 0xCBF29CE484222325ull ^ bytes.size();
+
+  size_t idx = 0;
+  for (; idx + 8 <= bytes.size(); idx += 8) {
+    uint64_t word;
+    std::memcpy(&word, bytes.data() + idx, 8);
+    h = (h ^ word) * prime;
+    h ^= h >> 29;
+  }
+  for (; idx < bytes.size(); idx++) {
+    h = (h ^ static_cast<unsigned char>(bytes[idx])) * prime;
+    h ^= h >> 29;
+  }
+  return h;
+}
+
+} // namespace
+
+bool key_of(const std::string &path, key &k)
+{
+  mapped_file source;
+  if (!source.open(path)) {
+    return false;
+  }
+  k.size = source.view().size();
+  k.hash = hash_bytes(source.view());
+  return true;
+}
+
+std::string cache_path(const std::string &path)
+{
+  return std::filesystem::path(path).replace_extension(".tlc").string();
+}
+
+bool load(const std::string &path, const std::string &name, const key &k,
+          arena &nodes, imports::preloaded_module &module)
+{
+  mapped_file file;
+  if (!file.open(cache_path(path))) {
+    return false;
+  }
+
+  auto bytes = file.view();
+  header h;
+  if (bytes.size() < sizeof(h)) {
+    return false;
+  }
+  std::memcpy(&h, bytes.data(), sizeof(h));
+  bytes.remove_prefix(sizeof(h));
+
+  if (std::memcmp(h.magic, magic, sizeof(magic)) != 0 ||
+      h.version != format_version || h.source_size != k.size ||
+      h.source_hash != k.hash || h.name_length != name.size() ||
+      bytes.substr(0, h.name_length) != name) {
+    return false;
+  }
+  bytes.remove_prefix(h.name_length);
+
+  // Checked before the count is trusted with an allocation
+  if (bytes.size() / sizeof(imports::pending_import) < h.imports) {
+    return false;
+  }
+  std::vector<imports::pending_import> pending(h.imports);
+  auto pending_bytes = pending.size() * sizeof(imports::pending_import);
+  if (pending_bytes != 0) {
+    std::memcpy(pending.data(), bytes.data(), pending_bytes);
+  }
+  bytes.remove_prefix(pending_bytes);
+
+  flat_ast ast;
+  if (!ast.read(bytes)) {
+    return false;
+  }
+
+  // Every pending import has to be one of the module's imports
+  auto roots = ast.roots();
+  for (auto &p : pending) {
+    if (p.index >= roots.size() ||
+        ast.at(roots[p.index]).type != flat_ast::kind::IMPORT) {
+      return false;
+    }
+  }
+
+  module.tokens = nullptr;
+  module.items = ast.expand(nodes);
+  module.imports = std::move(pending);
+  module.okay = true;
+  return true;
+}
+
+void store(const std::string &path, const std::string &name, const key &k,
+           const imports::preloaded_module &module)
+{
+  // Items the flat form has no node for would throw the imports' indices off
+  flat_ast ast(module.items);
+  if (ast.roots().size() != module.items.size()) {
+    return;
+  }
+
+  // Cleared first so the same module always writes the same bytes
+  header h;
+  std::memset(&h, 0, sizeof(h));
+  std::memcpy(h.magic, magic, sizeof(magic));
+  h.version = format_version;
+  h.source_size = k.size;
+  h.source_hash = k.hash;
+  h.name_length = static_cast<uint32_t>(name.size());
+  h.imports = static_cast<uint32_t>(module.imports.size());
+
+  std::string out(reinterpret_cast<const char *>(&h), sizeof(h));
+  out.append(name);
+  out.append(reinterpret_cast<const char *>(module.imports.data()),
+             module.imports.size() * sizeof(imports::pending_import));
+  ast.write(out);
+
+  // Written aside and moved into place so a reader never sees part of it
+  auto target = cache_path(path);
+  auto temporary = target + "." + std::to_string(std::random_device{}());
+  {
+    std::ofstream file(temporary, std::ios::binary | std::ios::trunc);
+    if (!file.write(out.data(), static_cast<std::streamsize>(out.size()))) {
+      file.close();
+      std::error_code ec;
+      std::filesystem::remove(temporary, ec);
+      return;
+    }
+  }
+
+  std::error_code ec;
+  std::filesystem::rename(temporary, target, ec);
+  if (ec) {
+    std::filesystem::remove(temporary, ec);
+  }
+}
+
+} // namespace module_cache
+} // namespace titan
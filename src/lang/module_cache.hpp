@@ -0,0 +1,54 @@
+#ifndef TITAN_MODULE_CACHE_HPP
+#define TITAN_MODULE_CACHE_HPP
+
+#include "arena.hpp"
+#include "imports.hpp"
+
+#include <cstdint>
+#include <string>
+
+namespace titan {
+namespace module_cache {
+
+//  Parsed modules kept on disk between runs, each in a .tlc file beside its
+//  source.
+//
+//  A cache file holds the module's own items with its imports left in place,
+//  as a preloaded module has them (see imports.hpp), in the form written by
+//  flat_ast. Nothing in it depends on the modules it imports; they are
+//  looked up, and their own caches checked, as the imports are expanded.
+//  So a cache only has to match the bytes of its own source, which are
+//  checked by size and hash each time it is loaded, and the name the module
+//  was parsed under (functions record it as their file).
+//
+//  Only the parsed form is cached. Analysis always runs again on what is
+//  loaded, as whether a module is sound depends on what it imports
+//
+struct key {
+  uint64_t size;
+  uint64_t hash;
+};
+
+// Bumped whenever what is written changes shape
+static constexpr uint32_t format_version = 1;
+
+// Key of the source at 'path'. Returns false if it can not be read
+extern bool key_of(const std::string &path, key &k);
+
+// Where the cache for the source at 'path' is kept
+extern std::string cache_path(const std::string &path);
+
+// Load the module cached for 'path' into 'nodes'. Fails if there is no
+// cache or it was stored for another key or name
+extern bool load(const std::string &path, const std::string &name,
+                 const key &k, arena &nodes, imports::preloaded_module &module);
+
+// Store a module parsed from the source with key 'k'. A cache that can not
+// be written is left alone, the module is simply parsed again next time
+extern void store(const std::string &path, const std::string &name,
+                  const key &k, const imports::preloaded_module &module);
+
+} // namespace module_cache
+} // namespace titan
+
+#endif
@@ -4,184 +4,179 @@
 #include "alert/alert.hpp"
 #include "app.hpp"
 #include "log/log.hpp"
+#include "jobs/jobs.hpp"
+#include "module_cache.hpp"
 
 #include <algorithm>
-#include <filesystem>
 #include <iostream>
 #include <iterator>
-#include <sstream>
+#include <memory>
 #include <tuple>
-#include <unordered_map>
+#include <unordered_set>
 
 namespace titan {
 
 namespace {
 
-std::unordered_map<Token, parser::precedence> precedences = {
-    {Token::EQ, parser::precedence::ASSIGN},
-    {Token::EQ_EQ, parser::precedence::EQUALS},
-    {Token::ADD_EQ, parser::precedence::EQUALS},
-    {Token::SUB_EQ, parser::precedence::EQUALS},
-    {Token::DIV_EQ, parser::precedence::EQUALS},
-    {Token::MUL_EQ, parser::precedence::EQUALS},
-    {Token::MOD_EQ, parser::precedence::EQUALS},
-    {Token::POW_EQ, parser::precedence::EQUALS},
-    {Token::LSH_EQ, parser::precedence::EQUALS},
-    {Token::RSH_EQ, parser::precedence::EQUALS},
-    {Token::HAT_EQ, parser::precedence::EQUALS},
-    {Token::PIPE_EQ, parser::precedence::EQUALS},
-    {Token::TILDE_EQ, parser::precedence::EQUALS},
-    {Token::AMPERSAND_EQ, parser::precedence::EQUALS},
-    {Token::EXCLAMATION_EQ, parser::precedence::EQUALS},
-    {Token::LT, parser::precedence::LESS_GREATER},
-    {Token::GT, parser::precedence::LESS_GREATER},
-    {Token::LTE, parser::precedence::LESS_GREATER},
-    {Token::GTE, parser::precedence::LESS_GREATER},
-    {Token::RSH, parser::precedence::SHIFT},
-    {Token::LSH, parser::precedence::SHIFT},
-    {Token::ADD, parser::precedence::SUM},
-    {Token::SUB, parser::precedence::SUM},
-    {Token::DIV, parser::precedence::PROD},
-    {Token::MUL, parser::precedence::PROD},
-    {Token::MOD, parser::precedence::PROD},
-    {Token::POW, parser::precedence::POW},
-    {Token::AMPERSAND, parser::precedence::BITWISE},
-    {Token::HAT, parser::precedence::BITWISE},
-    {Token::TILDE, parser::precedence::BITWISE},
-    {Token::OR, parser::precedence::LOGICAL},
-    {Token::AND, parser::precedence::LOGICAL},
-    {Token::PIPE, parser::precedence::LOGICAL},
-    {Token::L_PAREN, parser::precedence::CALL},
-    {Token::L_BRACKET, parser::precedence::INDEX},
-};
-
-TD_Pair error_token = {Token::ERT, {}, 0};
-TD_Pair end_of_stream = {Token::EOS, {}, 0};
+TD_Pair error_token = {Token::ERT, {}, 0, 0};
+
+// Segments handed out per job when a file is split, so threads that finish
+// early can pick up more work
+constexpr size_t segments_per_job = 4;
+
+// Smallest segment worth a parse of its own
+constexpr size_t min_segment_tokens = 2048;
 
 } // namespace
 
-parser::parser(imports &file_imports)
-    : _parser_okay(true), _idx(0), _mark(std::numeric_limits<uint64_t>::max()),
-      _file_imports(file_imports), _err("parser")
+constexpr parser::parse_rules parser::build_rules()
 {
+  parse_rules table{};
+  for (auto &entry : table) {
+    entry = {prefix_form::NONE, infix_form::NONE, precedence::LOWEST};
+  }
+
+  auto prefix = [&](Token t, prefix_form form) {
+    table[static_cast<size_t>(t)].prefix = form;
+  };
+  auto infix = [&](Token t, precedence p, infix_form form) {
+    table[static_cast<size_t>(t)].infix = form;
+    table[static_cast<size_t>(t)].binding = p;
+  };
+
+  prefix(Token::IDENTIFIER, prefix_form::IDENTIFIER);
+  prefix(Token::LITERAL_NUMBER, prefix_form::NUMBER);
+  prefix(Token::LITERAL_FLOAT, prefix_form::NUMBER);
+  prefix(Token::STRING, prefix_form::STRING);
+  prefix(Token::EXCLAMATION, prefix_form::OPERATOR);
+  prefix(Token::TILDE, prefix_form::OPERATOR);
+  prefix(Token::SUB, prefix_form::OPERATOR);
+  prefix(Token::L_PAREN, prefix_form::GROUP);
+  prefix(Token::L_BRACE, prefix_form::ARRAY);
+
+  infix(Token::EQ, precedence::ASSIGN, infix_form::OPERATOR);
+  infix(Token::EQ_EQ, precedence::EQUALS, infix_form::OPERATOR);
+  infix(Token::ADD_EQ, precedence::EQUALS, infix_form::OPERATOR);
+  infix(Token::SUB_EQ, precedence::EQUALS, infix_form::OPERATOR);
+  infix(Token::DIV_EQ, precedence::EQUALS, infix_form::OPERATOR);
+  infix(Token::MUL_EQ, precedence::EQUALS, infix_form::OPERATOR);
+  infix(Token::MOD_EQ, precedence::EQUALS, infix_form::OPERATOR);
+  infix(Token::POW_EQ, precedence::EQUALS, infix_form::OPERATOR);
+  infix(Token::LSH_EQ, precedence::EQUALS, infix_form::OPERATOR);
+  infix(Token::RSH_EQ, precedence::EQUALS, infix_form::OPERATOR);
+  infix(Token::HAT_EQ, precedence::EQUALS, infix_form::OPERATOR);
+  infix(Token::PIPE_EQ, precedence::EQUALS, infix_form::OPERATOR);
+  infix(Token::TILDE_EQ, precedence::EQUALS, infix_form::OPERATOR);
+  infix(Token::AMPERSAND_EQ, precedence::EQUALS, infix_form::OPERATOR);
+  infix(Token::EXCLAMATION_EQ, precedence::EQUALS, infix_form::OPERATOR);
+  infix(Token::LT, precedence::LESS_GREATER, infix_form::OPERATOR);
+  infix(Token::GT, precedence::LESS_GREATER, infix_form::OPERATOR);
+  infix(Token::LTE, precedence::LESS_GREATER, infix_form::OPERATOR);
+  infix(Token::GTE, precedence::LESS_GREATER, infix_form::OPERATOR);
+  infix(Token::RSH, precedence::SHIFT, infix_form::OPERATOR);
+  infix(Token::LSH, precedence::SHIFT, infix_form::OPERATOR);
+  infix(Token::ADD, precedence::SUM, infix_form::OPERATOR);
+  infix(Token::SUB, precedence::SUM, infix_form::OPERATOR);
+  infix(Token::DIV, precedence::PROD, infix_form::OPERATOR);
+  infix(Token::MUL, precedence::PROD, infix_form::OPERATOR);
+  infix(Token::MOD, precedence::PROD, infix_form::OPERATOR);
+  infix(Token::POW, precedence::POW, infix_form::OPERATOR);
+  infix(Token::AMPERSAND, precedence::BITWISE, infix_form::OPERATOR);
+  infix(Token::HAT, precedence::BITWISE, infix_form::OPERATOR);
+  infix(Token::OR, precedence::LOGICAL, infix_form::OPERATOR);
+  infix(Token::AND, precedence::LOGICAL, infix_form::OPERATOR);
+  infix(Token::PIPE, precedence::LOGICAL, infix_form::OPERATOR);
+  infix(Token::L_PAREN, precedence::CALL, infix_form::CALL);
+  infix(Token::L_BRACKET, precedence::INDEX, infix_form::INDEX);
+
+  // '~' binds like the other bitwise operators but is only a prefix
+  // operator, so an expression ends when it follows one
+  table[static_cast<size_t>(Token::TILDE)].binding = precedence::BITWISE;
+
+  return table;
 }
 
-std::vector<instructions::instruction_ptr>
-parser::parse(std::string source_name, std::vector<TD_Pair> &tokens)
+const parser::parse_rules parser::rules = parser::build_rules();
+
+parser::parser(imports &file_imports, arena &nodes)
+    : _parser_okay(true), _quiet(false), _jobs(1), _skip_bodies(false),
+      _lazy_imports(false), _preload(true), _defer_imports(false),
+      _cache(false),
+      _file_imports(file_imports), _nodes(nodes),
+      _err("parser"), _tokens(nullptr), _token_visits(0)
 {
-  _parser_okay = true;
-  _idx = 0;
-  _mark = std::numeric_limits<uint64_t>::max();
+}
 
-  _tokens = tokens;
-  _source_name = source_name;
+std::vector<instructions::instruction_ptr>
+parser::parse(std::string source_name, token_stream &tokens)
+{
+  // Imports are loaded and top level items of a whole file are parsed
+  // side by side
+  if (auto buffer = tokens.whole_buffer(); buffer && _jobs > 1) {
+    if (_preload) {
+      preload_imports(*buffer);
+    }
 
+    auto segments = split_top_level(*buffer, _jobs * segments_per_job);
+    if (segments.size() > 1) {
+      return parse_split(source_name, *buffer, segments);
+    }
+  }
 
-  std::cout << "TOKENS : " << tokens.size() << std::endl;
-
-  _prefix_fns[Token::IDENTIFIER] = &parser::identifier;
-  _prefix_fns[Token::LITERAL_NUMBER] = &parser::number;
-  _prefix_fns[Token::LITERAL_FLOAT] = &parser::number;
-  _prefix_fns[Token::STRING] = &parser::str;
-  _prefix_fns[Token::EXCLAMATION] = &parser::prefix_expr;
-  _prefix_fns[Token::TILDE] = &parser::prefix_expr;
-  _prefix_fns[Token::SUB] = &parser::prefix_expr;
-  _prefix_fns[Token::L_PAREN] = &parser::grouped_expr;
-  _prefix_fns[Token::L_BRACE] = &parser::array;
-
-  _infix_fns[Token::ADD] = &parser::infix_expr;
-  _infix_fns[Token::SUB] = &parser::infix_expr;
-  _infix_fns[Token::DIV] = &parser::infix_expr;
-  _infix_fns[Token::MUL] = &parser::infix_expr;
-  _infix_fns[Token::MOD] = &parser::infix_expr;
-  _infix_fns[Token::EQ] = &parser::infix_expr;
-  _infix_fns[Token::EQ_EQ] = &parser::infix_expr;
-  _infix_fns[Token::ADD_EQ] = &parser::infix_expr;
-  _infix_fns[Token::SUB_EQ] = &parser::infix_expr;
-  _infix_fns[Token::DIV_EQ] = &parser::infix_expr;
-  _infix_fns[Token::MUL_EQ] = &parser::infix_expr;
-  _infix_fns[Token::MOD_EQ] = &parser::infix_expr;
-  _infix_fns[Token::POW_EQ] = &parser::infix_expr;
-  _infix_fns[Token::AMPERSAND_EQ] = &parser::infix_expr;
-  _infix_fns[Token::HAT_EQ] = &parser::infix_expr;
-  _infix_fns[Token::PIPE_EQ] = &parser::infix_expr;
-  _infix_fns[Token::TILDE_EQ] = &parser::infix_expr;
-  _infix_fns[Token::LSH_EQ] = &parser::infix_expr;
-  _infix_fns[Token::RSH_EQ] = &parser::infix_expr;
-  _infix_fns[Token::EXCLAMATION_EQ] = &parser::infix_expr;
-  _infix_fns[Token::LT] = &parser::infix_expr;
-  _infix_fns[Token::LTE] = &parser::infix_expr;
-  _infix_fns[Token::GT] = &parser::infix_expr;
-  _infix_fns[Token::GTE] = &parser::infix_expr;
-  _infix_fns[Token::RSH] = &parser::infix_expr;
-  _infix_fns[Token::LSH] = &parser::infix_expr;
-  _infix_fns[Token::POW] = &parser::infix_expr;
-  _infix_fns[Token::OR] = &parser::infix_expr;
-  _infix_fns[Token::AND] = &parser::infix_expr;
-  _infix_fns[Token::PIPE] = &parser::infix_expr;
-  _infix_fns[Token::HAT] = &parser::infix_expr;
-  _infix_fns[Token::AMPERSAND] = &parser::infix_expr;
-  _infix_fns[Token::L_PAREN] = &parser::call_expr;
-  _infix_fns[Token::L_BRACKET] = &parser::index_expr;
+  _parser_okay = true;
+  _tokens = &tokens;
+  _token_visits = 0;
+  _source_name = source_name;
+  _deferred_imports.clear();
 
   std::vector<instructions::instruction_ptr> top_level_items;
 
-  while (_parser_okay && _idx < _tokens.size()) {
-
-    /*
-       Check for an import statement
-       */
-    if (auto import_instruction = parser::import()) {
+  while (_parser_okay && !_tokens->at_end()) {
 
-      if (!_parser_okay) {
+    // The leading token decides what the item is
+    switch (current_td_pair().token) {
+    case Token::IMPORT: {
+      auto import_instruction = parser::import();
+      if (!import_instruction || !_parser_okay) {
         break;
       }
 
-      auto [item_found, target_item] =
-          locate_import(_file_imports.include_directories, import_instruction->target);
+      // Errors about the import point at whatever follows it
+      size_t line = current_td_pair().line;
+      size_t col = current_td_pair().col;
 
-      if (!item_found) {
-        std::string message =
-            "Unable to locate import target: " + import_instruction->target;
-        die(error::parser::UNABLE_TO_LOCATE_IMPORT, message);
+      if (_defer_imports) {
+        _deferred_imports.push_back({top_level_items.size(), line, col});
+        top_level_items.push_back(import_instruction);
         break;
       }
 
-      std::vector<TD_Pair> imported_tokens = _file_imports.import_file(target_item);
-
-      parser import_parser(_file_imports);
-
-      auto parsed_file = import_parser.parse(target_item, imported_tokens);
-
-      if (!import_parser.is_okay()) {
-        _parser_okay = false;
-        break;
-      }
-
-      // Add it to our top level objects
-      top_level_items.insert(top_level_items.end(),
-                             std::make_move_iterator(parsed_file.begin()),
-                             std::make_move_iterator(parsed_file.end()));
-      tokens.clear();
+      import_module(import_instruction->target, line, col, top_level_items);
+      break;
     }
 
-    /*
-       Check for a function declaration
-       */
-    else if (auto function_instruction = parser::function()) {
-
-      top_level_items.push_back(std::move(function_instruction));
-    }
-    else if (auto statement = parser::statement() ) {
+    case Token::FN:
+      if (auto function_instruction = parser::function()) {
+        top_level_items.push_back(function_instruction);
+      }
+      break;
 
-      top_level_items.push_back(std::move(statement));
+    default:
+      if (auto statement = parser::statement()) {
+        top_level_items.push_back(statement);
+      }
+      else if (_parser_okay) {
+        die(error::parser::INVALID_TL_ITEM, "");
+      }
+      break;
     }
-    else {
-      die(error::parser::INVALID_TL_ITEM, "");
-    };
   }
 
-  _tokens.clear();
+  LOG(DEBUG) << TAG(APP_FILE_NAME) << "[" << APP_LINE << "]: Parsed "
+             << _tokens->position() << " tokens from " << _source_name
+             << " with " << _token_visits << " token visits" << std::endl;
+
+  _tokens = nullptr;
 
   if (!_parser_okay) {
     top_level_items.clear();
@@ -193,6 +188,11 @@ parser::parse(std::string source_name, std::vector<TD_Pair> &tokens)
 void parser::report_error(uint64_t error_no, size_t line, size_t col,
                           const std::string msg, bool show_full)
 {
+   if (_quiet) {
+     _parser_okay = false;
+     return;
+   }
+
    if(_source_name == "repl") {
      show_full = false;
    }
@@ -204,39 +204,30 @@ void parser::report_error(uint64_t error_no, size_t line, size_t col,
   _err.raise(error_no, &cfg);
   _parser_okay = false;
 }
-void parser::prev() { _idx--; }
-
-void parser::advance() { _idx++; }
+void parser::advance() { _tokens->advance(); }
 
-void parser::mark() { _mark = _idx; }
+void parser::mark() { _tokens->mark(); }
 
-void parser::unset() { _mark = std::numeric_limits<uint64_t>::max(); }
+void parser::unset() { _tokens->unset(); }
 
 const TD_Pair &parser::current_td_pair() const
 {
-  if (_idx >= _tokens.size()) {
+  _token_visits++;
+  if (_tokens->at_end()) {
     LOG(DEBUG) << TAG(APP_FILE_NAME) << "[" << APP_LINE
                << "]: End of token stream" << std::endl;
     return error_token;
   }
 
-  return _tokens.at(_idx);
+  return _tokens->peek();
 }
 
 void parser::reset()
 {
-  if (_mark > _idx) {
+  if (!_tokens->reset()) {
     _err.raise(error::parser::INTERNAL_MARK_UNSET);
     _parser_okay = false;
-    unset(); // ensure its set to max, not some other num
-    return;
   }
-
-  while (_idx != _mark) {
-    prev();
-  }
-
-  unset();
 }
 
 void parser::die(uint64_t error_no, std::string error)
@@ -258,20 +249,13 @@ void parser::expect(Token token, std::string error, size_t ahead)
 
 const TD_Pair &parser::peek(size_t ahead) const
 {
-  if (_idx + ahead >= _tokens.size()) {
+  _token_visits++;
+  auto &td = _tokens->peek(ahead);
+  if (td.token == Token::EOS) {
     LOG(DEBUG) << TAG(APP_FILE_NAME) << "[" << APP_LINE
                << "]: End of token stream" << std::endl;
-    return end_of_stream;
   }
-  return _tokens.at(_idx + ahead);
-}
-
-parser::precedence parser::peek_precedence()
-{
-  if (precedences.find(peek().token) != precedences.end()) {
-    return precedences[peek().token];
-  }
-  return parser::precedence::LOWEST;
+  return td;
 }
 
 instructions::import_ptr parser::import()
@@ -287,9 +271,9 @@ instructions::import_ptr parser::import()
   advance();
 
   if (_parser_okay) {
-    auto target = current_td_pair().data;
+    auto target = std::string(current_td_pair().data);
     advance();
-    return instructions::import_ptr(new instructions::import(target, line, col));
+    return _nodes.make<instructions::import>(target, line, col);
   }
   else {
     return nullptr;
@@ -307,7 +291,7 @@ instructions::instruction_ptr parser::function()
 
   advance();
   expect(Token::IDENTIFIER, "Expected function name following 'fn'");
-  std::string function_name = current_td_pair().data;
+  atom function_name = current_td_pair().id;
 
   advance();
   std::vector<instructions::variable_ptr> parameters = function_params();
@@ -318,35 +302,100 @@ instructions::instruction_ptr parser::function()
   advance();
   expect(Token::IDENTIFIER,
          "Expected return type following '->' in function declaration");
-  std::string return_type = current_td_pair().data;
+  auto return_type = current_td_pair().data;
 
   advance();
 
   auto [return_depth, segments] = accessor_lit();
 
-  std::vector<instructions::instruction_ptr> instruction_list = statements();
+  std::function<bool(instructions::function &)> body_parser;
+  if (_skip_bodies && _parser_okay) {
+    body_parser = skip_body();
+  }
+
+  std::vector<instructions::instruction_ptr> instruction_list;
+  if (!body_parser) {
+    instruction_list = statements();
+  }
 
   if (!_parser_okay) {
     return nullptr;
   }
 
-  auto new_func = new instructions::function(line, col);
+  auto new_func = _nodes.make<instructions::function>(line, col);
 
-  new_func->name = function_name;
+  new_func->id = function_name;
+  new_func->name = atoms::text(function_name);
   new_func->file_name = _source_name;
 
-  new_func->return_data = instructions::variable_ptr(
-      new instructions::built_in_variable(
-        "return_data",
-        instructions::string_to_variable_type(return_type),
-        return_depth,
-        segments)
-      );
+  new_func->return_data = _nodes.make<instructions::built_in_variable>(
+      "return_data", instructions::string_to_variable_type(return_type),
+      return_depth, segments);
 
   new_func->parameters = std::move(parameters);
   new_func->instruction_list = std::move(instruction_list);
+  new_func->parse_body = std::move(body_parser);
+
+  return new_func;
+}
+
+//  Step over a function body by matching its braces, leaving the stream
+//  after the closing one. Returns what parses the body later on, or nothing
+//  if the body has to be parsed now: the stream has no token buffer behind
+//  it or the braces don't match within it
+//
+std::function<bool(instructions::function &)> parser::skip_body()
+{
+  size_t first = 0;
+  size_t last = 0;
+  auto buffer = _tokens->backing_buffer(first, last);
+  if (!buffer || current_td_pair().token != Token::L_BRACE) {
+    return {};
+  }
+
+  size_t begin = first + _tokens->position();
+  size_t end = begin;
+  size_t depth = 0;
+  for (; end < last; end++) {
+    auto kind = buffer->kind(end);
+    if (kind == Token::L_BRACE) {
+      depth++;
+    }
+    else if (kind == Token::R_BRACE && --depth == 0) {
+      end++;
+      break;
+    }
+  }
+  if (depth > 0) {
+    return {};
+  }
+
+  _tokens->skip(end - begin);
+
+  return [&file_imports = _file_imports, &nodes = _nodes, buffer, begin, end,
+          source_name = _source_name](instructions::function &fn) {
+    parser body_parser(file_imports, nodes);
+    return body_parser.parse_body(source_name, *buffer, begin, end, fn);
+  };
+}
+
+bool parser::parse_body(const std::string &source_name,
+                        const token_buffer &tokens, size_t begin, size_t end,
+                        instructions::function &fn)
+{
+  buffer_token_stream body(tokens, begin, end);
+  _parser_okay = true;
+  _tokens = &body;
+  _source_name = source_name;
+
+  auto instruction_list = statements();
+  _tokens = nullptr;
 
-  return instructions::instruction_ptr(new_func);
+  if (!_parser_okay) {
+    return false;
+  }
+  fn.instruction_list = std::move(instruction_list);
+  return true;
 }
 
 std::vector<instructions::variable_ptr> parser::function_params()
@@ -369,7 +418,7 @@ std::vector<instructions::variable_ptr> parser::function_params()
 
     advance();
     expect(Token::IDENTIFIER, "Expected variable name for parameter");
-    std::string param_name = current_td_pair().data;
+    atom param_name = current_td_pair().id;
 
     advance();
     expect(Token::COLON,
@@ -383,16 +432,8 @@ std::vector<instructions::variable_ptr> parser::function_params()
     advance();
     auto [depth, segments] = accessor_lit();
     
-    parameters.emplace_back(
-        instructions::variable_ptr(
-          new instructions::built_in_variable(
-            param_name,
-            param_v_type,
-            depth,
-            segments
-            )
-          )
-        );
+    parameters.emplace_back(_nodes.make<instructions::built_in_variable>(
+        param_name, param_v_type, depth, segments));
 
     if (current_td_pair().token != Token::COMMA) {
       eat_params = false;
@@ -435,7 +476,7 @@ std::vector<instructions::instruction_ptr> parser::statements()
 
     // If a new item was gotten, add it to the list
     if (new_instruction) {
-      instructions.emplace_back(std::move(new_instruction));
+      instructions.emplace_back(new_instruction);
     }
     else {
       check_for_instruction = false;
@@ -463,9 +504,7 @@ std::tuple<uint64_t, std::vector<uint64_t>> parser::accessor_lit()
       advance();
       expect(Token::LITERAL_NUMBER, "Literal number expected");
     
-      uint64_t current = 1;
-      std::istringstream iss(current_td_pair().data);
-      iss >> current;
+      uint64_t current = current_td_pair().value.integer;
 
       depth *= current;
       segments.push_back(current);
@@ -484,29 +523,25 @@ std::tuple<uint64_t, std::vector<uint64_t>> parser::accessor_lit()
   return { depth, segments };
 }
 
+//  Statements are told apart by their leading token alone, anything
+//  without a keyword of its own is an expression
+//
 instructions::instruction_ptr parser::statement()
 {
-  if (instructions::instruction_ptr item = parser::assignment()) {
-    return item;
-  }
-  if (instructions::instruction_ptr item = parser::if_instruction()) {
-    return item;
-  }
-  if (instructions::instruction_ptr item = parser::while_instruction()) {
-    return item;
-  }
-  if (instructions::instruction_ptr item = parser::for_instruction()) {
-    return item;
+  switch (current_td_pair().token) {
+  case Token::LET:
+    return parser::assignment();
+  case Token::IF:
+    return parser::if_instruction();
+  case Token::WHILE:
+    return parser::while_instruction();
+  case Token::FOR:
+    return parser::for_instruction();
+  case Token::RETURN:
+    return parser::return_instruction();
+  default:
+    return parser::expression_instruction();
   }
-  if (instructions::instruction_ptr item = parser::return_instruction()) {
-    return item;
-  }
-
-  // This should be last checked
-  if (instructions::instruction_ptr item = parser::expression_instruction()) {
-    return item;
-  }
-  return nullptr;
 }
 
 instructions::instruction_ptr parser::assignment()
@@ -517,7 +552,7 @@ instructions::instruction_ptr parser::assignment()
 
   advance();
   expect(Token::IDENTIFIER, "Expected variable name in assignmnet");
-  std::string name = current_td_pair().data;
+  atom name = current_td_pair().id;
   size_t line_no = current_td_pair().line;
   size_t col = current_td_pair().col;
 
@@ -542,16 +577,10 @@ instructions::instruction_ptr parser::assignment()
 
   advance();
   if (_parser_okay) {
-    return instructions::instruction_ptr(
-        new instructions::assignment_instruction(
-          line_no, 
-          col,
-          instructions::variable_ptr(new instructions::built_in_variable(
-            name,
-            variable_type,
-            depth,
-            segments)),
-        std::move(exp)));
+    auto var = _nodes.make<instructions::built_in_variable>(
+        name, variable_type, depth, segments);
+    return _nodes.make<instructions::assignment_instruction>(line_no, col, var,
+                                                             exp);
   }
 
   return nullptr;
@@ -575,8 +604,7 @@ instructions::instruction_ptr parser::if_instruction()
     return nullptr;
   }
 
-  auto if_stmt =
-      instructions::if_instruction_ptr(new instructions::if_instruction(line_no, col));
+  auto if_stmt = _nodes.make<instructions::if_instruction>(line_no, col);
 
   bool construct_segments = true;
 
@@ -589,7 +617,7 @@ instructions::instruction_ptr parser::if_instruction()
     }
 
     if_stmt->segments.emplace_back(instructions::if_instruction::segment(
-        std::move(condition), std::move(if_body)));
+        condition, std::move(if_body)));
 
     if (current_td_pair().token == Token::ELSE) {
 
@@ -609,9 +637,9 @@ instructions::instruction_ptr parser::if_instruction()
       else {
 
         // TRUE for last else statement
-        condition = instructions::expr_ptr(new instructions::raw_int_expr(
+        condition = _nodes.make<instructions::raw_int_expr>(
             current_td_pair().line, current_td_pair().col, "1",
-            instructions::variable_types::U8, 1));
+            instructions::variable_types::U8, 1);
       }
     }
     else {
@@ -650,8 +678,8 @@ instructions::instruction_ptr parser::while_instruction()
     return nullptr;
   }
 
-  return instructions::instruction_ptr(new instructions::while_instruction(
-      line_no, col, std::move(condition), std::move(body)));
+  return _nodes.make<instructions::while_instruction>(
+      line_no, col, condition, std::move(body));
 }
 
 instructions::instruction_ptr parser::for_instruction()
@@ -700,9 +728,9 @@ instructions::instruction_ptr parser::for_instruction()
     return nullptr;
   }
 
-  return instructions::instruction_ptr(new instructions::for_instruction(
-      line_no, col, std::move(assignment), std::move(conditional),
-      std::move(modifier), std::move(body)));
+  return _nodes.make<instructions::for_instruction>(
+      line_no, col, assignment, conditional,
+      modifier, std::move(body));
 }
 
 instructions::instruction_ptr parser::return_instruction()
@@ -728,8 +756,8 @@ instructions::instruction_ptr parser::return_instruction()
   }
   else if (current_td_pair().token == Token::SEMICOLON) {
     advance();
-    return instructions::instruction_ptr(
-        new instructions::return_instruction(line_no, col, nullptr));
+    return _nodes.make<instructions::return_instruction>(line_no, col,
+                                                         nullptr);
   }
   else {
     return_expr = parser::expression(parser::precedence::LOWEST);
@@ -742,8 +770,8 @@ instructions::instruction_ptr parser::return_instruction()
     return nullptr;
   }
 
-  return instructions::instruction_ptr(
-      new instructions::return_instruction(line_no, col, std::move(return_expr)));
+  return _nodes.make<instructions::return_instruction>(line_no, col,
+                                                       return_expr);
 }
 
 // Expects expression to exist, if not this will kill the parser
@@ -770,8 +798,7 @@ instructions::instruction_ptr parser::expression_instruction()
     return nullptr;
   }
 
-  return instructions::instruction_ptr(
-      new instructions::expression_instruction(line_no, col, std::move(expr)));
+  return _nodes.make<instructions::expression_instruction>(line_no, col, expr);
 }
 
 instructions::expr_ptr parser::conditional()
@@ -795,84 +822,269 @@ instructions::expr_ptr parser::conditional()
   return conditional_expression;
 }
 
-instructions::expr_ptr parser::expression(parser::precedence precedence)
+//  Expressions are parsed with an explicit stack rather than by recursion so
+//  that deeply nested input only costs heap. Each frame is an expression
+//  being parsed at some binding, or a node waiting on the expression that
+//  completes it (the right hand side of an operator, the contents of a
+//  group, an element, a parameter or an index). Whenever a frame finishes,
+//  its result is handed to the frame below it.
+//
+instructions::expr_ptr parser::expression(parser::precedence binding)
 {
+  using frame = expr_frame;
 
-  if (_prefix_fns.find(current_td_pair().token) == _prefix_fns.end()) {
-    die(error::parser::INTERNAL_NO_FN_FOR_TOK, "");
-    return nullptr;
-  }
+  auto push = [this](frame::kind type, parser::precedence at,
+                     instructions::expr_ptr node) {
+    _expr_stack.push_back({type, at, false, node});
+  };
+
+  auto base = _expr_stack.size();
+  push(frame::kind::EXPRESSION, binding, nullptr);
+
+  instructions::expr_ptr value = nullptr;
+  bool finished = false;
+
+  while (true) {
+
+    //  Hand the result of a finished frame to the one that was waiting on it
+    //
+    if (finished) {
+      if (_expr_stack.size() == base) {
+        return value;
+      }
+
+      auto &waiting = _expr_stack.back();
+      finished = false;
+
+      switch (waiting.type) {
+      case frame::kind::EXPRESSION:
+        waiting.node = value;
+        waiting.has_left = true;
+        break;
+
+      case frame::kind::PREFIX:
+        static_cast<instructions::prefix_expr *>(waiting.node)->right = value;
+        value = waiting.node;
+        _expr_stack.pop_back();
+        finished = true;
+        break;
+
+      case frame::kind::INFIX:
+        static_cast<instructions::infix_expr *>(waiting.node)->right = value;
+        value = waiting.node;
+        _expr_stack.pop_back();
+        finished = true;
+        break;
+
+      case frame::kind::GROUP:
+        _expr_stack.pop_back();
+        advance();
+        if (current_td_pair().token != Token::R_PAREN) {
+          value = nullptr;
+        }
+        finished = true;
+        break;
+
+      case frame::kind::INDEX: {
+        auto idx = static_cast<instructions::array_index_expr *>(waiting.node);
+        _expr_stack.pop_back();
+        idx->index = value;
+        advance();
+        expect(Token::R_BRACKET, "Expected ']' following index into array");
+        value = _parser_okay ? idx : nullptr;
+        finished = true;
+        break;
+      }
 
-  auto fn = _prefix_fns[current_td_pair().token];
-  instructions::expr_ptr left = (this->*fn)();
+      case frame::kind::ARRAY:
+      case frame::kind::CALL: {
+        auto type = waiting.type;
+        auto node = waiting.node;
+        auto &list =
+            (type == frame::kind::ARRAY)
+                ? static_cast<instructions::array_literal_expr *>(node)
+                      ->expressions
+                : static_cast<instructions::function_call_expr *>(node)->params;
+        list.push_back(value);
+
+        // More items to come
+        if (peek().token == Token::COMMA) {
+          advance();
+          advance();
+          push(frame::kind::EXPRESSION, precedence::LOWEST, nullptr);
+          break;
+        }
 
-  while (peek().token != Token::SEMICOLON && peek().token != Token::R_BRACE &&
-         precedence < peek_precedence()) {
-    if (_infix_fns.find(peek().token) == _infix_fns.end()) {
-      return left;
+        _expr_stack.pop_back();
+        if (!_parser_okay) {
+          list.clear();
+        }
+        advance();
+        if (type == frame::kind::ARRAY) {
+          expect(Token::R_BRACE, "Expected '}' at the end of array expression");
+        }
+        value = _parser_okay ? node : nullptr;
+        finished = true;
+        break;
+      }
+      }
+      continue;
     }
-    auto i_fn = _infix_fns[peek().token];
-    advance();
 
-    left = (this->*i_fn)(std::move(left));
-  }
+    auto &current = _expr_stack.back();
 
-  return left;
-}
+    //  Start an expression with the prefix form of its leading token
+    //
+    if (!current.has_left) {
+      auto &td = current_td_pair();
 
-instructions::expr_ptr parser::prefix_expr()
-{
-  size_t line_no = current_td_pair().line;
-  size_t col = current_td_pair().col;
-  auto result = instructions::prefix_expr_ptr(new instructions::prefix_expr(
-      line_no, col, current_td_pair().data, nullptr));
-  result->tok_op = current_td_pair().token;
-  advance();
+      // Error tokens from the lexer have already been reported
+      if (td.token == Token::ERT && !_tokens->at_end()) {
+        _parser_okay = false;
+        _expr_stack.pop_back();
+        value = nullptr;
+        finished = true;
+        continue;
+      }
 
-  result->right = expression(precedence::PREFIX);
-  return result;
-}
+      switch (rule(td.token).prefix) {
+      case prefix_form::NONE:
+        die(error::parser::INTERNAL_NO_FN_FOR_TOK, "");
+        _expr_stack.pop_back();
+        value = nullptr;
+        finished = true;
+        break;
 
-instructions::expr_ptr parser::infix_expr(instructions::expr_ptr left)
-{
-  size_t line_no = current_td_pair().line;
-  size_t col = current_td_pair().col;
-  auto result = instructions::infix_expr_ptr(new instructions::infix_expr(
-      line_no, col, current_td_pair().data, std::move(left), nullptr));
-  result->tok_op = current_td_pair().token;
+      case prefix_form::IDENTIFIER:
+        current.node = identifier();
+        current.has_left = true;
+        break;
 
-  precedence p = precedence::LOWEST;
-  if (precedences.find(current_td_pair().token) != precedences.end()) {
-    p = precedences[current_td_pair().token];
-  }
+      case prefix_form::NUMBER:
+        current.node = number();
+        current.has_left = true;
+        break;
 
-  advance();
+      case prefix_form::STRING:
+        current.node = str();
+        current.has_left = true;
+        break;
+
+      case prefix_form::OPERATOR: {
+        auto node = _nodes.make<instructions::prefix_expr>(td.line, td.col,
+                                                           td.token, nullptr);
+        advance();
+        push(frame::kind::PREFIX, precedence::LOWEST, node);
+        push(frame::kind::EXPRESSION, precedence::PREFIX, nullptr);
+        break;
+      }
+
+      case prefix_form::GROUP:
+        advance();
+        push(frame::kind::GROUP, precedence::LOWEST, nullptr);
+        push(frame::kind::EXPRESSION, precedence::LOWEST, nullptr);
+        break;
+
+      case prefix_form::ARRAY: {
+        auto node =
+            _nodes.make<instructions::array_literal_expr>(td.line, td.col);
+        if (peek().token == Token::R_BRACE) {
+          advance();
+          current.node = node;
+          current.has_left = true;
+          break;
+        }
+        advance();
+        push(frame::kind::ARRAY, precedence::LOWEST, node);
+        push(frame::kind::EXPRESSION, precedence::LOWEST, nullptr);
+        break;
+      }
+      }
+      continue;
+    }
 
-  result->right = expression(p);
-  return result;
+    //  Extend the expression with the next operator if it binds tighter
+    //  than the expression does
+    //
+    auto next = peek().token;
+    if (next == Token::SEMICOLON || next == Token::R_BRACE ||
+        current.binding >= rule(next).binding ||
+        rule(next).infix == infix_form::NONE) {
+      value = current.node;
+      _expr_stack.pop_back();
+      finished = true;
+      continue;
+    }
+
+    advance();
+    auto &td = current_td_pair();
+    auto left = current.node;
+
+    switch (rule(next).infix) {
+    case infix_form::OPERATOR: {
+      auto node = _nodes.make<instructions::infix_expr>(td.line, td.col,
+                                                        td.token, left, nullptr);
+      auto right_binding = rule(td.token).binding;
+      advance();
+      current.has_left = false;
+      push(frame::kind::INFIX, precedence::LOWEST, node);
+      push(frame::kind::EXPRESSION, right_binding, nullptr);
+      break;
+    }
+
+    case infix_form::CALL: {
+      auto node = _nodes.make<instructions::function_call_expr>(td.line, td.col);
+      node->fn = left;
+      if (peek().token == Token::R_PAREN) {
+        advance();
+        current.node = node;
+        break;
+      }
+      advance();
+      current.has_left = false;
+      push(frame::kind::CALL, precedence::LOWEST, node);
+      push(frame::kind::EXPRESSION, precedence::LOWEST, nullptr);
+      break;
+    }
+
+    case infix_form::INDEX: {
+      auto node = _nodes.make<instructions::array_index_expr>(td.line, td.col);
+      node->arr = left;
+      advance();
+      current.has_left = false;
+      push(frame::kind::INDEX, precedence::LOWEST, node);
+      push(frame::kind::EXPRESSION, precedence::LOWEST, nullptr);
+      break;
+    }
+
+    default:
+      break;
+    }
+  }
 }
 
 instructions::expr_ptr parser::identifier()
 {
-  size_t line_no = current_td_pair().line;
-  size_t col = current_td_pair().col;
-  expect(Token::IDENTIFIER, "Expected identifier in expression");
-  return instructions::expr_ptr(new instructions::expression(
-      line_no, col, instructions::node_type::ID, current_td_pair().data));
+  auto &td = current_td_pair();
+  if (td.token != Token::IDENTIFIER) {
+    die(error::parser::UNEXPECTED_TOKEN, "Expected identifier in expression");
+  }
+  return _nodes.make<instructions::expression>(
+      td.line, td.col, instructions::node_type::ID, td.id);
 }
 
 instructions::expr_ptr parser::number()
 {
-  size_t line_no = current_td_pair().line;
-  size_t col = current_td_pair().col;
-  if (current_td_pair().token == Token::LITERAL_NUMBER) {
-    return instructions::expr_ptr(
-        new instructions::raw_int_expr(line_no, col, current_td_pair().data));
+  auto &td = current_td_pair();
+  if (td.token == Token::LITERAL_NUMBER) {
+    return _nodes.make<instructions::raw_int_expr>(
+        td.line, td.col, td.id,
+        instructions::literal_to_variable_type(td.value.type),
+        td.value.integer);
   }
-  else if (current_td_pair().token == Token::LITERAL_FLOAT) {
-    return instructions::expr_ptr(new instructions::expression(
-        line_no, col, instructions::node_type::RAW_FLOAT,
-        current_td_pair().data));
+  else if (td.token == Token::LITERAL_FLOAT) {
+    return _nodes.make<instructions::raw_float_expr>(td.line, td.col, td.id,
+                                                     td.value.real);
   }
   else {
     die(error::parser::INTERNAL_NON_NUMERIC_REACHED,
@@ -884,156 +1096,500 @@ instructions::expr_ptr parser::number()
 instructions::expr_ptr parser::str()
 {
   // Sanity check
-  expect(Token::STRING, "Expected string in expression");
-
-  size_t line_no = current_td_pair().line;
-  size_t col = current_td_pair().col;
-  return instructions::expr_ptr(new instructions::expression(
-      line_no, col, instructions::node_type::RAW_STRING, current_td_pair().data));
+  auto &td = current_td_pair();
+  if (td.token != Token::STRING) {
+    die(error::parser::UNEXPECTED_TOKEN, "Expected string in expression");
+  }
+  return _nodes.make<instructions::expression>(
+      td.line, td.col, instructions::node_type::RAW_STRING, td.id);
 }
 
-instructions::expr_ptr parser::call_expr(instructions::expr_ptr fn)
+//  Cut the file into about 'pieces' segments by matching braces, without
+//  parsing anything. A function runs from 'fn' to the brace closing its
+//  body and anything else runs up to the next 'fn' outside of braces.
+//  Segments only end between items. Unbalanced braces leave the rest of
+//  the file in the last segment so that the parser can report them
+//
+std::vector<parser::segment> parser::split_top_level(const token_buffer &tokens,
+                                                     size_t pieces)
 {
-  size_t line_no = current_td_pair().line;
-  size_t col = current_td_pair().col;
-  auto result = instructions::function_call_expr_ptr(
-      new instructions::function_call_expr(line_no, col));
+  std::vector<segment> segments;
+  size_t size = tokens.size();
+  size_t target = std::max(size / std::max<size_t>(pieces, 1),
+                           min_segment_tokens);
+
+  segment current{0, 0, false};
+  auto cut = [&](size_t at) {
+    if (at > current.begin) {
+      current.end = at;
+      segments.push_back(current);
+    }
+    current = {at, at, false};
+  };
+
+  size_t idx = 0;
+  while (idx < size) {
+    size_t begin = idx;
+    bool imports = false;
+    size_t depth = 0;
+
+    if (tokens.kind(idx) == Token::FN) {
+      for (; idx < size; idx++) {
+        auto kind = tokens.kind(idx);
+        imports |= (kind == Token::IMPORT);
+        if (kind == Token::L_BRACE) {
+          depth++;
+        }
+        else if (kind == Token::R_BRACE && depth > 0 && --depth == 0) {
+          idx++;
+          break;
+        }
+      }
+      if (depth > 0) {
+        idx = size;
+      }
+    }
+    else {
+      for (; idx < size; idx++) {
+        auto kind = tokens.kind(idx);
+        if (kind == Token::FN && depth == 0) {
+          break;
+        }
+        imports |= (kind == Token::IMPORT);
+        if (kind == Token::L_BRACE) {
+          depth++;
+        }
+        else if (kind == Token::R_BRACE && depth > 0) {
+          depth--;
+        }
+      }
+    }
 
-  result->fn = std::move(fn);
+    if (imports) {
+      cut(begin);
+      current.local = true;
+      cut(idx);
+    }
+    else if (idx - current.begin >= target) {
+      cut(idx);
+    }
+  }
+  cut(size);
+  return segments;
+}
 
-  if (peek().token == Token::R_PAREN) {
-    advance();
-    return result;
+//  Segments are handed out to worker threads, each with a quiet parser and
+//  an arena of its own. Local segments are parsed afterwards on this
+//  thread, in order. The results are put back together in source order. If
+//  a segment failed, the file is parsed again from the start of that
+//  segment as it would have been without splitting, which reports the same
+//  diagnostics a serial parse does
+//
+std::vector<instructions::instruction_ptr>
+parser::parse_split(std::string source_name, const token_buffer &tokens,
+                    const std::vector<segment> &segments)
+{
+  _parser_okay = true;
+  _source_name = source_name;
+  _token_visits = 0;
+  _deferred_imports.clear();
+
+  auto workers = std::min(_jobs, segments.size());
+
+  // Worker arenas belong to ours so they are released along with it
+  std::vector<std::unique_ptr<parser>> parsers;
+  for (size_t i = 0; i < workers; i++) {
+    parsers.push_back(
+        std::make_unique<parser>(_file_imports, *_nodes.make<arena>()));
+    parsers.back()->_quiet = true;
+    parsers.back()->_skip_bodies = _skip_bodies;
+    parsers.back()->_preload = false;
   }
 
-  advance();
+  struct result {
+    std::vector<instructions::instruction_ptr> items;
+    size_t token_visits;
+    bool okay;
+  };
+  std::vector<result> results(segments.size());
+
+  auto parse_segment = [&](parser &p, size_t idx) {
+    buffer_token_stream stream(tokens, segments[idx].begin, segments[idx].end);
+    results[idx].items = p.parse(source_name, stream);
+    results[idx].token_visits = p.token_visits();
+    results[idx].okay = p.is_okay();
+  };
+
+  jobs::run(segments.size(), workers, [&](size_t task, size_t worker) {
+    if (!segments[task].local) {
+      parse_segment(*parsers[worker], task);
+    }
+  });
+
+  LOG(DEBUG) << TAG(APP_FILE_NAME) << "[" << APP_LINE << "]: Split "
+             << source_name << " into " << segments.size()
+             << " segments over " << workers << " workers" << std::endl;
+
+  // Segments holding imports are parsed here, once and in source order, so
+  // an import is never retried and its diagnostics come out where they would
+  // in a serial parse
+  parser local(_file_imports, _nodes);
+  local._quiet = _quiet;
+  local._jobs = _jobs;
+  local._skip_bodies = _skip_bodies;
+  local._lazy_imports = _lazy_imports;
+  local._preload = false;
+  local._defer_imports = _defer_imports;
+  local._cache = _cache;
 
-  result->params = parser::expression_list();
+  std::vector<instructions::instruction_ptr> top_level_items;
+  size_t token_visits = 0;
+
+  // Imports deferred by a parse of part of the file are counted from the
+  // start of that part
+  auto add_deferred = [&](const std::vector<imports::pending_import> &found) {
+    for (auto pending : found) {
+      pending.index += top_level_items.size();
+      _deferred_imports.push_back(pending);
+    }
+  };
 
-  advance();
+  for (size_t idx = 0; idx < segments.size(); idx++) {
+    if (segments[idx].local) {
+      parse_segment(local, idx);
+      if (!results[idx].okay) {
+        _parser_okay = false;
+        _token_visits = token_visits + results[idx].token_visits;
+        return {};
+      }
+      add_deferred(local._deferred_imports);
+    }
+    token_visits += results[idx].token_visits;
 
-  if (!_parser_okay) {
-    return nullptr;
+    if (!results[idx].okay) {
+      auto deferred = std::move(_deferred_imports);
+      buffer_token_stream remaining(tokens, segments[idx].begin, tokens.size());
+      auto items = parse(source_name, remaining);
+      _token_visits += token_visits;
+      if (!_parser_okay) {
+        return {};
+      }
+      std::swap(deferred, _deferred_imports);
+      add_deferred(deferred);
+      top_level_items.insert(top_level_items.end(), items.begin(), items.end());
+      return top_level_items;
+    }
+
+    top_level_items.insert(top_level_items.end(), results[idx].items.begin(),
+                           results[idx].items.end());
   }
 
-  return result;
+  _token_visits = token_visits;
+  return top_level_items;
 }
 
-std::vector<instructions::expr_ptr> parser::expression_list()
+//  Add the items of an imported module to 'items'. Each module is parsed
+//  once per run, from what preload_imports loaded when it is there.
+//  Errors about the import are reported at line and col
+//
+void parser::import_module(const std::string &target, size_t line, size_t col,
+                           std::vector<instructions::instruction_ptr> &items)
 {
-  std::vector<instructions::expr_ptr> results;
+  LOG(DEBUG) << TAG(APP_FILE_NAME) << "[" << APP_LINE << "]: " << target
+             << std::endl;
+  auto [item_found, target_item] = _file_imports.locate(target);
 
-  results.emplace_back(expression(precedence::LOWEST));
+  if (!item_found) {
+    std::string message = "Unable to locate import target: " + target;
+    report_error(error::parser::UNABLE_TO_LOCATE_IMPORT, line, col, message,
+                 _parser_okay);
+    return;
+  }
 
-  while (peek().token == Token::COMMA) {
+  // Its items are already in the tree if it has been imported before
+  auto module = imports::module_key(target_item);
+  auto state = _file_imports.state_of(module);
+  if (state == imports::module_state::DONE) {
+    return;
+  }
+  if (state == imports::module_state::PARSING) {
+    std::string message =
+        "Import of \"" + target + "\" leads back to a file importing it";
+    report_error(error::parser::CYCLIC_IMPORT, line, col, message,
+                 _parser_okay);
+    return;
+  }
+  _file_imports.set_state(module, imports::module_state::PARSING);
+
+  parser import_parser(_file_imports, _nodes);
+  import_parser._quiet = _quiet;
+  import_parser._jobs = _jobs;
+  import_parser._skip_bodies = _lazy_imports;
+  import_parser._lazy_imports = _lazy_imports;
+  import_parser._preload = false;
+  import_parser._cache = _cache;
+
+  token_stream_ptr imported_tokens;
+  std::vector<instructions::instruction_ptr> parsed_file;
+
+  // Modules preloaded from their cache come without tokens
+  auto preloaded = _file_imports.preloaded(module);
+  if (preloaded && (preloaded->tokens || preloaded->okay)) {
+    imported_tokens = std::move(preloaded->tokens);
+
+    size_t begin = 0;
+    size_t end = 0;
+    auto buffer =
+        imported_tokens ? imported_tokens->backing_buffer(begin, end) : nullptr;
+    if (preloaded->okay || !buffer) {
+      import_parser._source_name = target_item;
+      import_parser.expand_preloaded(*preloaded, parsed_file);
+    }
+    else {
+      // Parse it again, reporting its errors as they are found
+      buffer_token_stream again(*buffer);
+      parsed_file = import_parser.parse(target_item, again);
+    }
+  }
+  else {
+    parsed_file =
+        import_parser.parse_module(target_item, target_item, imported_tokens);
+  }
 
-    advance();
-    advance();
-    results.emplace_back(expression(precedence::LOWEST));
+  if (!import_parser.is_okay()) {
+    _file_imports.set_state(module, imports::module_state::NONE);
+    _parser_okay = false;
+    return;
   }
+  _file_imports.set_state(module, imports::module_state::DONE);
 
-  if (!_parser_okay) {
-    results.clear();
+  // Skipped bodies are parsed from these tokens later on
+  if (_lazy_imports) {
+    _nodes.make<token_stream_ptr>(std::move(imported_tokens));
   }
 
-  return results;
+  // Add it to our top level objects
+  items.insert(items.end(), parsed_file.begin(), parsed_file.end());
 }
 
-instructions::expr_ptr parser::grouped_expr()
+std::vector<instructions::instruction_ptr>
+parser::parse_file(const std::string &source_name, const std::string &path)
 {
-  advance();
-  instructions::expr_ptr expr = expression(precedence::LOWEST);
-
-  advance();
-  if (current_td_pair().token != Token::R_PAREN) {
-    return nullptr;
-  }
-  return expr;
+  token_stream_ptr tokens;
+  return parse_module(source_name, path, tokens);
 }
 
-instructions::expr_ptr parser::array()
+//  Parse the file at 'path', leaving its tokens in 'tokens'. With caching
+//  on, the module is loaded from its cache when that is current. Otherwise
+//  it is parsed quietly with its imports left in place, which is the form
+//  the cache keeps, then stored and expanded. When that parse fails the
+//  module is parsed again so its errors are reported in order
+//
+std::vector<instructions::instruction_ptr>
+parser::parse_module(const std::string &source_name, const std::string &path,
+                     token_stream_ptr &tokens)
 {
-  size_t line_no = current_td_pair().line;
-  size_t col = current_td_pair().col;
-  auto arr = instructions::array_literal_expr_ptr(
-      new instructions::array_literal_expr(line_no, col));
-
-  if (peek().token == Token::R_BRACE) {
-    advance();
-    return arr;
+  module_cache::key key;
+  bool cached = _cache && module_cache::key_of(path, key);
+
+  std::vector<instructions::instruction_ptr> items;
+  imports::preloaded_module module;
+  if (cached &&
+      module_cache::load(path, source_name, key, _nodes, module)) {
+    LOG(DEBUG) << TAG(APP_FILE_NAME) << "[" << APP_LINE << "]: Loaded "
+               << path << " from its cache" << std::endl;
+    _source_name = source_name;
+    expand_preloaded(module, items);
+    return items;
   }
 
-  advance();
-  arr->expressions = std::move(expression_list());
-  advance();
+  tokens = _file_imports.import_file(path);
 
-  expect(Token::R_BRACE, "Expected '}' at the end of array expression");
+  // Skipped bodies are not kept in a cache, and a stream with no buffer
+  // behind it could not be read again to report a failed parse
+  size_t begin = 0;
+  size_t end = 0;
+  auto buffer = tokens->backing_buffer(begin, end);
+  if (!cached || _skip_bodies || !buffer) {
+    return parse(source_name, *tokens);
+  }
 
-  if (!_parser_okay) {
-    return nullptr;
+  parser deferred(_file_imports, _nodes);
+  deferred._quiet = true;
+  deferred._jobs = _jobs;
+  deferred._lazy_imports = _lazy_imports;
+  deferred._preload = _preload;
+  deferred._defer_imports = true;
+  deferred._cache = _cache;
+  module.items = deferred.parse(source_name, *tokens);
+  module.imports = std::move(deferred._deferred_imports);
+
+  if (!deferred.is_okay()) {
+    buffer_token_stream again(*buffer);
+    return parse(source_name, again);
   }
 
-  return arr;
+  module_cache::store(path, source_name, key, module);
+  _source_name = source_name;
+  expand_preloaded(module, items);
+  return items;
 }
 
-instructions::expr_ptr parser::index_expr(instructions::expr_ptr arr)
+//  Put the items of a preloaded module in 'items', importing what it
+//  imports in their place as parsing it would have
+//
+void parser::expand_preloaded(imports::preloaded_module &module,
+                              std::vector<instructions::instruction_ptr> &items)
 {
-  size_t line_no = current_td_pair().line;
-  size_t col = current_td_pair().col;
-  auto idx = instructions::array_index_expr_ptr(
-      new instructions::array_index_expr(line_no, col));
-  idx->arr = std::move(arr);
-
-  advance();
-  idx->index = expression(precedence::LOWEST);
-
-  advance();
-  expect(Token::R_BRACKET, "Expected ']' following index into array");
+  _parser_okay = true;
 
-  if (!_parser_okay) {
-    return nullptr;
+  size_t next = 0;
+  for (size_t idx = 0; idx < module.items.size() && _parser_okay; idx++) {
+    if (next < module.imports.size() && module.imports[next].index == idx) {
+      auto &pending = module.imports[next++];
+      auto ins = static_cast<instructions::import *>(module.items[idx]);
+      import_module(ins->target, pending.line, pending.col, items);
+      continue;
+    }
+    items.push_back(module.items[idx]);
   }
-
-  return idx;
 }
 
-/* Finds an import */
-std::tuple<bool, std::string>
-parser::locate_import(std::vector<std::string> &paths, std::string &target)
+//  Targets of the imports in a file, in order
+//
+std::vector<std::string> parser::imports_of(const token_buffer &tokens)
 {
-  LOG(DEBUG) << TAG(APP_FILE_NAME) << "[" << APP_LINE << "]: " << target
-             << std::endl;
-  LOG(DEBUG) << TAG(APP_FILE_NAME) << "[" << APP_LINE << "]: " << paths.size()
-             << " include directories" << std::endl;
+  std::vector<std::string> targets;
+  for (size_t idx = 0; idx + 1 < tokens.size(); idx++) {
+    if (tokens.kind(idx) == Token::IMPORT &&
+        tokens.kind(idx + 1) == Token::STRING) {
+      targets.emplace_back(tokens.text(idx + 1));
+    }
+  }
+  return targets;
+}
 
-  // Check the local directory first
-  std::filesystem::path item_as_local = std::filesystem::current_path();
-  item_as_local /= target;
-  if (std::filesystem::is_regular_file(item_as_local)) {
-    return {true, item_as_local};
+//  Find every module a file imports, directly or not, and lex and parse
+//  them on worker threads a level of the import graph at a time. Modules
+//  are parsed quietly and without following their own imports, which
+//  import_module later expands in import order. Nothing here changes which
+//  modules have been imported, so a module that failed is simply parsed
+//  again when it is reached
+//
+void parser::preload_imports(const token_buffer &tokens)
+{
+  std::vector<std::string> targets;
+  std::unordered_set<std::string> seen;
+  for (auto &target : imports_of(tokens)) {
+    if (seen.insert(target).second) {
+      targets.push_back(target);
+    }
+  }
+  if (targets.empty() || !_file_imports.preload_file) {
+    return;
   }
 
-  // If its not in the same directory as the file importing it, check the
-  // already located items
-  auto [found, imported_target] = _file_imports.get_target_path(target);
-  if (found) {
-    return {true, imported_target};
+  std::vector<std::unique_ptr<parser>> parsers;
+  for (size_t i = 0; i < _jobs; i++) {
+    parsers.push_back(
+        std::make_unique<parser>(_file_imports, *_nodes.make<arena>()));
+    parsers.back()->_quiet = true;
+    parsers.back()->_skip_bodies = _lazy_imports;
+    parsers.back()->_preload = false;
+    parsers.back()->_defer_imports = true;
   }
 
-  // If it still isn't found, we need to iterate all include dirs and search for
-  // it
-  for (auto &dir : paths) {
-    std::filesystem::path item_path = dir;
-    item_path /= target;
+  struct load {
+    std::string path;
+    imports::preloaded_module module;
+    std::vector<std::string> targets; // Of its own imports
+  };
+
+  size_t modules = 0;
+  size_t levels = 0;
+  std::unordered_set<std::string> paths;
+
+  while (!targets.empty()) {
+    // Targets naming the same file are loaded once
+    std::vector<load> level(targets.size());
+    for (size_t idx = 0; idx < targets.size(); idx++) {
+      auto [found, path] = _file_imports.locate(targets[idx]);
+      if (found && paths.insert(path).second) {
+        level[idx].path = path;
+      }
+    }
+
+    jobs::run(targets.size(), _jobs, [&](size_t task, size_t worker) {
+      auto &loaded = level[task];
+      if (loaded.path.empty()) {
+        return;
+      }
+
+      auto &p = *parsers[worker];
+      module_cache::key key;
+      bool cached = _cache && module_cache::key_of(loaded.path, key);
+      if (cached && module_cache::load(loaded.path, loaded.path, key, p._nodes,
+                                       loaded.module)) {
+        for (auto &pending : loaded.module.imports) {
+          auto ins = loaded.module.items[pending.index];
+          loaded.targets.push_back(
+              static_cast<instructions::import *>(ins)->target);
+        }
+        return;
+      }
+
+      loaded.module.tokens = _file_imports.preload_file(loaded.path);
+      if (!loaded.module.tokens) {
+        loaded.path.clear();
+        return;
+      }
+
+      // A module that did not lex cleanly is left to be lexed again when it
+      // is reached, so its errors are reported in order
+      size_t begin = 0;
+      size_t end = 0;
+      if (auto buffer = loaded.module.tokens->backing_buffer(begin, end)) {
+        for (size_t idx = begin; idx < end; idx++) {
+          if (buffer->kind(idx) == Token::ERT) {
+            loaded.path.clear();
+            return;
+          }
+        }
+        loaded.targets = imports_of(*buffer);
+      }
+
+      loaded.module.items = p.parse(loaded.path, *loaded.module.tokens);
+      loaded.module.imports = p._deferred_imports;
+      loaded.module.okay = p.is_okay();
 
-    // If we find the item store it for later before handing off
-    if (std::filesystem::is_regular_file(item_path)) {
-      _file_imports.store_target_path(target, item_path);
-      return {true, item_path};
+      if (cached && loaded.module.okay && !p._skip_bodies) {
+        module_cache::store(loaded.path, loaded.path, key, loaded.module);
+      }
+    });
+
+    std::vector<std::string> next;
+    for (size_t idx = 0; idx < level.size(); idx++) {
+      auto &loaded = level[idx];
+      if (loaded.path.empty()) {
+        continue;
+      }
+      _file_imports.add_preloaded(imports::module_key(loaded.path),
+                                  std::move(loaded.module));
+      modules++;
+
+      for (auto &target : loaded.targets) {
+        if (seen.insert(target).second) {
+          next.push_back(target);
+        }
+      }
     }
+
+    targets = std::move(next);
+    levels++;
   }
 
-  return {false, {}};
+  LOG(DEBUG) << TAG(APP_FILE_NAME) << "[" << APP_LINE << "]: Preloaded "
+             << modules << " modules in " << levels << " levels" << std::endl;
 }
 
 } // namespace titan
@@ -1,6 +1,7 @@
 #ifndef COMPILER_PARSER_HPP
 #define COMPILER_PARSER_HPP
 
+#include <array>
 #include <functional>
 #include <optional>
 #include <string>
@@ -9,8 +10,10 @@
 
 #include "error/error_manager.hpp"
 
+#include "arena.hpp"
 #include "imports.hpp"
 #include "instructions.hpp"
+#include "token_stream.hpp"
 #include "tokens.hpp"
 
 namespace titan {
@@ -33,31 +36,124 @@ public:
     INDEX         // []
   };
 
-  parser(imports &file_imports);
+  // Nodes are made in 'nodes', which must outlive the instructions returned
+  parser(imports &file_imports, arena &nodes);
 
   std::vector<instructions::instruction_ptr>
-  parse(std::string source_name,
-        std::vector<TD_Pair> &tokens);
+  parse(std::string source_name, token_stream &tokens);
+
+  // Parse the file at 'path', or load it from its cache when caching is on
+  // and the cache is current
+  std::vector<instructions::instruction_ptr>
+  parse_file(const std::string &source_name, const std::string &path);
 
   bool is_okay() const { return _parser_okay; }
 
+  // Number of times the last parse looked at a token
+  size_t token_visits() const { return _token_visits; }
+
+  // Parse the top level functions of whole files on up to 'jobs' threads
+  void set_jobs(size_t jobs) { _jobs = jobs; }
+
+  // Only parse the signatures of functions, recording where their bodies
+  // are so they can be parsed when first needed (see function::load_body).
+  // The token buffer behind the stream must outlive the functions. Streams
+  // without one have their bodies parsed right away
+  void set_lazy_bodies(bool lazy) { _skip_bodies = lazy; }
+
+  // As above but only for the functions of imported files, whose tokens
+  // are kept along with the nodes
+  void set_lazy_imports(bool lazy) { _lazy_imports = lazy; }
+
+  // Keep what is parsed from files in .tlc caches beside them and load
+  // files from those caches while they are current (see module_cache.hpp)
+  void set_cache(bool cache) { _cache = cache; }
+
 private:
-  typedef instructions::expr_ptr (parser::*prefix_parse_fn)();
-  typedef instructions::expr_ptr (parser::*infix_parse_fn)(instructions::expr_ptr);
+  // How a token starts an expression
+  enum class prefix_form : uint8_t {
+    NONE,
+    IDENTIFIER,
+    NUMBER,
+    STRING,
+    OPERATOR, // -a !a ~a
+    GROUP,    // ( a )
+    ARRAY     // { a, b }
+  };
+
+  // How a token continues one
+  enum class infix_form : uint8_t {
+    NONE,
+    OPERATOR, // a + b
+    CALL,     // a(b, c)
+    INDEX     // a[b]
+  };
+
+  // How a token behaves within an expression. Tokens that can't start or
+  // continue an expression have NONE forms and LOWEST binding
+  struct parse_rule {
+    prefix_form prefix;
+    infix_form infix;
+    precedence binding;
+  };
+  using parse_rules = std::array<parse_rule, TOKEN_COUNT>;
+
+  // Built at compile time, indexed by Token
+  static constexpr parse_rules build_rules();
+  static const parse_rules rules;
+
+  static const parse_rule &rule(Token token)
+  {
+    return rules[static_cast<size_t>(token)];
+  }
+
+  //  A run of whole top level items that can be parsed on its own. Local
+  //  segments contain an import, which uses the shared import table, so
+  //  they are only parsed on the calling thread
+  //
+  struct segment {
+    size_t begin;
+    size_t end;
+    bool local;
+  };
 
   bool _parser_okay;
-  size_t _idx;
-  size_t _mark;
+  bool _quiet; // Errors only fail the parse, they are not reported
+  size_t _jobs;
+  bool _skip_bodies;
+  bool _lazy_imports;
+  bool _preload;       // Load the imports of a whole file ahead of time
+  bool _defer_imports; // Leave imports in the items for import_module
+  bool _cache;
+  std::vector<imports::pending_import> _deferred_imports;
   imports &_file_imports;
+  arena &_nodes;
   error::manager _err;
-  std::vector<TD_Pair> _tokens;
-  std::unordered_map<Token, prefix_parse_fn> _prefix_fns;
-  std::unordered_map<Token, infix_parse_fn> _infix_fns;
+  token_stream *_tokens;
+  mutable size_t _token_visits;
   std::string _source_name;
   std::unordered_map<std::string, std::string> _located_items;
+
+  // Work list of the iterative expression parser (see expression())
+  struct expr_frame {
+    enum class kind : uint8_t {
+      EXPRESSION, // An expression parsed at 'binding'
+      PREFIX,     // Operator waiting on its operand
+      INFIX,      // Operator waiting on its right hand side
+      GROUP,      // '(' waiting on its contents
+      ARRAY,      // Array literal waiting on its next element
+      CALL,       // Call waiting on its next parameter
+      INDEX       // Index waiting on the index expression
+    };
+    kind type;
+    precedence binding;
+    bool has_left; // EXPRESSION holds its left operand in 'node'
+    instructions::expr_ptr node;
+  };
+  std::vector<expr_frame> _expr_stack;
+
   void report_error(uint64_t error_no, size_t line, size_t col,
                     const std::string error, bool show_full);
-  void prev();
   void advance();
   void mark();
   void reset();
@@ -66,8 +162,10 @@ private:
   void die(uint64_t error_no, std::string error);
   void expect(Token token, std::string error, size_t ahead = 0);
   const TD_Pair &peek(size_t ahead = 1) const;
-  precedence peek_precedence();
   instructions::instruction_ptr function();
+  std::function<bool(instructions::function &)> skip_body();
+  bool parse_body(const std::string &source_name, const token_buffer &tokens,
+                  size_t begin, size_t end, instructions::function &fn);
   instructions::import_ptr import();
   std::vector<instructions::variable_ptr> function_params();
   std::vector<instructions::instruction_ptr> statements();
@@ -84,15 +182,20 @@ private:
   instructions::expr_ptr identifier();
   instructions::expr_ptr number();
   instructions::expr_ptr str();
-  instructions::expr_ptr prefix_expr();
-  instructions::expr_ptr grouped_expr();
-  instructions::expr_ptr array();
-  instructions::expr_ptr infix_expr(instructions::expr_ptr left);
-  instructions::expr_ptr index_expr(instructions::expr_ptr array);
-  instructions::expr_ptr call_expr(instructions::expr_ptr function);
-  std::vector<instructions::expr_ptr> expression_list();
-  std::tuple<bool, std::string> locate_import(std::vector<std::string> &paths,
-                                              std::string &target);
+  void import_module(const std::string &target, size_t line, size_t col,
+                     std::vector<instructions::instruction_ptr> &items);
+  std::vector<instructions::instruction_ptr>
+  parse_module(const std::string &source_name, const std::string &path,
+               token_stream_ptr &tokens);
+  void expand_preloaded(imports::preloaded_module &module,
+                        std::vector<instructions::instruction_ptr> &items);
+  static std::vector<std::string> imports_of(const token_buffer &tokens);
+  void preload_imports(const token_buffer &tokens);
+  static std::vector<segment> split_top_level(const token_buffer &tokens,
+                                              size_t pieces);
+  std::vector<instructions::instruction_ptr>
+  parse_split(std::string source_name, const token_buffer &tokens,
+              const std::vector<segment> &segments);
 };
 } // namespace titan
 
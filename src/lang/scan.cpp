@@ -0,0 +1,283 @@
+#include "scan.hpp"
+
+#include <array>
+#include <atomic>
+#include <cstdint>
+
+#if defined(__GNUC__) && (defined(__x86_64__) || defined(__i386__))
+#define TITAN_SCAN_X86 1
+#include <immintrin.h>
+#endif
+
+namespace titan {
+namespace scan {
+
+namespace {
+
+enum char_class : uint8_t {
+  IDENT = 1 << 0,
+  DIGIT = 1 << 1,
+  SPACE = 1 << 2,
+  STRING = 1 << 3,
+};
+
+constexpr std::array<uint8_t, 256> build_classes()
+{
+  std::array<uint8_t, 256> table{};
+  for (size_t c = 0; c < table.size(); c++) {
+    uint8_t flags = 0;
+    if ((c >= 'a' && c <= 'z') || (c >= 'A' && c <= 'Z') || c == '_') {
+      flags |= IDENT;
+    }
+    if (c >= '0' && c <= '9') {
+      flags |= IDENT | DIGIT;
+    }
+    if (c == ' ' || (c >= '\t' && c <= '\r')) {
+      flags |= SPACE;
+    }
+    if (c != '"' && c != '\\') {
+      flags |= STRING;
+    }
+    table[c] = flags;
+  }
+  return table;
+}
+
+constexpr std::array<uint8_t, 256> classes = build_classes();
+
+inline bool in_class(char c, uint8_t flag)
+{
+  return classes[static_cast<unsigned char>(c)] & flag;
+}
+
+template <uint8_t Flag>
+size_t scalar_end(std::string_view source, size_t pos)
+{
+  while (pos < source.size() && in_class(source[pos], Flag)) {
+    pos++;
+  }
+  return pos;
+}
+
+#ifdef TITAN_SCAN_X86
+
+//  Range checks use signed byte compares, so anything >= 0x80 is negative
+//  and never falls into one of the (ASCII) ranges below
+//
+#define TITAN_SSE2 __attribute__((target("sse2")))
+#define TITAN_AVX2 __attribute__((target("avx2")))
+
+TITAN_SSE2 inline __m128i in_range_16(__m128i v, char lo, char hi)
+{
+  return _mm_and_si128(_mm_cmpgt_epi8(v, _mm_set1_epi8(lo - 1)),
+                       _mm_cmplt_epi8(v, _mm_set1_epi8(hi + 1)));
+}
+
+TITAN_SSE2 inline uint32_t members_16(__m128i v, uint8_t flag)
+{
+  __m128i hit;
+  switch (flag) {
+  case IDENT:
+    hit = _mm_or_si128(
+        _mm_or_si128(in_range_16(_mm_or_si128(v, _mm_set1_epi8(0x20)), 'a', 'z'),
+                     in_range_16(v, '0', '9')),
+        _mm_cmpeq_epi8(v, _mm_set1_epi8('_')));
+    break;
+  case DIGIT:
+    hit = in_range_16(v, '0', '9');
+    break;
+  case SPACE:
+    hit = _mm_or_si128(_mm_cmpeq_epi8(v, _mm_set1_epi8(' ')),
+                       in_range_16(v, '\t', '\r'));
+    break;
+  default:
+    hit = _mm_andnot_si128(_mm_or_si128(_mm_cmpeq_epi8(v, _mm_set1_epi8('"')),
+                                        _mm_cmpeq_epi8(v, _mm_set1_epi8('\\'))),
+                           _mm_set1_epi8(-1));
+    break;
+  }
+  return static_cast<uint32_t>(_mm_movemask_epi8(hit));
+}
+
+template <uint8_t Flag>
+TITAN_SSE2 size_t sse2_end(std::string_view source, size_t pos)
+{
+  auto data = source.data();
+  while (pos + 16 <= source.size()) {
+    auto v = _mm_loadu_si128(reinterpret_cast<const __m128i *>(data + pos));
+    uint32_t misses = ~members_16(v, Flag) & 0xFFFF;
+    if (misses) {
+      return pos + __builtin_ctz(misses);
+    }
+    pos += 16;
+  }
+  return scalar_end<Flag>(source, pos);
+}
+
+TITAN_AVX2 inline __m256i in_range_32(__m256i v, char lo, char hi)
+{
+  return _mm256_and_si256(_mm256_cmpgt_epi8(v, _mm256_set1_epi8(lo - 1)),
+                          _mm256_cmpgt_epi8(_mm256_set1_epi8(hi + 1), v));
+}
+
+TITAN_AVX2 inline uint32_t members_32(__m256i v, uint8_t flag)
+{
+  __m256i hit;
+  switch (flag) {
+  case IDENT:
+    hit = _mm256_or_si256(
+        _mm256_or_si256(
+            in_range_32(_mm256_or_si256(v, _mm256_set1_epi8(0x20)), 'a', 'z'),
+            in_range_32(v, '0', '9')),
+        _mm256_cmpeq_epi8(v, _mm256_set1_epi8('_')));
+    break;
+  case DIGIT:
+    hit = in_range_32(v, '0', '9');
+    break;
+  case SPACE:
+    hit = _mm256_or_si256(_mm256_cmpeq_epi8(v, _mm256_set1_epi8(' ')),
+                          in_range_32(v, '\t', '\r'));
+    break;
+  default:
+    hit = _mm256_andnot_si256(
+        _mm256_or_si256(_mm256_cmpeq_epi8(v, _mm256_set1_epi8('"')),
+                        _mm256_cmpeq_epi8(v, _mm256_set1_epi8('\\'))),
+        _mm256_set1_epi8(-1));
+    break;
+  }
+  return static_cast<uint32_t>(_mm256_movemask_epi8(hit));
+}
+
+template <uint8_t Flag>
+TITAN_AVX2 size_t avx2_end(std::string_view source, size_t pos)
+{
+  // Most runs are short, let the narrower path handle them and pick up
+  // whatever is left over. The upper halves of the registers are cleared
+  // first so the legacy SSE code does not pay a state transition penalty
+  if (pos + 32 <= source.size()) {
+    auto data = source.data();
+    do {
+      auto v =
+          _mm256_loadu_si256(reinterpret_cast<const __m256i *>(data + pos));
+      uint32_t misses = ~members_32(v, Flag);
+      if (misses) {
+        _mm256_zeroupper();
+        return pos + __builtin_ctz(misses);
+      }
+      pos += 32;
+    } while (pos + 32 <= source.size());
+    _mm256_zeroupper();
+  }
+  return sse2_end<Flag>(source, pos);
+}
+
+#endif
+
+struct scanners {
+  mode id;
+  size_t (*ident)(std::string_view, size_t);
+  size_t (*digit)(std::string_view, size_t);
+  size_t (*space)(std::string_view, size_t);
+  size_t (*string)(std::string_view, size_t);
+};
+
+constexpr scanners scalar_scanners{mode::SCALAR, scalar_end<IDENT>,
+                                   scalar_end<DIGIT>, scalar_end<SPACE>,
+                                   scalar_end<STRING>};
+
+#ifdef TITAN_SCAN_X86
+constexpr scanners sse2_scanners{mode::SSE2, sse2_end<IDENT>, sse2_end<DIGIT>,
+                                 sse2_end<SPACE>, sse2_end<STRING>};
+
+constexpr scanners avx2_scanners{mode::AVX2, avx2_end<IDENT>, avx2_end<DIGIT>,
+                                 avx2_end<SPACE>, avx2_end<STRING>};
+#endif
+
+const scanners *scanners_for(mode m)
+{
+  switch (m) {
+  case mode::SCALAR:
+    return &scalar_scanners;
+#ifdef TITAN_SCAN_X86
+  case mode::SSE2:
+    return __builtin_cpu_supports("sse2") ? &sse2_scanners : nullptr;
+  case mode::AVX2:
+    return __builtin_cpu_supports("avx2") ? &avx2_scanners : nullptr;
+#endif
+  case mode::AUTO:
+    for (auto best : {mode::AVX2, mode::SSE2}) {
+      if (auto selected = scanners_for(best)) {
+        return selected;
+      }
+    }
+    return &scalar_scanners;
+  default:
+    return nullptr;
+  }
+}
+
+std::atomic<const scanners *> &active()
+{
+  static std::atomic<const scanners *> selected{scanners_for(mode::AUTO)};
+  return selected;
+}
+
+} // namespace
+
+bool set_mode(mode m)
+{
+  auto selected = scanners_for(m);
+  if (!selected) {
+    return false;
+  }
+  active().store(selected, std::memory_order_relaxed);
+  return true;
+}
+
+mode active_mode() { return active().load(std::memory_order_relaxed)->id; }
+
+bool is_supported(mode m) { return scanners_for(m) != nullptr; }
+
+const char *mode_to_str(mode m)
+{
+  switch (m) {
+  case mode::AUTO:
+    return "auto";
+  case mode::SCALAR:
+    return "scalar";
+  case mode::SSE2:
+    return "sse2";
+  case mode::AVX2:
+    return "avx2";
+  }
+  return "unknown";
+}
+
+size_t ident_end(std::string_view source, size_t pos)
+{
+  return active().load(std::memory_order_relaxed)->ident(source, pos);
+}
+
+size_t digit_end(std::string_view source, size_t pos)
+{
+  return active().load(std::memory_order_relaxed)->digit(source, pos);
+}
+
+size_t space_end(std::string_view source, size_t pos)
+{
+  return active().load(std::memory_order_relaxed)->space(source, pos);
+}
+
+size_t string_end(std::string_view source, size_t pos)
+{
+  return active().load(std::memory_order_relaxed)->string(source, pos);
+}
+
+bool is_ident(char c) { return in_class(c, IDENT); }
+
+bool is_digit(char c) { return in_class(c, DIGIT); }
+
+bool is_space(char c) { return in_class(c, SPACE); }
+
+} // namespace scan
+} // namespace titan
@@ -0,0 +1,59 @@
+#ifndef TITAN_SCAN_HPP
+#define TITAN_SCAN_HPP
+
+#include <cstddef>
+#include <string_view>
+
+namespace titan {
+namespace scan {
+
+//  Character class scanning used by the lexer to find the end of runs of
+//  identifier characters, digits, whitespace and string literal bodies.
+//
+//  Classification is plain ASCII (the same as the "C" locale) and never
+//  consults the current locale. On x86 the scans are done 16 (SSE2) or 32
+//  (AVX2) bytes at a time, chosen at runtime from what the CPU supports.
+//  Everywhere else, and for the tail of a buffer, a 256 entry lookup table
+//  is used.
+//
+enum class mode { AUTO, SCALAR, SSE2, AVX2 };
+
+//  Force a particular implementation. AUTO selects the best one the CPU
+//  supports. Returns false (leaving the current mode unchanged) if the
+//  requested mode is not supported on this machine
+extern bool set_mode(mode m);
+
+//  The implementation currently in use (never AUTO)
+extern mode active_mode();
+
+//  Check if the given mode can be used on this machine
+extern bool is_supported(mode m);
+
+//  Name of a mode for diagnostics
+extern const char *mode_to_str(mode m);
+
+//  Each scan returns the index of the first character at or after 'pos'
+//  that is NOT in the class, or source.size() if the run reaches the end
+
+//  [A-Za-z0-9_]
+extern size_t ident_end(std::string_view source, size_t pos);
+
+//  [0-9]
+extern size_t digit_end(std::string_view source, size_t pos);
+
+//  Space, \t, \n, \v, \f, \r
+extern size_t space_end(std::string_view source, size_t pos);
+
+//  Anything other than '"' and '\\', i.e the end of a plain run of string
+//  literal characters
+extern size_t string_end(std::string_view source, size_t pos);
+
+//  Single character classification via the lookup table
+extern bool is_ident(char c);
+extern bool is_digit(char c);
+extern bool is_space(char c);
+
+} // namespace scan
+} // namespace titan
+
+#endif
@@ -0,0 +1,175 @@
+#include "token_buffer.hpp"
+
+#include <algorithm>
+
+namespace titan {
+
+void token_buffer::clear()
+{
+  _kinds.clear();
+  _offsets.clear();
+  _payloads.clear();
+  _line_starts.clear();
+  _literals.clear();
+}
+
+void token_buffer::reserve(size_t tokens)
+{
+  _kinds.reserve(tokens);
+  _offsets.reserve(tokens);
+  _payloads.reserve(tokens);
+}
+
+void token_buffer::shrink_to_fit()
+{
+  _kinds.shrink_to_fit();
+  _offsets.shrink_to_fit();
+  _payloads.shrink_to_fit();
+  _line_starts.shrink_to_fit();
+  _literals.shrink_to_fit();
+}
+
+size_t token_buffer::line_of(size_t i) const
+{
+  // First line starting after the token, the token is on the one before it
+  auto after = std::upper_bound(_line_starts.begin(), _line_starts.end(),
+                                _offsets[i]);
+  return static_cast<size_t>(after - _line_starts.begin());
+}
+
+size_t token_buffer::column_of(size_t i) const
+{
+  return _offsets[i] - line_start(line_of(i));
+}
+
+std::string_view token_buffer::text(size_t i) const
+{
+  if (auto text_id = id(i); text_id != empty_atom) {
+    return atoms::text(text_id);
+  }
+  return fixed_token_text(kind(i));
+}
+
+TD_Pair token_buffer::at(size_t i) const
+{
+  return TD_Pair{kind(i), text(i), line_of(i), column_of(i), id(i), literal(i)};
+}
+
+size_t token_buffer::memory_usage() const
+{
+  return _kinds.capacity() * sizeof(uint8_t) +
+         _offsets.capacity() * sizeof(uint32_t) +
+         _payloads.capacity() * sizeof(uint32_t) +
+         _line_starts.capacity() * sizeof(uint32_t) +
+         _literals.capacity() * sizeof(literal_entry);
+}
+
+std::string_view fixed_token_text(Token token)
+{
+  switch (token) {
+  case Token::L_PAREN:
+    return "(";
+  case Token::R_PAREN:
+    return ")";
+  case Token::L_BRACE:
+    return "{";
+  case Token::R_BRACE:
+    return "}";
+  case Token::L_BRACKET:
+    return "[";
+  case Token::R_BRACKET:
+    return "]";
+  case Token::COLON:
+    return ":";
+  case Token::SEMICOLON:
+    return ";";
+  case Token::COMMA:
+    return ",";
+  case Token::GT:
+    return ">";
+  case Token::LT:
+    return "<";
+  case Token::LTE:
+    return "<=";
+  case Token::GTE:
+    return ">=";
+  case Token::ARROW:
+    return "->";
+  case Token::ADD:
+    return "+";
+  case Token::SUB:
+    return "-";
+  case Token::MUL:
+    return "*";
+  case Token::DIV:
+    return "/";
+  case Token::MOD:
+    return "%";
+  case Token::POW:
+    return "**";
+  case Token::ADD_EQ:
+    return "+=";
+  case Token::SUB_EQ:
+    return "-=";
+  case Token::MUL_EQ:
+    return "*=";
+  case Token::DIV_EQ:
+    return "/=";
+  case Token::MOD_EQ:
+    return "%=";
+  case Token::POW_EQ:
+    return "**=";
+  case Token::AMPERSAND:
+    return "&";
+  case Token::PIPE:
+    return "|";
+  case Token::TILDE:
+    return "~";
+  case Token::HAT:
+    return "^";
+  case Token::AMPERSAND_EQ:
+    return "&=";
+  case Token::PIPE_EQ:
+    return "|=";
+  case Token::TILDE_EQ:
+    return "~=";
+  case Token::HAT_EQ:
+    return "^=";
+  case Token::EQ:
+    return "=";
+  case Token::EQ_EQ:
+    return "==";
+  case Token::AT:
+    return "@";
+  case Token::DOLLAR:
+    return "$";
+  case Token::SINGLE_QUOTE:
+    return "'";
+  case Token::QUESTION_MARK:
+    return "?";
+  case Token::PERIOD:
+    return ".";
+  case Token::OCTOTHORPE:
+    return "#";
+  case Token::OR:
+    return "||";
+  case Token::AND:
+    return "&&";
+  case Token::EXCLAMATION:
+    return "!";
+  case Token::EXCLAMATION_EQ:
+    return "!=";
+  case Token::LSH:
+    return "<<";
+  case Token::RSH:
+    return ">>";
+  case Token::LSH_EQ:
+    return "<<=";
+  case Token::RSH_EQ:
+    return ">>=";
+  default:
+    return {};
+  }
+}
+
+} // namespace titan
@@ -0,0 +1,111 @@
+#ifndef TITAN_TOKEN_BUFFER_HPP
+#define TITAN_TOKEN_BUFFER_HPP
+
+#include "atoms.hpp"
+#include "tokens.hpp"
+
+#include <cstdint>
+#include <string_view>
+#include <vector>
+
+namespace titan {
+
+//  Compact storage for the tokens of an entire source buffer.
+//
+//  Tokens are kept as parallel arrays: a one byte kind, the source offset
+//  of the token's last character and a payload. For most tokens the
+//  payload is the atom of its text (empty_atom for tokens whose text is
+//  fixed by their kind). Numeric literals are rare enough that their
+//  decoded values live in a side table, and their payload indexes it.
+//  That is 9 bytes per token where a TD_Pair is 64. Lines are kept in a
+//  separate table holding the offset at which each (trimmed) line starts,
+//  so line and column are only worked out when someone asks for them.
+//
+//  Offsets are 32 bits, so a single buffer covers sources up to 4GiB.
+//
+class token_buffer {
+public:
+  static constexpr size_t max_source_size = UINT32_MAX;
+
+  void clear();
+  void reserve(size_t tokens);
+
+  // Release any capacity left over from growing the buffer
+  void shrink_to_fit();
+
+  // Record the start of the next line. Lines must be added in order and
+  // before any of their tokens
+  void add_line(uint32_t start) { _line_starts.push_back(start); }
+
+  void push(Token token, uint32_t offset, atom id, literal_value value = {})
+  {
+    _kinds.push_back(static_cast<uint8_t>(token));
+    _offsets.push_back(offset);
+    if (has_literal(token)) {
+      _payloads.push_back(static_cast<uint32_t>(_literals.size()));
+      _literals.push_back({id, value});
+    }
+    else {
+      _payloads.push_back(id);
+    }
+  }
+
+  size_t size() const { return _kinds.size(); }
+  bool empty() const { return _kinds.empty(); }
+  size_t line_count() const { return _line_starts.size(); }
+
+  Token kind(size_t i) const { return static_cast<Token>(_kinds[i]); }
+  uint32_t offset(size_t i) const { return _offsets[i]; }
+
+  // Atom of the token's text
+  atom id(size_t i) const
+  {
+    return has_literal(kind(i)) ? _literals[_payloads[i]].id : _payloads[i];
+  }
+
+  // Decoded value of a numeric literal, empty for any other token
+  literal_value literal(size_t i) const
+  {
+    return has_literal(kind(i)) ? _literals[_payloads[i]].value
+                                : literal_value{};
+  }
+
+  // Start offset of a (1 based) line
+  uint32_t line_start(size_t line) const { return _line_starts[line - 1]; }
+
+  // 1 based line the token is on
+  size_t line_of(size_t i) const;
+
+  // Column of the token's last character within its trimmed line
+  size_t column_of(size_t i) const;
+
+  // Text of the token, as the lexer would have produced it
+  std::string_view text(size_t i) const;
+
+  // Expand a token back into a TD_Pair
+  TD_Pair at(size_t i) const;
+
+  // Bytes held by the buffer
+  size_t memory_usage() const;
+
+private:
+  struct literal_entry {
+    atom id;
+    literal_value value;
+  };
+
+  std::vector<uint8_t> _kinds;
+  std::vector<uint32_t> _offsets;
+  std::vector<uint32_t> _payloads;
+  std::vector<uint32_t> _line_starts;
+  std::vector<literal_entry> _literals;
+
+  static bool has_literal(Token token)
+  {
+    return token == Token::LITERAL_NUMBER || token == Token::LITERAL_FLOAT;
+  }
+};
+
+} // namespace titan
+
+#endif
@@ -0,0 +1,314 @@
+#include "token_stream.hpp"
+
+#include "app.hpp"
+#include "log/log.hpp"
+#include "lexer.hpp"
+#include "mapped_file.hpp"
+
+#include <algorithm>
+#include <iterator>
+
+namespace titan {
+
+namespace {
+
+// Tokens expanded per pull from a token buffer, enough to cover any
+// lookahead the parser does while keeping the window small
+constexpr size_t buffer_batch_size = 512;
+
+// Tokens lexed per batch handed from the lexing thread to the parser, and
+// how many batches may wait between them
+constexpr size_t pipeline_batch_size = 4096;
+constexpr size_t pipeline_batches = 8;
+
+// Consumed tokens are only dropped from the front of the window once
+// there are at least this many, so the erase cost is amortised
+constexpr size_t compact_threshold = 1024;
+
+TD_Pair end_of_stream = {Token::EOS, {}, 0, 0};
+
+} // namespace
+
+token_stream::token_stream()
+    : _base(0), _head(0), _mark(no_mark), _exhausted(false)
+{
+}
+
+const TD_Pair &token_stream::peek(size_t ahead)
+{
+  if (!fill(ahead)) {
+    return end_of_stream;
+  }
+  return _window[_head + ahead];
+}
+
+void token_stream::advance()
+{
+  if (fill(0)) {
+    _head++;
+  }
+}
+
+bool token_stream::at_end() { return !fill(0); }
+
+void token_stream::mark() { _mark = position(); }
+
+bool token_stream::reset()
+{
+  if (_mark == no_mark) {
+    return false;
+  }
+  _head = _mark - _base;
+  _mark = no_mark;
+  return true;
+}
+
+void token_stream::unset() { _mark = no_mark; }
+
+void token_stream::skip(size_t count)
+{
+  auto buffered = std::min(count, _window.size() - _head);
+  _head += buffered;
+  count -= buffered;
+
+  // With the window used up the source can drop the rest unread. A mark
+  // needs every token it covers so then they are walked past instead
+  if (count > 0 && _mark == no_mark) {
+    _base += _window.size();
+    _head = 0;
+    _window.clear();
+
+    auto dropped = discard(count);
+    _base += dropped;
+    count -= dropped;
+  }
+
+  for (; count > 0 && fill(0); count--) {
+    _head++;
+  }
+}
+
+bool token_stream::fill(size_t ahead)
+{
+  while (_head + ahead >= _window.size()) {
+    if (_exhausted) {
+      return false;
+    }
+    compact();
+
+    auto pulled_from = _window.size();
+    if (!pull(_window)) {
+      _exhausted = true;
+      continue;
+    }
+    LOG(TRACE) << TAG(APP_FILE_NAME) << "[" << APP_LINE << "]: Pulled "
+               << _window.size() - pulled_from << " tokens at position "
+               << _base + pulled_from << std::endl;
+  }
+  return true;
+}
+
+void token_stream::compact()
+{
+  size_t keep_from = _head;
+  if (_mark != no_mark && _mark - _base < keep_from) {
+    keep_from = _mark - _base;
+  }
+  if (keep_from < compact_threshold) {
+    return;
+  }
+
+  _window.erase(_window.begin(), _window.begin() + keep_from);
+  _base += keep_from;
+  _head -= keep_from;
+}
+
+vector_token_stream::vector_token_stream(std::vector<TD_Pair> tokens)
+    : _tokens(std::move(tokens))
+{
+}
+
+bool vector_token_stream::pull(std::vector<TD_Pair> &out)
+{
+  if (_tokens.empty()) {
+    return false;
+  }
+
+  if (out.empty()) {
+    out.swap(_tokens);
+  }
+  else {
+    out.insert(out.end(), std::make_move_iterator(_tokens.begin()),
+               std::make_move_iterator(_tokens.end()));
+  }
+  _tokens.clear();
+  return true;
+}
+
+buffer_token_stream::buffer_token_stream()
+    : _buffer(nullptr), _begin(0), _next(0), _end(0), _line(1), _whole(false)
+{
+}
+
+buffer_token_stream::buffer_token_stream(const token_buffer &buffer)
+    : buffer_token_stream()
+{
+  attach(buffer);
+}
+
+buffer_token_stream::buffer_token_stream(const token_buffer &buffer,
+                                         size_t begin, size_t end)
+    : buffer_token_stream()
+{
+  attach(buffer);
+  _end = std::min(end, buffer.size());
+  _whole = false;
+  if (begin < _end) {
+    _next = begin;
+    _line = buffer.line_of(begin);
+  }
+  else {
+    _next = _end;
+  }
+  _begin = _next;
+}
+
+void buffer_token_stream::attach(const token_buffer &buffer)
+{
+  _buffer = &buffer;
+  _begin = 0;
+  _next = 0;
+  _end = buffer.size();
+  _line = 1;
+  _whole = true;
+}
+
+const token_buffer *buffer_token_stream::whole_buffer() const
+{
+  return (_whole && position() == 0) ? _buffer : nullptr;
+}
+
+const token_buffer *buffer_token_stream::backing_buffer(size_t &begin,
+                                                        size_t &end) const
+{
+  begin = _begin;
+  end = _end;
+  return _buffer;
+}
+
+size_t buffer_token_stream::discard(size_t count)
+{
+  if (!_buffer) {
+    return 0;
+  }
+
+  auto dropped = std::min(count, _end - _next);
+  _next += dropped;
+  if (_next < _end) {
+    _line = _buffer->line_of(_next);
+  }
+  return dropped;
+}
+
+bool buffer_token_stream::pull(std::vector<TD_Pair> &out)
+{
+  if (!_buffer || _next >= _end) {
+    return false;
+  }
+
+  // Tokens come out in source order so the line table is walked forward
+  // alongside them rather than searched for each token
+  auto end = std::min(_next + buffer_batch_size, _end);
+  auto lines = _buffer->line_count();
+  for (; _next < end; _next++) {
+    auto offset = _buffer->offset(_next);
+    while (_line < lines && _buffer->line_start(_line + 1) <= offset) {
+      _line++;
+    }
+    out.emplace_back(TD_Pair{_buffer->kind(_next), _buffer->text(_next), _line,
+                             offset - _buffer->line_start(_line),
+                             _buffer->id(_next), _buffer->literal(_next)});
+  }
+  return true;
+}
+
+bool file_token_stream::open(const std::string &path, bool quiet)
+{
+  mapped_file source;
+  if (!source.open(path)) {
+    return false;
+  }
+  if (source.view().size() > token_buffer::max_source_size) {
+    return false;
+  }
+
+  // Tokens never refer back to the source text, so the file does not
+  // need to stay mapped once it has been lexed
+  lexer l(path);
+  l.set_quiet(quiet);
+  l.lex_buffer(source.view(), _tokens);
+  attach(_tokens);
+  return true;
+}
+
+pipelined_token_stream::pipelined_token_stream()
+    : _batches(pipeline_batches)
+{
+}
+
+pipelined_token_stream::~pipelined_token_stream()
+{
+  // Lets the lexing thread go if the parser stopped before the end
+  _batches.close();
+  if (_lexer.joinable()) {
+    _lexer.join();
+  }
+}
+
+bool pipelined_token_stream::open(const std::string &path)
+{
+  if (_lexer.joinable() || !_source.open(path)) {
+    return false;
+  }
+  _path = path;
+
+  _lexer = std::thread([this]() {
+    lexer l(_path);
+    l.set_hold_errors(true);
+    l.load(_source.view());
+
+    bool more = true;
+    while (more) {
+      batch next;
+      more = l.lex_next(next.tokens, pipeline_batch_size);
+      next.errors = l.take_errors();
+      if ((!next.tokens.empty() || !next.errors.empty()) &&
+          !_batches.push(std::move(next))) {
+        break;
+      }
+    }
+    _batches.close();
+  });
+  return true;
+}
+
+bool pipelined_token_stream::pull(std::vector<TD_Pair> &out)
+{
+  batch next;
+  while (_batches.pop(next)) {
+    if (!next.errors.empty()) {
+      lexer reporter(_path);
+      for (auto &error : next.errors) {
+        reporter.report(error);
+      }
+    }
+    if (!next.tokens.empty()) {
+      out.insert(out.end(), std::make_move_iterator(next.tokens.begin()),
+                 std::make_move_iterator(next.tokens.end()));
+      return true;
+    }
+  }
+  return false;
+}
+
+} // namespace titan
@@ -0,0 +1,185 @@
+#ifndef TITAN_TOKEN_STREAM_HPP
+#define TITAN_TOKEN_STREAM_HPP
+
+#include "jobs/spsc_queue.hpp"
+#include "lexer.hpp"
+#include "mapped_file.hpp"
+#include "token_buffer.hpp"
+#include "tokens.hpp"
+
+#include <limits>
+#include <memory>
+#include <string>
+#include <thread>
+#include <vector>
+
+namespace titan {
+
+//  Pull based source of tokens for the parser.
+//
+//  Tokens are pulled from the underlying source on demand into a window
+//  that only holds what the reader can still get to: tokens behind the
+//  current one are dropped unless a mark is holding them. Lookahead
+//  extends the window as far as it is asked to.
+//
+class token_stream {
+public:
+  token_stream();
+  virtual ~token_stream() = default;
+
+  token_stream(const token_stream &) = delete;
+  token_stream &operator=(const token_stream &) = delete;
+
+  // The token 'ahead' positions from the current token. Returns an EOS
+  // token if the stream ends before that
+  const TD_Pair &peek(size_t ahead = 0);
+
+  // Move to the next token. Does nothing once at the end
+  void advance();
+
+  // True if there is no current token
+  bool at_end();
+
+  // Remember the current position so the stream can be reset to it
+  void mark();
+
+  // Return to the marked position and clear the mark.
+  // Returns false if no mark was set
+  bool reset();
+
+  // Clear the mark without moving
+  void unset();
+
+  // Move past the next 'count' tokens. Tokens the window does not hold yet
+  // are dropped by the source without being expanded. Stops at the end
+  void skip(size_t count);
+
+  // Number of tokens advanced past since the start of the stream
+  size_t position() const { return _base + _head; }
+
+  // The token buffer behind the stream when the stream covers all of it,
+  // so a reader that has not started yet can work on the buffer directly
+  virtual const token_buffer *whole_buffer() const { return nullptr; }
+
+  // The token buffer behind the stream, if there is one, along with the
+  // range [begin, end) of it that the stream covers
+  virtual const token_buffer *backing_buffer(size_t & /*begin*/,
+                                             size_t & /*end*/) const
+  {
+    return nullptr;
+  }
+
+protected:
+  // Append the next batch of tokens to 'out'.
+  // Return false if the source is exhausted and nothing was appended
+  virtual bool pull(std::vector<TD_Pair> &out) = 0;
+
+  // Drop up to 'count' tokens from the source without pulling them.
+  // Returns how many were dropped
+  virtual size_t discard(size_t /*count*/) { return 0; }
+
+private:
+  static constexpr size_t no_mark = std::numeric_limits<size_t>::max();
+
+  std::vector<TD_Pair> _window;
+  size_t _base; // Stream position of _window[0]
+  size_t _head; // Index of the current token in _window
+  size_t _mark;
+  bool _exhausted;
+
+  bool fill(size_t ahead);
+  void compact();
+};
+
+using token_stream_ptr = std::unique_ptr<token_stream>;
+
+//  Stream over tokens that have already been lexed (i.e a REPL line)
+//
+class vector_token_stream : public token_stream {
+public:
+  vector_token_stream() = default;
+  explicit vector_token_stream(std::vector<TD_Pair> tokens);
+
+protected:
+  bool pull(std::vector<TD_Pair> &out) override;
+
+private:
+  std::vector<TD_Pair> _tokens;
+};
+
+//  Stream over a compact token buffer, expanding tokens into the window
+//  as they are pulled. The buffer must outlive the stream
+//
+class buffer_token_stream : public token_stream {
+public:
+  buffer_token_stream();
+  explicit buffer_token_stream(const token_buffer &buffer);
+
+  // Stream over tokens [begin, end) of the buffer
+  buffer_token_stream(const token_buffer &buffer, size_t begin, size_t end);
+
+  const token_buffer *whole_buffer() const override;
+  const token_buffer *backing_buffer(size_t &begin,
+                                     size_t &end) const override;
+
+protected:
+  void attach(const token_buffer &buffer);
+  bool pull(std::vector<TD_Pair> &out) override;
+  size_t discard(size_t count) override;
+
+private:
+  const token_buffer *_buffer;
+  size_t _begin;
+  size_t _next;
+  size_t _end;
+  size_t _line;
+  bool _whole;
+};
+
+//  Stream over a source file. The file is lexed into a compact token
+//  buffer when opened and expanded a batch at a time as the parser reads
+//
+class file_token_stream : public buffer_token_stream {
+public:
+  // Lex the file. Returns false if it can not be opened or is too large.
+  // When quiet, lexer errors are left unreported
+  bool open(const std::string &path, bool quiet = false);
+
+private:
+  token_buffer _tokens;
+};
+
+//  Stream over a source file that is lexed on a thread of its own while
+//  the parser reads it. Tokens are handed over in batches through a
+//  bounded queue, so only a few batches are held at any time and parsing
+//  starts on the first of them rather than once the whole file is lexed.
+//  Lexer errors are reported as the batch they were found in is pulled.
+//  There is no token buffer behind the stream, so the parser reads it
+//  from start to end on one thread
+//
+class pipelined_token_stream : public token_stream {
+public:
+  pipelined_token_stream();
+  ~pipelined_token_stream() override;
+
+  // Start lexing the file. Returns false if it can not be opened
+  bool open(const std::string &path);
+
+protected:
+  bool pull(std::vector<TD_Pair> &out) override;
+
+private:
+  struct batch {
+    std::vector<TD_Pair> tokens;
+    std::vector<lexer::error_report> errors;
+  };
+
+  std::string _path;
+  mapped_file _source;
+  jobs::spsc_queue<batch> _batches;
+  std::thread _lexer;
+};
+
+} // namespace titan
+
+#endif
@@ -1,11 +1,15 @@
 #ifndef TITAN_TOKENS_HPP
 #define TITAN_TOKENS_HPP
 
+#include "atoms.hpp"
+
+#include <cstdint>
 #include <string>
+#include <string_view>
 
 namespace titan {
 
-enum class Token {
+enum class Token : uint8_t {
   FN = 0,
   IDENTIFIER,
   L_PAREN,
@@ -73,11 +77,40 @@ enum class Token {
   EOS  // End of stream
 };
 
+//  Number of token kinds, for tables indexed by Token
+static constexpr size_t TOKEN_COUNT = static_cast<size_t>(Token::EOS) + 1;
+
+//  Text of tokens whose text is fixed by their kind ("+=", "(" ...).
+//  Empty for keywords and for tokens that carry their own text
+//
+extern std::string_view fixed_token_text(Token token);
+
+//  Narrowest type able to hold a numeric literal, as decided by the lexer
+//
+enum class literal_type : uint8_t { NONE, I8, I16, I32, I64, U64, FLOAT };
+
+//  Value of a numeric literal, decoded once by the lexer
+//
+struct literal_value {
+  literal_type type;
+  union {
+    uint64_t integer;
+    double real;
+  };
+};
+
+//  Token and its origination data. The text in 'data' is never owned by
+//  the token; it refers to either static token text or to interned text
+//  (see atoms.hpp) whose atom is held in 'id'. Numeric literals also
+//  carry their decoded value
+//
 struct TD_Pair {
   Token token;
-  std::string data;
+  std::string_view data;
   size_t line;
   size_t col;
+  atom id = empty_atom;
+  literal_value value = {literal_type::NONE, {0}};
 };
 
 static std::string token_to_str(const TD_Pair &td)
@@ -89,8 +122,8 @@ static std::string token_to_str(const TD_Pair &td)
     return "FN[" + std::to_string(td.line) + ", " + std::to_string(td.col) +
            "]";
   case Token::IDENTIFIER:
-    return "IDENTIFIER(" + td.data + ")[" + std::to_string(td.line) + ", " +
-           std::to_string(td.col) + "]";
+    return "IDENTIFIER(" + std::string(td.data) + ")[" +
+           std::to_string(td.line) + ", " + std::to_string(td.col) + "]";
   case Token::L_BRACKET:
     return "L_BRACKET[" + std::to_string(td.line) + ", " +
            std::to_string(td.col) + "]";
@@ -206,8 +239,8 @@ static std::string token_to_str(const TD_Pair &td)
     return "DOLLAR[" + std::to_string(td.line) + ", " + std::to_string(td.col) +
            "]";
   case Token::STRING:
-    return "STRING(" + td.data + ")[" + std::to_string(td.line) + ", " +
-           std::to_string(td.col) + "]";
+    return "STRING(" + std::string(td.data) + ")[" + std::to_string(td.line) +
+           ", " + std::to_string(td.col) + "]";
   case Token::SINGLE_QUOTE:
     return "SINGLE_QUOTE[" + std::to_string(td.line) + ", " +
            std::to_string(td.col) + "]";
@@ -221,11 +254,11 @@ static std::string token_to_str(const TD_Pair &td)
     return "OCTOTHORPE[" + std::to_string(td.line) + ", " +
            std::to_string(td.col) + "]";
   case Token::LITERAL_FLOAT:
-    return "FLOAT(" + td.data + ")[" + std::to_string(td.line) + ", " +
-           std::to_string(td.col) + "]";
+    return "FLOAT(" + std::string(td.data) + ")[" + std::to_string(td.line) +
+           ", " + std::to_string(td.col) + "]";
   case Token::LITERAL_NUMBER:
-    return "NUMBER(" + td.data + ")[" + std::to_string(td.line) + ", " +
-           std::to_string(td.col) + "]";
+    return "NUMBER(" + std::string(td.data) + ")[" + std::to_string(td.line) +
+           ", " + std::to_string(td.col) + "]";
   case Token::OR:
     return "OR[" + std::to_string(td.line) + ", " + std::to_string(td.col) +
            "]";
@@ -0,0 +1,93 @@
+#ifndef TITAN_WORD_TABLE_HPP
+#define TITAN_WORD_TABLE_HPP
+
+#include <array>
+#include <cstdint>
+#include <string_view>
+
+namespace titan {
+
+template <class V> struct word_entry {
+  std::string_view word;
+  V value;
+};
+
+//  Perfect hash over a fixed set of words, generated at compile time.
+//
+//  A seed is searched for while the table is being built so that every
+//  word lands in its own slot. Classifying a word then costs one hash of
+//  at most four characters and a single slot comparison, regardless of
+//  how many words are in the table. If a new word makes a perfect hash
+//  impossible for the table size the static_assert at the definition
+//  site will fail and the table size can be bumped.
+//
+template <class V, size_t N, size_t Slots> class word_table {
+public:
+  static_assert((Slots & (Slots - 1)) == 0, "Slot count must be power of 2");
+  static_assert(Slots >= N, "Not enough slots for all words");
+
+  constexpr word_table(const word_entry<V> (&entries)[N])
+      : _seed(0), _slots{}, _used{}
+  {
+    for (uint32_t seed = 1; seed < max_seed; seed++) {
+      if (try_seed(entries, seed)) {
+        _seed = seed;
+        return;
+      }
+    }
+  }
+
+  // True if a collision free seed was found
+  constexpr bool is_perfect() const { return _seed != 0; }
+
+  // Look up a word. Returns true and sets 'out' iff the word is in the table
+  constexpr bool find(std::string_view word, V &out) const
+  {
+    if (word.empty()) {
+      return false;
+    }
+    auto slot = hash(word, _seed) & (Slots - 1);
+    if (!_used[slot] || _slots[slot].word != word) {
+      return false;
+    }
+    out = _slots[slot].value;
+    return true;
+  }
+
+private:
+  static constexpr uint32_t max_seed = 1 << 16;
+
+  uint32_t _seed;
+  std::array<word_entry<V>, Slots> _slots;
+  std::array<bool, Slots> _used;
+
+  static constexpr uint32_t hash(std::string_view word, uint32_t seed)
+  {
+    auto at = [&](size_t i) { return static_cast<uint8_t>(word[i]); };
+    uint32_t h = seed ^ static_cast<uint32_t>(word.size());
+    h = (h * 0x9E3779B1u) ^ at(0);
+    h = (h * 0x9E3779B1u) ^ at(word.size() / 2);
+    h = (h * 0x9E3779B1u) ^ at(word.size() - 1);
+    return h ^ (h >> 16);
+  }
+
+  constexpr bool try_seed(const word_entry<V> (&entries)[N], uint32_t seed)
+  {
+    for (size_t i = 0; i < Slots; i++) {
+      _used[i] = false;
+    }
+    for (size_t i = 0; i < N; i++) {
+      auto slot = hash(entries[i].word, seed) & (Slots - 1);
+      if (_used[slot]) {
+        return false;
+      }
+      _used[slot] = true;
+      _slots[slot] = entries[i];
+    }
+    return true;
+  }
+};
+
+} // namespace titan
+
+#endif
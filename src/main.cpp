@@ -2,8 +2,10 @@
 #include "app.hpp"
 #include "titan.hpp"
 #include "log/log.hpp"
+#include "jobs/jobs.hpp"
 
 #include <iostream>
+#include <cstdlib>
 #include <filesystem>
 #include <string>
 #include <vector>
@@ -75,6 +77,12 @@ int show_usage(std::string_view program_name)
   std::cout << "  -h --help             Show this help screen\n";
   std::cout << "  -a --analyze          Analyze input before execution\n";
   std::cout << "  -n --norun            Disable execution\n";
+  std::cout << "  -k --keep             Keep parsed nodes across REPL lines\n";
+  std::cout << "  -j --jobs <n>         Parse and analyze functions on n threads (0 for one per core)\n";
+  std::cout << "  -p --preparse         Parse imported function bodies only when used\n";
+  std::cout << "  -c --cache            Keep parsed files in .tlc files beside them\n";
+  std::cout << "  -s --stream           Lex files on their own thread while parsing them (parsing then ignores -j, -p, -c)\n";
+  std::cout << "  -t --stats            Show what constant folding changed (with -a)\n";
   std::cout << "  -i --include          Include a ':' delimited directory list\n";
   std::cout << "  -l --log <level>      Set logging level\n";
   std::cout << "\n     Levels:\n";
@@ -137,6 +145,12 @@ int main(int argc, char **argv)
 
   bool analyze = false;
   bool execute = true;
+  bool keep_nodes = false;
+  size_t jobs = 1;
+  bool lazy_imports = false;
+  bool cache = false;
+  bool pipeline = false;
+  bool stats = false;
   std::string_view program_name = arguments[0];
   std::vector<std::string> include_dirs;
   std::string file;
@@ -159,6 +173,44 @@ int main(int argc, char **argv)
       continue;
     }
 
+    if (arg == "-k" || arg == "--keep") {
+      keep_nodes = true;
+      continue;
+    }
+
+    if (arg == "-p" || arg == "--preparse") {
+      lazy_imports = true;
+      continue;
+    }
+
+    if (arg == "-c" || arg == "--cache") {
+      cache = true;
+      continue;
+    }
+
+    if (arg == "-s" || arg == "--stream") {
+      pipeline = true;
+      continue;
+    }
+
+    if (arg == "-t" || arg == "--stats") {
+      stats = true;
+      continue;
+    }
+
+    if (arg == "-j" || arg == "--jobs") {
+      if (arguments.size() <= idx + 1) {
+        std::cout << "No value given to \"" << arg << "\"" << std::endl;
+        std::exit(0);
+      }
+      jobs = std::strtoul(arguments[idx + 1].c_str(), nullptr, 10);
+      if (jobs == 0) {
+        jobs = titan::jobs::hardware_workers();
+      }
+      idx += 1;
+      continue;
+    }
+
     if (arg == "-l" || arg == "--log") {
       if (arguments.size() <= idx + 1) {
         std::cout << "No value given to \"" << arg << "\"" << std::endl;
@@ -192,6 +244,23 @@ int main(int argc, char **argv)
 
   setup_logger();
 
+  // A file lexed while it is parsed has no token buffer behind it to split
+  // across threads, skip bodies of, or store
+  if (pipeline && (jobs > 1 || lazy_imports || cache)) {
+    std::string ignored;
+    if (jobs > 1) {
+      ignored += " -j";
+    }
+    if (lazy_imports) {
+      ignored += " -p";
+    }
+    if (cache) {
+      ignored += " -c";
+    }
+    std::cout << "Warning : -s parses files as they are lexed, so" << ignored
+              << " will not apply to parsing them" << std::endl;
+  }
+
   if (!analyze && !execute) {
     std::cout << "Nothing to do" << std::endl;
     return 0;
@@ -200,6 +269,13 @@ int main(int argc, char **argv)
   titan::titan t;
   t.set_analyze(analyze);
   t.set_execute(execute);
+  t.set_keep_nodes(keep_nodes);
+  t.set_jobs(jobs);
+  t.set_lazy_imports(lazy_imports);
+  t.set_cache(cache);
+  t.set_pipeline(pipeline);
+  t.set_stats(stats);
+  t.set_include_dirs(include_dirs);
 
   if (file.empty()) {
     return t.do_repl();
@@ -0,0 +1,191 @@
+#include "analyze/analyzer.hpp"
+#include "lang/arena.hpp"
+#include "parsing.hpp"
+
+#include <CppUTest/TestHarness.h>
+
+#include <string>
+#include <vector>
+
+namespace
+{
+  using parsing::parse;
+}
+
+TEST_GROUP(analyzer_tests){};
+
+TEST(analyzer_tests, typed_expressions)
+{
+  using namespace titan::instructions;
+
+  titan::arena nodes;
+  auto items = parse("fn widen(a:u8, b:u64) -> u64 {\n"
+                     "  let c:u64 = a + b;\n"
+                     "  return c;\n"
+                     "}\n"
+                     "let r:u64 = widen(b, 2);\n"
+                     "let b:u8 = 1;\n",
+                     nodes);
+  CHECK_EQUAL(3, items.size());
+
+  // 'b' is used before it is declared
+  titan::analyzer a;
+  CHECK_FALSE(a.analyze(items));
+
+  auto fn = static_cast<function *>(items[0]);
+  auto assign = static_cast<assignment_instruction *>(fn->instruction_list[0]);
+  auto sum = static_cast<infix_expr *>(assign->expr);
+  CHECK_TRUE(sum->typed);
+  CHECK_TRUE(sum->resolved_type == variable_types::U64);
+  CHECK_EQUAL(0, sum->resolved_depth);
+  CHECK_TRUE(sum->cast_to == variable_types::UNDEF);
+
+  // The narrower operand is widened
+  CHECK_TRUE(sum->left->target == fn->parameters[0]);
+  CHECK_TRUE(sum->left->cast_to == variable_types::U64);
+  CHECK_TRUE(sum->right->target == fn->parameters[1]);
+  CHECK_TRUE(sum->right->cast_to == variable_types::UNDEF);
+
+  auto ret = static_cast<return_instruction *>(fn->instruction_list[1]);
+  CHECK_TRUE(ret->expr->typed);
+  CHECK_TRUE(ret->expr->target == assign->var);
+
+  // A call that fails to check still knows what it calls
+  auto call_assign = static_cast<assignment_instruction *>(items[1]);
+  auto call = static_cast<function_call_expr *>(call_assign->expr);
+  CHECK_TRUE(call->target == fn);
+  CHECK_FALSE(call->typed);
+  CHECK_FALSE(call->params[0]->typed);
+  CHECK_TRUE(call->params[0]->target == nullptr);
+}
+
+TEST(analyzer_tests, deep_expressions)
+{
+  using namespace titan::instructions;
+
+  // As deep as the parser goes: 1 + (1 + ( ... )) and f(b[f(b[ ... ], 0)], 0)
+  constexpr size_t depth = 100000;
+  std::string source = "fn f(a:u8[2], i:u8) -> u8 {\n"
+                       "  return i;\n"
+                       "}\n"
+                       "fn g() -> u8 {\n"
+                       "  let b:u8[2] = {1, 2};\n"
+                       "  let s:i64 = ";
+  for (size_t i = 0; i < depth; i++) {
+    source += "1 + (";
+  }
+  source += "1" + std::string(depth, ')') + ";\n  return ";
+  for (size_t i = 0; i < depth; i++) {
+    source += "f(b[";
+  }
+  source += "0";
+  for (size_t i = 0; i < depth; i++) {
+    source += "], 0)";
+  }
+  source += ";\n}\n";
+
+  titan::arena nodes;
+  auto items = parse(source, nodes);
+  CHECK_EQUAL(2, items.size());
+
+  titan::analyzer a;
+  CHECK_TRUE(a.analyze(items));
+
+  auto &body = static_cast<function *>(items[1])->instruction_list;
+
+  size_t found = 0;
+  auto expr = static_cast<assignment_instruction *>(body[1])->expr;
+  CHECK_TRUE(expr->cast_to == variable_types::I64);
+  while (expr->type == node_type::INFIX) {
+    CHECK_TRUE(expr->typed);
+    CHECK_TRUE(expr->resolved_type == variable_types::I8);
+    expr = static_cast<infix_expr *>(expr)->right;
+    found++;
+  }
+  CHECK_EQUAL(depth, found);
+
+  found = 0;
+  expr = static_cast<return_instruction *>(body[2])->expr;
+  while (expr->type == node_type::CALL) {
+    auto call = static_cast<function_call_expr *>(expr);
+    CHECK_TRUE(call->typed);
+    CHECK_TRUE(call->target == items[0]);
+    auto idx = call->params[0];
+    CHECK_TRUE(idx->typed);
+    CHECK_TRUE(idx->resolved_type == variable_types::U8);
+    expr = static_cast<array_index_expr *>(idx)->index;
+    found++;
+  }
+  CHECK_EQUAL(depth, found);
+}
+
+TEST(analyzer_tests, stops_checking_bodies_after_abort)
+{
+  using namespace titan::instructions;
+
+  // Each of the first bodies uses a variable that is never declared, which
+  // is enough to give up before the last one is reached
+  std::string source;
+  for (size_t i = 0; i < 12; i++) {
+    source += "fn e" + std::to_string(i) + "() -> u8 {\n"
+              "  let v:u8 = missing;\n"
+              "  return v;\n"
+              "}\n";
+  }
+  source += "fn last() -> u8 {\n"
+            "  return 1 + 2;\n"
+            "}\n";
+
+  for (size_t jobs : {1, 4}) {
+    titan::arena nodes;
+    auto items = parse(source, nodes);
+    CHECK_EQUAL(13, items.size());
+
+    titan::analyzer a;
+    a.set_jobs(jobs);
+    CHECK_FALSE(a.analyze(items));
+
+    // Checked bodies type what they can
+    auto first = static_cast<function *>(items[0]);
+    auto ret = static_cast<return_instruction *>(first->instruction_list[1]);
+    CHECK_TRUE(ret->expr->typed);
+
+    // Bodies are handed out in order, so one thread never gets this far
+    if (jobs == 1) {
+      auto last = static_cast<function *>(items[12]);
+      ret = static_cast<return_instruction *>(last->instruction_list[0]);
+      CHECK_FALSE(ret->expr->typed);
+    }
+  }
+}
+
+TEST(analyzer_tests, failed_batch_drops_its_globals)
+{
+  // As one REPL line after another, all checked by the same session
+  titan::arena nodes;
+  titan::analyzer a;
+
+  auto first = parse("let g:u8 = 1;\n"
+                     "fn a() -> u8 {\n"
+                     "  return missing;\n"
+                     "}\n",
+                     nodes);
+  CHECK_EQUAL(2, first.size());
+  CHECK_FALSE(a.analyze(first));
+
+  // Neither 'g' nor 'a' were kept, so defining them again is fine
+  auto second = parse("let g:u8 = 2;\n"
+                      "fn a() -> u8 {\n"
+                      "  return g;\n"
+                      "}\n",
+                      nodes);
+  CHECK_EQUAL(2, second.size());
+  CHECK_TRUE(a.analyze(second));
+
+  // What passed is kept
+  auto third = parse("fn a() -> u8 {\n"
+                     "  return 3;\n"
+                     "}\n",
+                     nodes);
+  CHECK_FALSE(a.analyze(third));
+}
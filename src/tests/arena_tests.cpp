@@ -0,0 +1,88 @@
+#include "lang/arena.hpp"
+
+#include <CppUTest/TestHarness.h>
+
+#include <cstdint>
+#include <string>
+#include <vector>
+
+namespace
+{
+  struct tracked {
+    tracked(int &count, std::vector<int> &order, int id)
+        : count(count), order(order), id(id)
+    {
+      count++;
+    }
+    ~tracked()
+    {
+      count--;
+      order.push_back(id);
+    }
+    int &count;
+    std::vector<int> &order;
+    int id;
+  };
+
+  struct plain {
+    uint8_t tag;
+    double value;
+  };
+}
+
+TEST_GROUP(arena_tests){};
+
+TEST(arena_tests, make)
+{
+  titan::arena nodes;
+  auto p = nodes.make<plain>(plain{1, 2.5});
+  auto s = nodes.make<std::string>("a string too long for small storage");
+
+  CHECK_EQUAL(1, p->tag);
+  CHECK_EQUAL(2.5, p->value);
+  STRCMP_EQUAL("a string too long for small storage", s->c_str());
+  CHECK_EQUAL(0, reinterpret_cast<uintptr_t>(p) % alignof(plain));
+  CHECK_EQUAL(0, reinterpret_cast<uintptr_t>(s) % alignof(std::string));
+  CHECK_TRUE(nodes.bytes_used() >= sizeof(plain) + sizeof(std::string));
+}
+
+TEST(arena_tests, release_destroys_in_reverse)
+{
+  int count = 0;
+  std::vector<int> order;
+  {
+    titan::arena nodes;
+    for (int i = 0; i < 3; i++) {
+      nodes.make<tracked>(count, order, i);
+    }
+    CHECK_EQUAL(3, count);
+
+    nodes.release();
+    CHECK_EQUAL(0, count);
+    CHECK_EQUAL(0, nodes.bytes_used());
+    CHECK_EQUAL(3, order.size());
+    CHECK_EQUAL(2, order[0]);
+    CHECK_EQUAL(0, order[2]);
+
+    // Whatever is still held goes with the arena
+    nodes.make<tracked>(count, order, 3);
+    CHECK_EQUAL(1, count);
+  }
+  CHECK_EQUAL(0, count);
+}
+
+TEST(arena_tests, grows_and_keeps_first_block)
+{
+  titan::arena nodes;
+  for (size_t i = 0; i < 3 * titan::arena::block_size / sizeof(plain); i++) {
+    nodes.make<plain>(plain{static_cast<uint8_t>(i), 0});
+  }
+  CHECK_TRUE(nodes.bytes_reserved() >= 3 * titan::arena::block_size);
+
+  // Larger than a block gets a block of its own
+  auto big = nodes.allocate(2 * titan::arena::block_size, 8);
+  CHECK_TRUE(big != nullptr);
+
+  nodes.release();
+  CHECK_EQUAL(titan::arena::block_size, nodes.bytes_reserved());
+}
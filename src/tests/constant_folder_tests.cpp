@@ -0,0 +1,170 @@
+#include "analyze/analyzer.hpp"
+#include "analyze/constant_folder.hpp"
+#include "lang/arena.hpp"
+#include "parsing.hpp"
+
+#include <CppUTest/TestHarness.h>
+
+#include <string>
+#include <vector>
+
+namespace
+{
+  using namespace titan::instructions;
+
+  using parsing::parse;
+
+  expr_ptr expr_of(instruction_ptr ins)
+  {
+    return static_cast<assignment_instruction *>(ins)->expr;
+  }
+
+  bool is_int(expr_ptr expr, variable_types type, uint64_t value)
+  {
+    if (expr->type != node_type::RAW_NUMBER) {
+      return false;
+    }
+    auto raw = static_cast<raw_int_expr *>(expr);
+    return raw->typed && raw->resolved_type == type && raw->as == type &&
+           raw->with_val == value;
+  }
+}
+
+TEST_GROUP(constant_folder_tests){};
+
+TEST(constant_folder_tests, typed_overflow)
+{
+  titan::arena nodes;
+  auto items = parse("fn f() -> u32 {\n"
+                     "  let a:u32 = 4 * 1024 + 16;\n"
+                     "  let b:u8 = 200;\n"
+                     "  let c:u8 = b + b;\n"
+                     "  let d:i8 = -(127 + 1);\n"
+                     "  let e:u8 = 250 + 10;\n"
+                     "  let g:float = 1.5 * 2;\n"
+                     "  let h:i8 = 1 / 0;\n"
+                     "  let i:i16 = 1 << 16;\n"
+                     "  return a;\n"
+                     "}\n",
+                     nodes);
+  CHECK_EQUAL(1, items.size());
+
+  titan::analyzer a;
+  CHECK_TRUE(a.analyze(items));
+
+  titan::constant_folder folder(nodes);
+  folder.fold(items);
+
+  auto &body = static_cast<function *>(items[0])->instruction_list;
+  CHECK_TRUE(is_int(expr_of(body[0]), variable_types::I16, 4112));
+  CHECK_TRUE(expr_of(body[0])->cast_to == variable_types::U32);
+
+  // Worked out as u8 once 'b' is put in place
+  CHECK_TRUE(is_int(expr_of(body[2]), variable_types::U8, 144));
+
+  CHECK_TRUE(is_int(expr_of(body[3]), variable_types::I8,
+                    static_cast<uint64_t>(-128)));
+
+  // Worked out as i16 and converted to u8 where it is used
+  CHECK_TRUE(is_int(expr_of(body[4]), variable_types::I16, 260));
+  CHECK_TRUE(expr_of(body[4])->cast_to == variable_types::U8);
+
+  auto g = expr_of(body[5]);
+  CHECK_TRUE(g->type == node_type::RAW_FLOAT);
+  DOUBLES_EQUAL(3.0, static_cast<raw_float_expr *>(g)->with_val, 0);
+
+  // Left for the runtime to fault on
+  CHECK_TRUE(expr_of(body[6])->type == node_type::INFIX);
+  CHECK_TRUE(expr_of(body[7])->type == node_type::INFIX);
+
+  auto ret = static_cast<return_instruction *>(body[8]);
+  CHECK_TRUE(is_int(ret->expr, variable_types::U32, 4112));
+
+  auto &counts = folder.totals();
+  CHECK_EQUAL(7, counts.folded);
+  CHECK_EQUAL(3, counts.propagated);
+  CHECK_EQUAL(0, counts.pruned);
+}
+
+TEST(constant_folder_tests, propagate_and_prune)
+{
+  titan::arena nodes;
+  auto items = parse("let g:u8 = 3;\n"
+                     "fn f(p:u8) -> u8 {\n"
+                     "  let k:u8 = 2;\n"
+                     "  let m:u8 = 2;\n"
+                     "  m += 1;\n"
+                     "  if (k > 2) { return 1; }\n"
+                     "  else if (p) { return 2; }\n"
+                     "  else if (k) { return 3; }\n"
+                     "  else { return 4; }\n"
+                     "  if (k == 3) { return 5; }\n"
+                     "  if (m) { return 6; }\n"
+                     "  return g + m;\n"
+                     "}\n",
+                     nodes);
+  CHECK_EQUAL(2, items.size());
+
+  titan::analyzer a;
+  CHECK_TRUE(a.analyze(items));
+
+  titan::constant_folder folder(nodes);
+  folder.fold(items);
+
+  auto fn = static_cast<function *>(items[1]);
+  auto &body = fn->instruction_list;
+
+  // The second if is never taken
+  CHECK_EQUAL(6, body.size());
+
+  // Only what can be reached is kept, up to the segment always taken
+  auto first = static_cast<if_instruction *>(body[3]);
+  CHECK_EQUAL(2, first->segments.size());
+  CHECK_TRUE(first->segments[0].expr->target == fn->parameters[0]);
+  CHECK_TRUE(is_int(first->segments[1].expr, variable_types::U8, 2));
+
+  // Written to after it is declared
+  auto second = static_cast<if_instruction *>(body[4]);
+  CHECK_EQUAL(1, second->segments.size());
+  CHECK_TRUE(second->segments[0].expr->type == node_type::ID);
+
+  // Globals are left alone
+  auto ret = static_cast<return_instruction *>(body[5]);
+  CHECK_TRUE(ret->expr->type == node_type::INFIX);
+
+  auto &counts = folder.totals();
+  CHECK_EQUAL(2, counts.folded);
+  CHECK_EQUAL(3, counts.propagated);
+  CHECK_EQUAL(3, counts.pruned);
+}
+
+TEST(constant_folder_tests, deep_expressions)
+{
+  // 1 + (1 + ( ... )), wrapping at i8 on the way
+  constexpr size_t depth = 100000;
+  std::string source = "fn f() -> i64 {\n  let s:i64 = ";
+  for (size_t i = 0; i < depth; i++) {
+    source += "1 + (";
+  }
+  source += "1" + std::string(depth, ')') + ";\n  return s;\n}\n";
+
+  titan::arena nodes;
+  auto items = parse(source, nodes);
+  CHECK_EQUAL(1, items.size());
+
+  titan::analyzer a;
+  CHECK_TRUE(a.analyze(items));
+
+  titan::constant_folder folder(nodes);
+  folder.fold(items);
+
+  auto &body = static_cast<function *>(items[0])->instruction_list;
+  CHECK_TRUE(is_int(expr_of(body[0]), variable_types::I8,
+                    static_cast<uint64_t>(int64_t((depth + 1) % 256) - 256)));
+  CHECK_TRUE(expr_of(body[0])->cast_to == variable_types::I64);
+
+  auto ret = static_cast<return_instruction *>(body[1]);
+  CHECK_TRUE(is_int(ret->expr, variable_types::I64,
+                    static_cast<uint64_t>(int64_t((depth + 1) % 256) - 256)));
+  CHECK_EQUAL(depth, folder.totals().folded);
+}
@@ -0,0 +1,231 @@
+#include "lang/arena.hpp"
+#include "lang/flat_ast.hpp"
+#include "parsing.hpp"
+
+#include <CppUTest/TestHarness.h>
+
+#include <string>
+#include <vector>
+
+namespace
+{
+  using parsing::parse;
+
+  // Node operands that are node indices, by kind
+  std::vector<uint32_t> children(const titan::flat_ast &ast,
+                                 const titan::flat_ast::node &n)
+  {
+    using kind = titan::flat_ast::kind;
+    std::vector<uint32_t> result;
+    auto add_list = [&](uint32_t l) {
+      for (auto i : ast.items(l)) {
+        result.push_back(i);
+      }
+    };
+    switch (n.type) {
+    case kind::PREFIX:
+    case kind::EXPRESSION:
+    case kind::RETURN:
+      result.push_back(n.lhs);
+      break;
+    case kind::INFIX:
+    case kind::ARRAY_IDX:
+      result.push_back(n.lhs);
+      result.push_back(n.rhs);
+      break;
+    case kind::ASSIGN:
+      result.push_back(n.rhs);
+      break;
+    case kind::ARRAY:
+    case kind::IF:
+      add_list(n.lhs);
+      break;
+    case kind::CALL:
+    case kind::IF_SEGMENT:
+    case kind::WHILE:
+      result.push_back(n.lhs);
+      add_list(n.rhs);
+      break;
+    case kind::FOR:
+      for (uint32_t i = 0; i < 3; i++) {
+        result.push_back(ast.extra(n.lhs, i));
+      }
+      add_list(n.rhs);
+      break;
+    case kind::FUNCTION:
+      add_list(n.rhs);
+      break;
+    default:
+      break;
+    }
+    return result;
+  }
+}
+
+TEST_GROUP(flat_ast_tests){};
+
+TEST(flat_ast_tests, structure)
+{
+  titan::arena nodes;
+  auto tree = parse("fn main(a:u8, b:i32[4]) -> i8 {\n"
+                    "  let x:i8 = -a + 3 * 2.5;\n"
+                    "  if (x > 1) { return x; } else { return 0; }\n"
+                    "  for (let i:u8 = 0; i < 4; i += 1) { f(b[i], {1, 2}); }\n"
+                    "}\n"
+                    "let y:u8 = 1;\n",
+                    nodes);
+  CHECK_EQUAL(2, tree.size());
+
+  titan::flat_ast ast(tree);
+  auto roots = ast.roots();
+  CHECK_EQUAL(2, roots.size());
+
+  auto &fn = ast.at(roots[0]);
+  CHECK_TRUE(fn.type == titan::flat_ast::kind::FUNCTION);
+  STRCMP_EQUAL("main",
+               std::string(titan::atoms::text(ast.extra(fn.lhs, 0))).c_str());
+  CHECK_EQUAL(3, ast.items(fn.rhs).size());
+
+  auto params = ast.items(ast.extra(fn.lhs, 3));
+  CHECK_EQUAL(2, params.size());
+  auto &b = ast.variable_at(params[1]);
+  CHECK_TRUE(b.type == titan::instructions::variable_types::I32);
+  CHECK_EQUAL(4, b.depth);
+  CHECK_EQUAL(4, ast.segment(b, 0));
+
+  // let x:i8 = -a + 3 * 2.5
+  auto &assign = ast.at(ast.items(fn.rhs)[0]);
+  CHECK_TRUE(assign.type == titan::flat_ast::kind::ASSIGN);
+  auto &sum = ast.at(assign.rhs);
+  CHECK_TRUE(sum.type == titan::flat_ast::kind::INFIX);
+  CHECK_TRUE(sum.op == titan::Token::ADD);
+  CHECK_TRUE(ast.at(sum.lhs).op == titan::Token::SUB);
+  auto &product = ast.at(sum.rhs);
+  CHECK_TRUE(product.op == titan::Token::MUL);
+  CHECK_EQUAL(3, ast.literal_at(ast.at(product.lhs).lhs).integer);
+  CHECK_EQUAL(2.5, ast.literal_at(ast.at(product.rhs).lhs).real);
+
+  auto &branch = ast.at(ast.items(fn.rhs)[1]);
+  CHECK_TRUE(branch.type == titan::flat_ast::kind::IF);
+  CHECK_EQUAL(2, ast.items(branch.lhs).size());
+
+  // Operands always come before the node using them
+  for (uint32_t i = 0; i < ast.size(); i++) {
+    for (auto child : children(ast, ast.at(i))) {
+      if (child != titan::flat_ast::none) {
+        CHECK_TRUE(child < i);
+      }
+    }
+  }
+}
+
+TEST(flat_ast_tests, compact)
+{
+  std::string source = "fn main() -> i8 {\n";
+  for (size_t i = 0; i < 1000; i++) {
+    source += "  let v_" + std::to_string(i) + ":u32 = (a + b) * " +
+              std::to_string(i) + " - f(c, d[2]);\n";
+  }
+  source += "}\n";
+
+  titan::arena nodes;
+  auto tree = parse(source, nodes);
+  CHECK_EQUAL(1, tree.size());
+
+  titan::flat_ast ast(tree);
+  CHECK_TRUE(ast.memory_usage() * 2 <= nodes.bytes_used());
+}
+
+TEST(flat_ast_tests, write_and_read)
+{
+  titan::arena nodes;
+  auto tree = parse("fn main(a:u8, b:i32[4]) -> i8 {\n"
+                    "  let x:f = -a + 3 * 2.5;\n"
+                    "  let s:str = \"text\";\n"
+                    "  if (x > 1) { return x; } else { return 0; }\n"
+                    "  while (x < 2) { x += 1; }\n"
+                    "  for (let i:u8 = 0; i < 4; i += 1) { f(b[i], {1, 2}); }\n"
+                    "}\n",
+                    nodes);
+
+  titan::flat_ast ast(tree);
+  std::string bytes;
+  ast.write(bytes);
+
+  titan::flat_ast loaded;
+  CHECK_TRUE(loaded.read(bytes));
+  CHECK_EQUAL(ast.size(), loaded.size());
+
+  // Expanding gives back the same tree
+  titan::arena expanded_nodes;
+  auto expanded = loaded.expand(expanded_nodes);
+  titan::flat_ast again(expanded);
+  std::string again_bytes;
+  again.write(again_bytes);
+  CHECK_TRUE(bytes == again_bytes);
+
+  auto fn = static_cast<titan::instructions::function *>(expanded[0]);
+  STRCMP_EQUAL("main", std::string(fn->name).c_str());
+  CHECK_EQUAL(2, fn->parameters.size());
+  CHECK_EQUAL(5, fn->instruction_list.size());
+
+  // Anything cut short is turned away
+  for (size_t size = 0; size < bytes.size(); size += 7) {
+    CHECK_FALSE(loaded.read(std::string_view(bytes).substr(0, size)));
+  }
+  CHECK_EQUAL(0, loaded.size());
+}
+
+TEST(flat_ast_tests, deep_expressions)
+{
+  // 1 + (1 + ( ... )) and f(b[b[ ... ]], 0), nested as deep as the parser
+  // allows
+  constexpr size_t depth = 100000;
+  std::string source = "fn main(b:u8[2]) -> u8 {\n  let s:u8 = ";
+  for (size_t i = 0; i < depth; i++) {
+    source += "1 + (";
+  }
+  source += "1" + std::string(depth, ')') + ";\n  return ";
+  for (size_t i = 0; i < depth; i++) {
+    source += "f(b[";
+  }
+  source += "0";
+  for (size_t i = 0; i < depth; i++) {
+    source += "], 0)";
+  }
+  source += ";\n}\n";
+
+  titan::arena nodes;
+  auto tree = parse(source, nodes);
+  CHECK_EQUAL(1, tree.size());
+
+  titan::flat_ast ast(tree);
+  for (uint32_t i = 0; i < ast.size(); i++) {
+    for (auto child : children(ast, ast.at(i))) {
+      CHECK_TRUE(child == titan::flat_ast::none || child < i);
+    }
+  }
+
+  std::string bytes;
+  ast.write(bytes);
+  titan::flat_ast loaded;
+  CHECK_TRUE(loaded.read(bytes));
+
+  titan::arena expanded_nodes;
+  titan::flat_ast again(loaded.expand(expanded_nodes));
+  std::string again_bytes;
+  again.write(again_bytes);
+  CHECK_TRUE(bytes == again_bytes);
+}
+
+TEST(flat_ast_tests, empty_module)
+{
+  titan::flat_ast ast(std::vector<titan::instructions::instruction_ptr>{});
+  std::string bytes;
+  ast.write(bytes);
+
+  titan::flat_ast loaded;
+  CHECK_TRUE(loaded.read(bytes));
+  CHECK_EQUAL(0, loaded.size());
+  CHECK_EQUAL(0, loaded.roots().size());
+}
@@ -0,0 +1,110 @@
+#include "lang/import_resolver.hpp"
+
+#include <CppUTest/TestHarness.h>
+
+#include <filesystem>
+#include <fstream>
+#include <string>
+#include <vector>
+
+namespace
+{
+  const std::string root = "import_resolver_tests";
+  const std::vector<std::string> dirs = {root + "/first", root + "/second"};
+
+  void make_dirs()
+  {
+    std::filesystem::remove_all(root);
+    for (auto &dir : dirs) {
+      std::filesystem::create_directories(dir);
+    }
+  }
+
+  void touch(const std::string &path)
+  {
+    std::filesystem::create_directories(
+        std::filesystem::path(path).parent_path());
+    std::ofstream out(path);
+  }
+}
+
+TEST_GROUP(import_resolver_tests){};
+
+TEST(import_resolver_tests, search_order)
+{
+  make_dirs();
+  touch(dirs[1] + "/both.tl");
+  touch(dirs[0] + "/both.tl");
+  touch(dirs[1] + "/second.tl");
+  touch(dirs[1] + "/nested/deep.tl");
+
+  titan::import_resolver resolver;
+  auto [found, path] = resolver.resolve(dirs, "both.tl");
+  CHECK_TRUE(found);
+  STRCMP_EQUAL((std::filesystem::path(dirs[0]) / "both.tl").c_str(),
+               path.c_str());
+
+  std::tie(found, path) = resolver.resolve(dirs, "second.tl");
+  CHECK_TRUE(found);
+  STRCMP_EQUAL((std::filesystem::path(dirs[1]) / "second.tl").c_str(),
+               path.c_str());
+
+  std::tie(found, path) = resolver.resolve(dirs, "nested/deep.tl");
+  CHECK_TRUE(found);
+  STRCMP_EQUAL((std::filesystem::path(dirs[1]) / "nested/deep.tl").c_str(),
+               path.c_str());
+
+  // Only files can be imported
+  std::tie(found, path) = resolver.resolve(dirs, "nested");
+  CHECK_FALSE(found);
+
+  std::filesystem::remove_all(root);
+}
+
+TEST(import_resolver_tests, directories_listed_once)
+{
+  make_dirs();
+  touch(dirs[1] + "/present.tl");
+
+  titan::import_resolver resolver;
+  for (size_t i = 0; i < 100; i++) {
+    resolver.resolve(dirs, "missing_" + std::to_string(i) + ".tl");
+    CHECK_TRUE(std::get<0>(resolver.resolve(dirs, "present.tl")));
+  }
+
+  // The working directory and the two include directories
+  CHECK_EQUAL(3, resolver.directory_scans());
+
+  std::filesystem::remove_all(root);
+}
+
+TEST(import_resolver_tests, refresh_after_change)
+{
+  make_dirs();
+  titan::import_resolver resolver;
+  CHECK_FALSE(std::get<0>(resolver.resolve(dirs, "later.tl")));
+
+  // Misses are remembered until the directories are refreshed
+  touch(dirs[1] + "/later.tl");
+  CHECK_FALSE(std::get<0>(resolver.resolve(dirs, "later.tl")));
+  resolver.refresh(dirs);
+  CHECK_TRUE(std::get<0>(resolver.resolve(dirs, "later.tl")));
+
+  // Unchanged directories are not listed again
+  auto scans = resolver.directory_scans();
+  resolver.refresh(dirs);
+  CHECK_TRUE(std::get<0>(resolver.resolve(dirs, "later.tl")));
+  CHECK_EQUAL(scans, resolver.directory_scans());
+
+  std::filesystem::remove(dirs[1] + "/later.tl");
+  resolver.refresh(dirs);
+  CHECK_FALSE(std::get<0>(resolver.resolve(dirs, "later.tl")));
+
+  // A different set of directories starts over
+  touch(dirs[0] + "/later.tl");
+  std::vector<std::string> first = {dirs[0]};
+  resolver.refresh(first);
+  CHECK_TRUE(std::get<0>(resolver.resolve(first, "later.tl")));
+
+  std::filesystem::remove_all(root);
+}
@@ -0,0 +1,192 @@
+#include "lang/instructions.hpp"
+#include "lang/lexer.hpp"
+#include "lang/tokens.hpp"
+
+#include <CppUTest/TestHarness.h>
+
+#include <string>
+#include <vector>
+
+namespace
+{
+  // Lex the source line by line the way the REPL does, trimming
+  // and skipping comments beforehand
+  std::vector<titan::TD_Pair> lex_by_line(const std::string& source)
+  {
+    std::vector<titan::TD_Pair> result;
+    size_t line_no = 0;
+    size_t pos = 0;
+    while (pos <= source.size()) {
+      auto end = source.find('\n', pos);
+      if (end == std::string::npos) {
+        end = source.size();
+      }
+      line_no++;
+      auto line = source.substr(pos, end - pos);
+      pos = end + 1;
+
+      auto first = line.find_first_not_of(" \t\r");
+      if (first == std::string::npos) {
+        continue;
+      }
+      line = line.substr(first, line.find_last_not_of(" \t\r") - first + 1);
+      if (line.rfind("//", 0) == 0) {
+        continue;
+      }
+
+      titan::lexer l;
+      auto tokens = l.lex(line_no, line);
+      result.insert(result.end(), tokens.begin(), tokens.end());
+    }
+    return result;
+  }
+}
+
+TEST_GROUP(lexer_tests){};
+
+TEST(lexer_tests, buffer_matches_line_lexing)
+{
+  std::string source =
+    "// Leading comment\n"
+    "fn main(argc:u8, argv:string[2]) -> i8 {\r\n"
+    "\n"
+    "    let x:i8 = 3 + 4 ** 2 >> 1;   \n"
+    "  // indented comment\n"
+    "\tlet y:float = 3.14;\n"
+    "  let s:string = \"some \\\"quoted\\\" text\";\n"
+    "  x <<= 2; x != y; return x;\n"
+    "}";
+
+  titan::lexer l;
+  auto buffered = l.lex_buffer(source);
+  auto by_line = lex_by_line(source);
+
+  CHECK_EQUAL(by_line.size(), buffered.size());
+  for (size_t i = 0; i < buffered.size(); i++) {
+    CHECK_TRUE(buffered[i].token == by_line[i].token);
+    STRCMP_EQUAL(std::string(by_line[i].data).c_str(),
+                 std::string(buffered[i].data).c_str());
+    CHECK_EQUAL(by_line[i].line, buffered[i].line);
+    CHECK_EQUAL(by_line[i].col, buffered[i].col);
+  }
+}
+
+TEST(lexer_tests, buffer_line_tracking)
+{
+  titan::lexer l;
+  auto tokens = l.lex_buffer("\n\n   let\n// let\n  x");
+
+  CHECK_EQUAL(2, tokens.size());
+  CHECK_TRUE(tokens[0].token == titan::Token::LET);
+  CHECK_EQUAL(3, tokens[0].line);
+  CHECK_TRUE(tokens[1].token == titan::Token::IDENTIFIER);
+  CHECK_EQUAL(5, tokens[1].line);
+  CHECK_EQUAL(0, tokens[1].col);
+}
+
+TEST(lexer_tests, empty_buffer)
+{
+  titan::lexer l;
+  CHECK_TRUE(l.lex_buffer("").empty());
+  CHECK_TRUE(l.lex_buffer("  \n// nothing here\n\n").empty());
+}
+
+TEST(lexer_tests, identifiers_are_interned)
+{
+  titan::lexer l;
+  auto tokens = l.lex_buffer("let count:u8 = count + other;");
+
+  CHECK_TRUE(tokens[1].token == titan::Token::IDENTIFIER);
+  CHECK_TRUE(tokens[5].token == titan::Token::IDENTIFIER);
+  CHECK_TRUE(tokens[7].token == titan::Token::IDENTIFIER);
+
+  // Same text, same atom and the same backing storage
+  CHECK_EQUAL(tokens[1].id, tokens[5].id);
+  CHECK_TRUE(tokens[1].data.data() == tokens[5].data.data());
+  CHECK_TRUE(tokens[1].id != tokens[7].id);
+
+  STRCMP_EQUAL("count", std::string(titan::atoms::text(tokens[1].id)).c_str());
+  CHECK_EQUAL(tokens[1].id, titan::atoms::find("count"));
+}
+
+TEST(lexer_tests, keywords)
+{
+  titan::lexer l;
+  auto tokens = l.lex_buffer(
+      "fn while for if else return break let import "
+      "f fnn whil iff elses let_ _import Return");
+
+  std::vector<titan::Token> expected = {
+    titan::Token::FN, titan::Token::WHILE, titan::Token::FOR,
+    titan::Token::IF, titan::Token::ELSE, titan::Token::RETURN,
+    titan::Token::BREAK, titan::Token::LET, titan::Token::IMPORT };
+
+  CHECK_EQUAL(expected.size() + 8, tokens.size());
+  for (size_t i = 0; i < tokens.size(); i++) {
+    if (i < expected.size()) {
+      CHECK_TRUE(tokens[i].token == expected[i]);
+    }
+    else {
+      CHECK_TRUE(tokens[i].token == titan::Token::IDENTIFIER);
+    }
+  }
+}
+
+TEST(lexer_tests, type_names)
+{
+  using titan::instructions::variable_types;
+  using titan::instructions::string_to_variable_type;
+
+  CHECK_TRUE(string_to_variable_type("u8") == variable_types::U8);
+  CHECK_TRUE(string_to_variable_type("u16") == variable_types::U16);
+  CHECK_TRUE(string_to_variable_type("u32") == variable_types::U32);
+  CHECK_TRUE(string_to_variable_type("u64") == variable_types::U64);
+  CHECK_TRUE(string_to_variable_type("i8") == variable_types::I8);
+  CHECK_TRUE(string_to_variable_type("i16") == variable_types::I16);
+  CHECK_TRUE(string_to_variable_type("i32") == variable_types::I32);
+  CHECK_TRUE(string_to_variable_type("i64") == variable_types::I64);
+  CHECK_TRUE(string_to_variable_type("float") == variable_types::FLOAT);
+  CHECK_TRUE(string_to_variable_type("string") == variable_types::STRING);
+
+  CHECK_TRUE(string_to_variable_type("nil") == variable_types::UNDEF);
+  CHECK_TRUE(string_to_variable_type("") == variable_types::UNDEF);
+  CHECK_TRUE(string_to_variable_type("u128") == variable_types::UNDEF);
+  CHECK_TRUE(string_to_variable_type("i6") == variable_types::UNDEF);
+}
+
+TEST(lexer_tests, number_literals)
+{
+  titan::lexer l;
+  auto tokens = l.lex_buffer(
+      "127 128 32768 2147483648 9223372036854775808 "
+      "18446744073709551615 3.25 7. 1..5");
+
+  std::vector<titan::literal_type> expected = {
+    titan::literal_type::I8, titan::literal_type::I16,
+    titan::literal_type::I32, titan::literal_type::I64,
+    titan::literal_type::U64, titan::literal_type::U64,
+    titan::literal_type::FLOAT, titan::literal_type::I8,
+    titan::literal_type::FLOAT };
+
+  CHECK_EQUAL(expected.size(), tokens.size());
+  for (size_t i = 0; i < tokens.size(); i++) {
+    CHECK_TRUE(tokens[i].value.type == expected[i]);
+  }
+
+  CHECK_EQUAL(127, tokens[0].value.integer);
+  CHECK_EQUAL(9223372036854775808ull, tokens[4].value.integer);
+  CHECK_EQUAL(18446744073709551615ull, tokens[5].value.integer);
+  DOUBLES_EQUAL(3.25, tokens[6].value.real, 0.0);
+  CHECK_EQUAL(7, tokens[7].value.integer);
+  DOUBLES_EQUAL(1.0, tokens[8].value.real, 0.0);
+}
+
+TEST(lexer_tests, number_out_of_range)
+{
+  titan::lexer l;
+  auto tokens = l.lex_buffer("let x = 18446744073709551616;");
+
+  CHECK_EQUAL(5, tokens.size());
+  CHECK_TRUE(tokens[3].token == titan::Token::ERT);
+  STRCMP_EQUAL("18446744073709551616", std::string(tokens[3].data).c_str());
+}
@@ -0,0 +1,363 @@
+#include "lang/arena.hpp"
+#include "lang/flat_ast.hpp"
+#include "lang/lexer.hpp"
+#include "lang/module_cache.hpp"
+#include "lang/parser.hpp"
+#include "lang/token_buffer.hpp"
+#include "lang/token_stream.hpp"
+#include "parsing.hpp"
+
+#include <CppUTest/TestHarness.h>
+
+#include <cstdio>
+#include <fstream>
+#include <string>
+#include <vector>
+
+namespace
+{
+  using parsing::no_imports;
+  using parsing::parse;
+
+  void check_same_tree(const std::vector<titan::instructions::instruction_ptr> &a,
+                       const std::vector<titan::instructions::instruction_ptr> &b)
+  {
+    titan::flat_ast lhs(a);
+    titan::flat_ast rhs(b);
+    CHECK_EQUAL(lhs.size(), rhs.size());
+    CHECK_EQUAL(lhs.roots().size(), rhs.roots().size());
+    for (uint32_t i = 0; i < lhs.size(); i++) {
+      auto &x = lhs.at(i);
+      auto &y = rhs.at(i);
+      CHECK_TRUE(x.type == y.type && x.op == y.op);
+      CHECK_EQUAL(x.line, y.line);
+      CHECK_EQUAL(x.col, y.col);
+      CHECK_EQUAL(x.lhs, y.lhs);
+      CHECK_EQUAL(x.rhs, y.rhs);
+    }
+  }
+
+  std::string many_functions(size_t count)
+  {
+    std::string source = "let limit:u64 = 10;\n";
+    for (size_t i = 0; i < count; i++) {
+      auto n = std::to_string(i);
+      source += "fn f_" + n + "(a:u64) -> u64 {\n"
+                "  if (a > limit) { return a - " + n + "; }\n"
+                "  while (a < limit) { a += { 1, 2 }[0]; }\n"
+                "  return a * " + n + ";\n"
+                "}\n"
+                "let v_" + n + ":u64 = " + n + ";\n";
+    }
+    return source;
+  }
+
+  titan::token_stream_ptr open_file(const std::string &path, bool quiet)
+  {
+    auto stream = std::make_unique<titan::file_token_stream>();
+    if (!stream->open(path, quiet)) {
+      return quiet ? nullptr : std::make_unique<titan::vector_token_stream>();
+    }
+    return stream;
+  }
+
+  titan::instructions::expression *
+  expression_of(titan::instructions::instruction_ptr ins)
+  {
+    return static_cast<titan::instructions::expression_instruction *>(ins)
+        ->expr;
+  }
+}
+
+TEST_GROUP(parser_tests){};
+
+TEST(parser_tests, deep_groups)
+{
+  constexpr size_t depth = 1000000;
+  std::string source = std::string(depth, '(') + "a" + std::string(depth, ')') + ";";
+
+  titan::arena nodes;
+  bool okay = false;
+  auto tree = parse(source, nodes, &okay);
+  CHECK_TRUE(okay);
+  CHECK_EQUAL(1, tree.size());
+
+  auto expr = expression_of(tree[0]);
+  CHECK_TRUE(expr->type == titan::instructions::node_type::ID);
+  STRCMP_EQUAL("a", std::string(expr->value).c_str());
+}
+
+TEST(parser_tests, deep_operators)
+{
+  // a + (a + (a + ... ))
+  constexpr size_t depth = 100000;
+  std::string source;
+  for (size_t i = 0; i < depth; i++) {
+    source += "-a + (";
+  }
+  source += "a" + std::string(depth, ')') + ";";
+
+  titan::arena nodes;
+  bool okay = false;
+  auto tree = parse(source, nodes, &okay);
+  CHECK_TRUE(okay);
+
+  size_t found = 0;
+  auto expr = expression_of(tree[0]);
+  while (expr->type == titan::instructions::node_type::INFIX) {
+    auto infix = static_cast<titan::instructions::infix_expr *>(expr);
+    CHECK_TRUE(infix->op == titan::Token::ADD);
+    CHECK_TRUE(infix->left->type == titan::instructions::node_type::PREFIX);
+    expr = infix->right;
+    found++;
+  }
+  CHECK_EQUAL(depth, found);
+  CHECK_TRUE(expr->type == titan::instructions::node_type::ID);
+}
+
+TEST(parser_tests, deep_calls_and_indexes)
+{
+  // f(b[f(b[ ... ])])
+  constexpr size_t depth = 100000;
+  std::string source;
+  for (size_t i = 0; i < depth; i++) {
+    source += "f(b[";
+  }
+  source += "{1, 2}";
+  for (size_t i = 0; i < depth; i++) {
+    source += "], 0)";
+  }
+  source += ";";
+
+  titan::arena nodes;
+  bool okay = false;
+  auto tree = parse(source, nodes, &okay);
+  CHECK_TRUE(okay);
+
+  size_t found = 0;
+  auto expr = expression_of(tree[0]);
+  while (expr->type == titan::instructions::node_type::CALL) {
+    auto call = static_cast<titan::instructions::function_call_expr *>(expr);
+    CHECK_EQUAL(2, call->params.size());
+    auto idx = call->params[0];
+    CHECK_TRUE(idx->type == titan::instructions::node_type::ARRAY_IDX);
+    expr = static_cast<titan::instructions::array_index_expr *>(idx)->index;
+    found++;
+  }
+  CHECK_EQUAL(depth, found);
+  CHECK_TRUE(expr->type == titan::instructions::node_type::ARRAY);
+}
+
+TEST(parser_tests, unbalanced_group)
+{
+  titan::arena nodes;
+  bool okay = true;
+  parse("let x:u8 = ((1 + 2);", nodes, &okay);
+  CHECK_FALSE(okay);
+}
+
+TEST(parser_tests, parallel_functions)
+{
+  auto source = many_functions(500);
+
+  titan::arena serial_nodes;
+  bool serial_okay = false;
+  auto serial = parse(source, serial_nodes, &serial_okay);
+  CHECK_TRUE(serial_okay);
+  CHECK_EQUAL(1001, serial.size());
+
+  titan::arena parallel_nodes;
+  bool parallel_okay = false;
+  auto parallel = parse(source, parallel_nodes, &parallel_okay, 4);
+  CHECK_TRUE(parallel_okay);
+  check_same_tree(serial, parallel);
+}
+
+TEST(parser_tests, parallel_functions_with_error)
+{
+  // An error in one function fails the whole parse as it does serially
+  auto source = many_functions(300) + "fn broken() -> u8 { return (1; }\n" +
+                many_functions(300);
+
+  titan::arena nodes;
+  bool okay = true;
+  auto tree = parse(source, nodes, &okay, 4);
+  CHECK_FALSE(okay);
+  CHECK_EQUAL(0, tree.size());
+
+  // Unbalanced braces leave the rest of the file to the parser
+  okay = true;
+  parse(many_functions(300) + "fn open() -> u8 {\n" + many_functions(300),
+        nodes, &okay, 4);
+  CHECK_FALSE(okay);
+}
+
+TEST(parser_tests, lazy_bodies)
+{
+  std::string source = "fn add(a:u8) -> u8 { if (a > 1) { return a + 1; } return a; }\n"
+                       "fn broken() -> u8 { return (1; }\n"
+                       "fn empty() -> u8 {}\n"
+                       "let x:u8 = add(2);\n";
+
+  titan::lexer l;
+  titan::token_buffer buffer;
+  l.lex_buffer(source, buffer);
+
+  // Only signatures are parsed so the broken body goes unnoticed
+  titan::arena nodes;
+  titan::buffer_token_stream tokens(buffer);
+  titan::parser p(no_imports, nodes);
+  p.set_lazy_bodies(true);
+  auto tree = p.parse("test", tokens);
+  CHECK_TRUE(p.is_okay());
+  CHECK_EQUAL(4, tree.size());
+
+  auto add = static_cast<titan::instructions::function *>(tree[0]);
+  auto broken = static_cast<titan::instructions::function *>(tree[1]);
+  auto empty = static_cast<titan::instructions::function *>(tree[2]);
+  CHECK_TRUE(add->body_pending());
+  CHECK_EQUAL(1, add->parameters.size());
+  CHECK_EQUAL(0, add->instruction_list.size());
+
+  // Loading gives the same body a full parse does
+  CHECK_TRUE(add->load_body());
+  CHECK_FALSE(add->body_pending());
+  CHECK_TRUE(empty->load_body());
+  CHECK_EQUAL(0, empty->instruction_list.size());
+
+  titan::arena eager_nodes;
+  bool okay = true;
+  auto eager = parse("fn add(a:u8) -> u8 { if (a > 1) { return a + 1; } return a; }\n",
+                     eager_nodes, &okay);
+  CHECK_TRUE(okay);
+  check_same_tree(eager, {add});
+
+  CHECK_FALSE(broken->load_body());
+  CHECK_FALSE(broken->load_body());
+}
+
+TEST(parser_tests, preloaded_imports)
+{
+  std::vector<std::string> files = {"parser_tests_a.tl", "parser_tests_b.tl",
+                                    "parser_tests_shared.tl"};
+  auto write = [](const std::string &path, const std::string &source) {
+    std::ofstream out(path);
+    out << source;
+  };
+  write(files[0], "import \"parser_tests_shared.tl\"\n" + many_functions(20));
+  write(files[1], "fn b() -> u8 { return 1; }\n"
+                  "import \"parser_tests_shared.tl\"\n");
+  write(files[2], "fn shared() -> u8 { return 2; }\n");
+
+  titan::imports importer(
+      [](std::string path) { return open_file(path, false); }, {});
+  importer.preload_file = [](std::string path) { return open_file(path, true); };
+
+  std::string source = "import \"parser_tests_a.tl\"\n" + many_functions(100) +
+                       "import \"parser_tests_b.tl\"\n";
+  titan::lexer l;
+  titan::token_buffer buffer;
+  l.lex_buffer(source, buffer);
+
+  auto parse_with = [&](titan::arena &nodes, size_t jobs, bool &okay) {
+    importer.reset_modules();
+    titan::buffer_token_stream tokens(buffer);
+    titan::parser p(importer, nodes);
+    p.set_jobs(jobs);
+    auto result = p.parse("test", tokens);
+    okay = p.is_okay();
+    return result;
+  };
+
+  // Modules come out in import order with the shared one only once
+  titan::arena serial_nodes;
+  bool serial_okay = false;
+  auto serial = parse_with(serial_nodes, 1, serial_okay);
+  CHECK_TRUE(serial_okay);
+  CHECK_EQUAL(1 + 41 + 201 + 1, serial.size());
+
+  titan::arena preloaded_nodes;
+  bool preloaded_okay = false;
+  auto preloaded = parse_with(preloaded_nodes, 4, preloaded_okay);
+  CHECK_TRUE(preloaded_okay);
+  check_same_tree(serial, preloaded);
+
+  // A broken module fails the import that reaches it
+  write(files[2], "fn shared() -> u8 { return (2; }\n");
+  titan::arena failed_nodes;
+  bool failed_okay = true;
+  parse_with(failed_nodes, 4, failed_okay);
+  CHECK_FALSE(failed_okay);
+
+  for (auto &file : files) {
+    std::remove(file.c_str());
+  }
+}
+
+TEST(parser_tests, cached_modules)
+{
+  std::vector<std::string> files = {"parser_tests_main.tl",
+                                    "parser_tests_dep.tl"};
+  auto write = [](const std::string &path, const std::string &source) {
+    std::ofstream out(path);
+    out << source;
+  };
+  write(files[0], "import \"parser_tests_dep.tl\"\n" + many_functions(20));
+  write(files[1], "fn dep() -> u8 { return 1; }\n");
+
+  titan::imports importer(
+      [](std::string path) { return open_file(path, false); }, {});
+
+  bool okay = true;
+  auto parse_with = [&](titan::arena &nodes, bool cache) {
+    importer.reset_modules(files[0]);
+    titan::parser p(importer, nodes);
+    p.set_cache(cache);
+    auto result = p.parse_file(files[0], files[0]);
+    okay = okay && p.is_okay();
+    return result;
+  };
+
+  titan::arena plain_nodes;
+  auto plain = parse_with(plain_nodes, false);
+
+  // Stored by the first parse, loaded by the second
+  titan::arena stored_nodes;
+  check_same_tree(plain, parse_with(stored_nodes, true));
+  CHECK_TRUE(std::ifstream("parser_tests_main.tlc").good());
+  CHECK_TRUE(std::ifstream("parser_tests_dep.tlc").good());
+
+  titan::arena loaded_nodes;
+  check_same_tree(plain, parse_with(loaded_nodes, true));
+
+  // A cache claiming more imports than it holds is parsed again, and the
+  // cache stored over it
+  {
+    std::fstream cache("parser_tests_main.tlc",
+                       std::ios::in | std::ios::out | std::ios::binary);
+    const uint32_t imports = UINT32_MAX;
+    cache.seekp(28); // After magic, version, source size and hash, name length
+    cache.write(reinterpret_cast<const char *>(&imports), sizeof(imports));
+  }
+  titan::arena corrupt_nodes;
+  check_same_tree(plain, parse_with(corrupt_nodes, true));
+  titan::arena restored_nodes;
+  check_same_tree(plain, parse_with(restored_nodes, true));
+
+  // A changed import is parsed again while the file importing it still
+  // comes from its cache
+  write(files[1], "fn dep() -> u8 { return 2; }\nfn more() -> u8 { return 3; }\n");
+  titan::arena changed_plain_nodes;
+  auto changed = parse_with(changed_plain_nodes, false);
+  CHECK_EQUAL(plain.size() + 1, changed.size());
+
+  titan::arena changed_nodes;
+  check_same_tree(changed, parse_with(changed_nodes, true));
+
+  CHECK_TRUE(okay);
+
+  for (auto &file : files) {
+    std::remove(file.c_str());
+    std::remove(titan::module_cache::cache_path(file).c_str());
+  }
+}
@@ -0,0 +1,40 @@
+#ifndef PARSING_TESTS_HPP
+#define PARSING_TESTS_HPP
+
+#include "lang/arena.hpp"
+#include "lang/lexer.hpp"
+#include "lang/parser.hpp"
+#include "lang/token_buffer.hpp"
+#include "lang/token_stream.hpp"
+
+#include <string>
+#include <vector>
+
+namespace parsing
+{
+  // Imports that never find the file asked for
+  inline titan::imports
+      no_imports([](std::string) { return titan::token_stream_ptr(); }, {});
+
+  // Parse 'source' as a file named "test", with its nodes kept in 'nodes'.
+  // Sets 'okay', when given, to whether it parsed
+  inline std::vector<titan::instructions::instruction_ptr>
+  parse(const std::string &source, titan::arena &nodes, bool *okay = nullptr,
+        size_t jobs = 1)
+  {
+    titan::lexer l;
+    titan::token_buffer buffer;
+    l.lex_buffer(source, buffer);
+
+    titan::buffer_token_stream tokens(buffer);
+    titan::parser p(no_imports, nodes);
+    p.set_jobs(jobs);
+    auto result = p.parse("test", tokens);
+    if (okay) {
+      *okay = p.is_okay();
+    }
+    return result;
+  }
+}
+
+#endif
@@ -0,0 +1,121 @@
+#include "lang/lexer.hpp"
+#include "lang/scan.hpp"
+
+#include <CppUTest/TestHarness.h>
+
+#include <random>
+#include <string>
+#include <vector>
+
+namespace
+{
+  const std::vector<titan::scan::mode> all_modes = {
+    titan::scan::mode::SCALAR,
+    titan::scan::mode::SSE2,
+    titan::scan::mode::AVX2
+  };
+
+  // Buffer mixing every class boundary, including bytes >= 0x80 which
+  // must never be treated as identifier characters
+  std::string random_buffer(size_t size)
+  {
+    const std::string alphabet =
+      "azAZ09_ \t\r\n\v\f\"\\.;(`@[{/:\x80\xC3\xFF\x7F";
+    std::mt19937 eng(42);
+    std::uniform_int_distribution<size_t> pick(0, alphabet.size() - 1);
+    std::uniform_int_distribution<size_t> run(1, 40);
+
+    std::string result;
+    while (result.size() < size) {
+      result.append(run(eng), alphabet[pick(eng)]);
+    }
+    result.resize(size);
+    return result;
+  }
+}
+
+TEST_GROUP(scan_tests)
+{
+  void teardown()
+  {
+    titan::scan::set_mode(titan::scan::mode::AUTO);
+  }
+};
+
+TEST(scan_tests, scalar_classes)
+{
+  CHECK_TRUE(titan::scan::set_mode(titan::scan::mode::SCALAR));
+
+  std::string_view text = "abc_09 \t\r\n42x\"body\\";
+  CHECK_EQUAL(6, titan::scan::ident_end(text, 0));
+  CHECK_EQUAL(10, titan::scan::space_end(text, 6));
+  CHECK_EQUAL(12, titan::scan::digit_end(text, 10));
+  CHECK_EQUAL(13, titan::scan::string_end(text, 0));
+  CHECK_EQUAL(18, titan::scan::string_end(text, 14));
+  CHECK_EQUAL(text.size(), titan::scan::ident_end(text, text.size()));
+
+  CHECK_FALSE(titan::scan::is_ident('\xE9'));
+  CHECK_FALSE(titan::scan::is_space('\xA0'));
+  CHECK_FALSE(titan::scan::is_digit('a'));
+}
+
+TEST(scan_tests, modes_agree)
+{
+  auto buffer = random_buffer(4096);
+  std::string_view view = buffer;
+
+  for (auto m : all_modes) {
+    if (!titan::scan::set_mode(m)) {
+      CHECK_FALSE(titan::scan::is_supported(m));
+      continue;
+    }
+    CHECK_TRUE(titan::scan::active_mode() == m);
+
+    // Every start position and every buffer length hits the vector
+    // body, the 16 byte step down and the scalar tail
+    for (size_t len : {view.size(), view.size() - 1, size_t(33), size_t(17)}) {
+      auto sub = view.substr(0, len);
+      for (size_t pos = 0; pos <= sub.size(); pos++) {
+        titan::scan::set_mode(titan::scan::mode::SCALAR);
+        auto ident = titan::scan::ident_end(sub, pos);
+        auto digit = titan::scan::digit_end(sub, pos);
+        auto space = titan::scan::space_end(sub, pos);
+        auto string = titan::scan::string_end(sub, pos);
+
+        titan::scan::set_mode(m);
+        CHECK_EQUAL(ident, titan::scan::ident_end(sub, pos));
+        CHECK_EQUAL(digit, titan::scan::digit_end(sub, pos));
+        CHECK_EQUAL(space, titan::scan::space_end(sub, pos));
+        CHECK_EQUAL(string, titan::scan::string_end(sub, pos));
+      }
+    }
+  }
+}
+
+TEST(scan_tests, lexer_modes_agree)
+{
+  std::string source =
+    "fn a_very_long_identifier_that_spans_more_than_thirty_two_bytes() {\n"
+    "  let x:float = 1234567890123456789.0987654321;\n"
+    "  let n:u64 = 1. + 1..5 + 1.2.3;\n"
+    "  let s:string = \"a string literal long enough for a full vector\";\n"
+    "  let e:string = \"escaped \\\"inner\\\" quote\" + \"\" + \"x\";\n"
+    "  let  spaced   =       x;\n"
+    "}";
+
+  titan::scan::set_mode(titan::scan::mode::SCALAR);
+  auto expected = titan::lexer().lex_buffer(source);
+
+  for (auto m : all_modes) {
+    if (!titan::scan::set_mode(m)) {
+      continue;
+    }
+    auto tokens = titan::lexer().lex_buffer(source);
+    CHECK_EQUAL(expected.size(), tokens.size());
+    for (size_t i = 0; i < tokens.size(); i++) {
+      CHECK_TRUE(expected[i].token == tokens[i].token);
+      CHECK_TRUE(expected[i].data == tokens[i].data);
+      CHECK_EQUAL(expected[i].col, tokens[i].col);
+    }
+  }
+}
@@ -0,0 +1,157 @@
+#include "analyze/symbols.hpp"
+#include "lang/atoms.hpp"
+
+#include <CppUTest/TestHarness.h>
+
+#include <string>
+#include <vector>
+
+namespace
+{
+  const auto undef = titan::instructions::variable_classification::UNDEF;
+
+  titan::instructions::variable *found(titan::symbol::table &table,
+                                       titan::atom name,
+                                       bool current_only = false)
+  {
+    auto entry = table.lookup(name, current_only);
+    if (!entry || entry->type != titan::symbol::variant_type::PARAMETER) {
+      return nullptr;
+    }
+    return entry->parameter_variable;
+  }
+}
+
+TEST_GROUP(symbols_tests){};
+
+TEST(symbols_tests, shadowing)
+{
+  titan::instructions::variable outer("value", undef);
+  titan::instructions::variable inner("value", undef);
+  titan::instructions::variable other("other", undef);
+
+  titan::symbol::table table;
+  CHECK_TRUE(table.add_symbol(outer.id, &outer));
+  CHECK_FALSE(table.add_symbol(outer.id, &inner));
+
+  auto block = table.add_scope_and_enter(titan::symbol::scope_kind::IF);
+  CHECK_EQUAL(block, table.current_scope());
+  CHECK_TRUE(found(table, outer.id) == &outer);
+  CHECK_TRUE(found(table, outer.id, true) == nullptr);
+
+  CHECK_TRUE(table.add_symbol(inner.id, &inner));
+  CHECK_TRUE(table.add_symbol(other.id, &other));
+  CHECK_TRUE(found(table, outer.id) == &inner);
+  CHECK_TRUE(found(table, outer.id, true) == &inner);
+
+  // Leaving the scope drops what it added and uncovers what it shadowed
+  table.pop_scope();
+  CHECK_TRUE(found(table, outer.id) == &outer);
+  CHECK_FALSE(table.exists(other.id));
+
+  // Popping at the top stays at the top
+  table.pop_scope();
+  table.pop_scope();
+  CHECK_EQUAL(0, table.current_scope());
+  CHECK_TRUE(found(table, outer.id, true) == &outer);
+}
+
+TEST(symbols_tests, top_level_scopes)
+{
+  titan::instructions::variable param("param", undef);
+
+  auto fn = titan::atoms::intern("fn");
+  auto nested = titan::atoms::intern("nested");
+
+  titan::symbol::table table;
+  CHECK_FALSE(table.activate_top_level_scope(fn));
+
+  table.add_scope_and_enter(titan::symbol::scope_kind::FUNCTION, fn);
+  CHECK_TRUE(table.add_symbol(param.id, &param));
+  STRCMP_EQUAL("fn", table.scope_name().c_str());
+  table.add_scope_and_enter(titan::symbol::scope_kind::FUNCTION, nested);
+  table.set_scope_to_global();
+  CHECK_FALSE(table.exists(param.id));
+  STRCMP_EQUAL("global", table.scope_name().c_str());
+
+  // Only scopes directly under the global scope can be activated
+  CHECK_FALSE(table.activate_top_level_scope(nested));
+  CHECK_TRUE(table.activate_top_level_scope(fn));
+  CHECK_TRUE(found(table, param.id, true) == &param);
+  table.pop_scope();
+  CHECK_FALSE(table.exists(param.id));
+}
+
+TEST(symbols_tests, many_symbols)
+{
+  std::vector<titan::instructions::variable> vars;
+  vars.reserve(20000);
+  for (size_t i = 0; i < 20000; i++) {
+    vars.emplace_back("symbols_tests_" + std::to_string(i), undef);
+  }
+
+  titan::symbol::table table;
+  table.add_scope_and_enter(titan::symbol::scope_kind::FUNCTION,
+                            titan::atoms::intern("fn"));
+  for (auto &v : vars) {
+    CHECK_TRUE(table.add_symbol(v.id, &v));
+  }
+  for (auto &v : vars) {
+    CHECK_FALSE(table.add_symbol(v.id, &v));
+    CHECK_TRUE(found(table, v.id, true) == &v);
+  }
+  table.pop_scope();
+  for (auto &v : vars) {
+    CHECK_FALSE(table.exists(v.id));
+  }
+}
+
+TEST(symbols_tests, scope_ids)
+{
+  titan::instructions::variable var("var", undef);
+
+  // Every scope entered gets a new id, though its record is reused
+  titan::symbol::table table;
+  titan::symbol::scope_id last = table.current_scope();
+  for (size_t i = 0; i < 100; i++) {
+    auto id = table.add_scope_and_enter(titan::symbol::scope_kind::WHILE);
+    CHECK_TRUE(id > last);
+    last = id;
+    CHECK_TRUE(table.add_symbol(var.id, &var));
+    STRCMP_EQUAL(("while_instruction_" + std::to_string(id)).c_str(),
+                 table.scope_name().c_str());
+    table.pop_scope();
+    CHECK_FALSE(table.exists(var.id));
+  }
+}
+
+TEST(symbols_tests, linked_globals)
+{
+  titan::instructions::variable first("first", undef);
+  titan::instructions::variable second("second", undef);
+  titan::instructions::variable local("local", undef);
+
+  titan::symbol::table globals;
+  CHECK_TRUE(globals.add_symbol(first.id, &first));
+  auto visible = globals.global_count();
+  CHECK_TRUE(globals.add_symbol(second.id, &second));
+  CHECK_EQUAL(2, globals.global_count());
+
+  titan::symbol::table linked(&globals);
+  linked.add_scope_and_enter(titan::symbol::scope_kind::FUNCTION,
+                             titan::atoms::intern("fn"));
+  CHECK_TRUE(found(linked, second.id) == &second);
+
+  // Globals added after the limit are out of reach
+  linked.set_visible_globals(visible);
+  CHECK_TRUE(found(linked, first.id) == &first);
+  CHECK_FALSE(linked.exists(second.id));
+  CHECK_FALSE(linked.exists(first.id, true));
+
+  // Locals shadow globals and never reach the linked table
+  CHECK_TRUE(linked.add_symbol(first.id, &local));
+  CHECK_TRUE(found(linked, first.id) == &local);
+  linked.pop_scope();
+  CHECK_TRUE(found(linked, first.id) == &first);
+  CHECK_TRUE(found(globals, first.id) == &first);
+}
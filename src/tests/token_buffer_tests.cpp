@@ -0,0 +1,83 @@
+#include "lang/lexer.hpp"
+#include "lang/token_buffer.hpp"
+#include "lang/token_stream.hpp"
+
+#include <CppUTest/TestHarness.h>
+
+#include <string>
+#include <vector>
+
+namespace
+{
+  const std::string source =
+    "// Leading comment\n"
+    "fn main(argc:u8, argv:string[2]) -> i8 {\r\n"
+    "\n"
+    "    let x:i8 = 3 + 4 ** 2 >> 1;   \n"
+    "  // indented comment\n"
+    "\tlet y:float = 3.14;\n"
+    "  let s:string = \"some \\\"quoted\\\" text\" + \"plain\";\n"
+    "  x <<= 2; x != y; x ~= @$'?.#!; return x;\n"
+    "}";
+}
+
+TEST_GROUP(token_buffer_tests){};
+
+TEST(token_buffer_tests, matches_token_list)
+{
+  titan::lexer l;
+  auto expected = l.lex_buffer(source);
+
+  titan::token_buffer buffer;
+  l.lex_buffer(source, buffer);
+
+  CHECK_EQUAL(expected.size(), buffer.size());
+  CHECK_EQUAL(9, buffer.line_count());
+  for (size_t i = 0; i < buffer.size(); i++) {
+    auto td = buffer.at(i);
+    CHECK_TRUE(expected[i].token == td.token);
+    STRCMP_EQUAL(std::string(expected[i].data).c_str(),
+                 std::string(td.data).c_str());
+    CHECK_EQUAL(expected[i].line, td.line);
+    CHECK_EQUAL(expected[i].col, td.col);
+    CHECK_EQUAL(expected[i].id, td.id);
+    CHECK_TRUE(expected[i].value.type == td.value.type);
+    CHECK_EQUAL(expected[i].value.integer, td.value.integer);
+  }
+}
+
+TEST(token_buffer_tests, stream_matches_token_list)
+{
+  titan::lexer l;
+  auto expected = l.lex_buffer(source);
+
+  titan::token_buffer buffer;
+  l.lex_buffer(source, buffer);
+
+  titan::buffer_token_stream stream(buffer);
+  for (size_t i = 0; i < expected.size(); i++) {
+    auto& td = stream.peek();
+    CHECK_TRUE(expected[i].token == td.token);
+    CHECK_TRUE(expected[i].data == td.data);
+    CHECK_EQUAL(expected[i].line, td.line);
+    CHECK_EQUAL(expected[i].col, td.col);
+    stream.advance();
+  }
+  CHECK_TRUE(stream.at_end());
+}
+
+TEST(token_buffer_tests, compact)
+{
+  std::string big;
+  for (size_t i = 0; i < 1000; i++) {
+    big += "let value_" + std::to_string(i) + ":u32 = (a + b) * " +
+           std::to_string(i) + ";\n";
+  }
+
+  titan::lexer l;
+  titan::token_buffer buffer;
+  l.lex_buffer(big, buffer);
+
+  auto list_bytes = buffer.size() * sizeof(titan::TD_Pair);
+  CHECK_TRUE(buffer.memory_usage() * 5 <= list_bytes);
+}
@@ -0,0 +1,215 @@
+#include "lang/lexer.hpp"
+#include "lang/token_stream.hpp"
+
+#include <CppUTest/TestHarness.h>
+
+#include <cstdio>
+#include <fstream>
+#include <string>
+#include <vector>
+
+namespace
+{
+  // Stream handing out tokens a few at a time so the window has to grow
+  // and compact as the reader moves through it
+  class trickle_stream : public titan::token_stream
+  {
+  public:
+    trickle_stream(size_t count, size_t batch) : _count(count), _batch(batch), _next(0) {}
+
+  protected:
+    bool pull(std::vector<titan::TD_Pair>& out) override
+    {
+      if (_next == _count) {
+        return false;
+      }
+      for (size_t i = 0; i < _batch && _next < _count; i++, _next++) {
+        out.push_back(titan::TD_Pair{titan::Token::IDENTIFIER, {}, _next, 0});
+      }
+      return true;
+    }
+
+  private:
+    size_t _count;
+    size_t _batch;
+    size_t _next;
+  };
+}
+
+TEST_GROUP(token_stream_tests){};
+
+TEST(token_stream_tests, empty_stream)
+{
+  titan::vector_token_stream stream;
+  CHECK_TRUE(stream.at_end());
+  CHECK_TRUE(stream.peek().token == titan::Token::EOS);
+  stream.advance();
+  CHECK_EQUAL(0, stream.position());
+}
+
+TEST(token_stream_tests, peek_ahead)
+{
+  titan::lexer l;
+  titan::vector_token_stream stream(l.lex(1, "let x = 3;"));
+
+  CHECK_TRUE(stream.peek().token == titan::Token::LET);
+  CHECK_TRUE(stream.peek(4).token == titan::Token::SEMICOLON);
+  CHECK_TRUE(stream.peek(5).token == titan::Token::EOS);
+
+  stream.advance();
+  CHECK_TRUE(stream.peek().token == titan::Token::IDENTIFIER);
+  CHECK_TRUE(stream.peek(3).token == titan::Token::SEMICOLON);
+
+  for (size_t i = 0; i < 10; i++) {
+    stream.advance();
+  }
+  CHECK_TRUE(stream.at_end());
+  CHECK_EQUAL(5, stream.position());
+}
+
+TEST(token_stream_tests, mark_survives_compaction)
+{
+  trickle_stream stream(10000, 7);
+
+  for (size_t i = 0; i < 3000; i++) {
+    stream.advance();
+  }
+  stream.mark();
+  for (size_t i = 0; i < 5000; i++) {
+    CHECK_EQUAL(3000 + i, stream.peek().line);
+    stream.advance();
+  }
+
+  CHECK_TRUE(stream.reset());
+  CHECK_EQUAL(3000, stream.position());
+  CHECK_EQUAL(3000, stream.peek().line);
+  CHECK_EQUAL(3100, stream.peek(100).line);
+
+  // Mark is cleared by a reset
+  CHECK_FALSE(stream.reset());
+
+  while (!stream.at_end()) {
+    stream.advance();
+  }
+  CHECK_EQUAL(10000, stream.position());
+}
+
+TEST(token_stream_tests, file_stream_matches_buffer)
+{
+  std::string source;
+  for (size_t i = 0; i < 2000; i++) {
+    source += "fn f" + std::to_string(i) + "(a:u8) -> u8 {\n";
+    source += "  // comment line\n";
+    source += "  return a * " + std::to_string(i % 100) + ";\n}\n";
+  }
+
+  std::string path = "token_stream_tests.tl";
+  {
+    std::ofstream out(path);
+    out << source;
+  }
+
+  titan::lexer l;
+  auto expected = l.lex_buffer(source);
+
+  titan::file_token_stream stream;
+  CHECK_TRUE(stream.open(path));
+
+  size_t count = 0;
+  while (!stream.at_end()) {
+    auto& td = stream.peek();
+    CHECK_TRUE(count < expected.size());
+    CHECK_TRUE(td.token == expected[count].token);
+    CHECK_TRUE(td.data == expected[count].data);
+    CHECK_EQUAL(expected[count].line, td.line);
+    CHECK_EQUAL(expected[count].col, td.col);
+    stream.advance();
+    count++;
+  }
+  CHECK_EQUAL(expected.size(), count);
+
+  std::remove(path.c_str());
+}
+
+TEST(token_stream_tests, skip_matches_advance)
+{
+  std::string source;
+  for (size_t i = 0; i < 500; i++) {
+    source += "let v" + std::to_string(i) + ":u8 = " + std::to_string(i) +
+              ";\n";
+  }
+
+  titan::lexer l;
+  titan::token_buffer buffer;
+  l.lex_buffer(source, buffer);
+
+  // Skips within the window, past it, and past the end
+  titan::buffer_token_stream stream(buffer);
+  size_t position = 0;
+  for (size_t count : {3, 700, 1, 1500, 10}) {
+    stream.peek();
+    stream.skip(count);
+    position += count;
+    CHECK_EQUAL(position, stream.position());
+
+    auto expected = buffer.at(position);
+    auto &td = stream.peek();
+    CHECK_TRUE(td.token == expected.token);
+    CHECK_EQUAL(expected.line, td.line);
+    CHECK_EQUAL(expected.col, td.col);
+  }
+
+  stream.skip(buffer.size());
+  CHECK_TRUE(stream.at_end());
+  CHECK_EQUAL(buffer.size(), stream.position());
+}
+
+TEST(token_stream_tests, pipelined_stream_matches_lexer)
+{
+  std::string source;
+  for (size_t i = 0; i < 5000; i++) {
+    source += "fn f" + std::to_string(i) + "(a:u8) -> u8 {\n";
+    source += "  // comment line\n";
+    source += "  return a * " + std::to_string(i % 100) + ";\n}\n";
+  }
+
+  std::string path = "token_stream_tests_pipelined.tl";
+  {
+    std::ofstream out(path);
+    out << source;
+  }
+
+  titan::lexer l;
+  auto expected = l.lex_buffer(source);
+
+  {
+    titan::pipelined_token_stream stream;
+    CHECK_TRUE(stream.open(path));
+
+    size_t count = 0;
+    while (!stream.at_end()) {
+      auto& td = stream.peek();
+      CHECK_TRUE(count < expected.size());
+      CHECK_TRUE(td.token == expected[count].token);
+      CHECK_TRUE(td.data == expected[count].data);
+      CHECK_EQUAL(expected[count].line, td.line);
+      CHECK_EQUAL(expected[count].col, td.col);
+      stream.advance();
+      count++;
+    }
+    CHECK_EQUAL(expected.size(), count);
+  }
+
+  // Stopping early lets the lexing thread go rather than leaving it
+  // waiting on a full queue
+  {
+    titan::pipelined_token_stream stream;
+    CHECK_TRUE(stream.open(path));
+    CHECK_TRUE(stream.peek().token == expected[0].token);
+  }
+
+  titan::pipelined_token_stream missing;
+  CHECK_FALSE(missing.open(path + ".missing"));
+
+  std::remove(path.c_str());
+}
@@ -1,12 +1,13 @@
 #include "titan.hpp"
+#include "analyze/constant_folder.hpp"
 #include "lang/instructions.hpp"
 #include "lang/lexer.hpp"
+#include "lang/token_stream.hpp"
 #include "lang/tokens.hpp"
-#include "analyze/analyzer.hpp"
+#include "app.hpp"
+#include "log/log.hpp"
 
-#include <algorithm>
 #include <filesystem>
-#include <fstream>
 #include <iostream>
 #include <string>
 #include <string_view>
@@ -15,16 +16,6 @@ namespace titan {
 
 namespace {
 
-void trim_line(std::string &line)
-{
-  line.erase(std::find_if(line.rbegin(), line.rend(),
-                          [](int ch) { return !std::isspace(ch); })
-                 .base(),
-             line.end());
-  line.erase(line.begin(), find_if_not(line.begin(), line.end(),
-                                       [](int c) { return isspace(c); }));
-}
-
 bool is_processable(std::string &line)
 {
   if (line.empty()) {
@@ -36,51 +27,52 @@ bool is_processable(std::string &line)
   return true;
 }
 
-std::vector<TD_Pair> lex_file(std::string file) 
+template <class stream_type> token_stream_ptr lex_file(std::string file)
 {
   if (!std::filesystem::is_regular_file(file)) {
     std::cout << "Importer : Given item : " << file << " is not a file" << std::endl;
-    return {};
+    return std::make_unique<vector_token_stream>();
   }
 
-  std::ifstream ifs;
-  ifs.open(file);
-
-  if (!ifs.is_open()) {
+  auto stream = std::make_unique<stream_type>();
+  if (!stream->open(file)) {
     std::cout << "Importer : Unable to open item : " << file << std::endl;
-    return {};
+    return std::make_unique<vector_token_stream>();
   }
+  return stream;
+}
 
-  std::string line;
-  size_t line_no = 0;
-  std::vector<TD_Pair> result;
-  while (std::getline(ifs, line)) {
-    line_no++;
-    trim_line(line);
-    if (!is_processable(line)) {
-      continue;
-    }
-
-    lexer l;
-    auto tokens = l.lex(line_no, line);
-    if(!tokens.empty()) {
-      result.insert(result.end(), tokens.begin(), tokens.end());
-    }
+// For preloading, which leaves reporting to the import that needs the file
+token_stream_ptr lex_file_quietly(std::string file)
+{
+  auto stream = std::make_unique<file_token_stream>();
+  if (!stream->open(file, true)) {
+    return nullptr;
   }
-
-  ifs.close();
-  return result;
+  return stream;
 }
 
-imports g_importer(lex_file, {});
+imports g_importer(lex_file<file_token_stream>, {});
 
 } // namespace
 
 titan::titan()
     : _run(true), _analyze(false), _execute(true), _is_repl(true),
-      _parser(g_importer), _executor(nullptr)
+      _keep_nodes(false), _stats(false), _jobs(1), _parser(g_importer, _nodes),
+      _executor(nullptr)
 {
   _executor = new exec(*this, _environment);
+  g_importer.preload_file = lex_file_quietly;
+}
+
+void titan::set_pipeline(bool pipeline)
+{
+  if (pipeline) {
+    g_importer.import_file = lex_file<pipelined_token_stream>;
+  }
+  else {
+    g_importer.import_file = lex_file<file_token_stream>;
+  }
 }
 
 titan::~titan()
@@ -110,10 +102,18 @@ int titan::do_repl()
       continue;
     }
 
-    lexer l;
-    auto tokens = l.lex(_current_file.line, std::string(line));
+    lexer l(std::string(_current_file.name));
+    vector_token_stream tokens(l.lex(_current_file.line, line));
 
     if (!run_tokens(tokens)) {
+
+      // A line that fails analysis has been reported and its globals
+      // dropped, so later lines can go on as if it was never entered
+      if (_parser.is_okay()) {
+        _current_file.line++;
+        continue;
+      }
+
       // Report failure
       //  _current_file.col will contain the col position of failure
       //  in the future when this thing is more aware we can split it by
@@ -136,7 +136,7 @@ int titan::do_run(std::string file)
     return 1;
   }
   
-  if(!run_tokens(lex_file(file))) {
+  if(!run_file(file)) {
     // Report failure
     return 1;
   }
@@ -150,19 +150,60 @@ void titan::set_include_dirs(std::vector<std::string> dir_list)
   g_importer.include_directories = dir_list;
 }
 
-bool titan::run_tokens(std::vector<TD_Pair> tokens) 
+bool titan::run_tokens(token_stream &tokens)
 {
-  if (tokens.empty()) {
+  if (tokens.at_end()) {
     return true;
   }
 
-  for (auto &t : tokens) {
-    std::cout << token_to_str(t) << " ";
-  }
-  std::cout << std::endl;
+  start_run();
 
   // Generate instruction(s) from token stream
   auto instructions = _parser.parse(std::string(_current_file.name), tokens);
+  if (!_parser.is_okay()) {
+    return false;
+  }
+  return run_instructions(instructions);
+}
+
+bool titan::run_file(const std::string &path)
+{
+  start_run(path);
+
+  auto instructions =
+      _parser.parse_file(std::string(_current_file.name), path);
+  if (!_parser.is_okay()) {
+    return false;
+  }
+
+  // Nothing to do for an empty file
+  if (instructions.empty()) {
+    return true;
+  }
+  return run_instructions(instructions);
+}
+
+void titan::start_run(const std::string &path)
+{
+  // The REPL holds on to what earlier lines parsed, and what they imported,
+  // when asked to or when the analysis session refers to it
+  if (_is_repl && (_keep_nodes || _analyze) && _session) {
+    g_importer.refresh();
+    return;
+  }
+
+  // Otherwise every run starts over, importing what it needs again
+  _nodes.release();
+  g_importer.reset_modules(path);
+  _session = std::make_unique<analyzer>();
+}
+
+bool titan::run_instructions(
+    std::vector<instructions::instruction_ptr> &instructions)
+{
+  LOG(DEBUG) << TAG(APP_FILE_NAME) << "[" << APP_LINE << "]: "
+             << _nodes.bytes_used() << " bytes of nodes in "
+             << _nodes.bytes_reserved() << " reserved" << std::endl;
 
   std::cout << "Got : " << instructions.size() << " instructions" << std::endl;
 
@@ -170,11 +211,21 @@ bool titan::run_tokens(std::vector<TD_Pair> tokens)
 
   // If execute - Execute the instruction
   if (_analyze) {
-    analyzer a(instructions);
-    if(!a.analyze()) {
+    _session->set_jobs(_jobs);
+    if(!_session->analyze(instructions)) {
       std::cout << "Analyzer has detected a problem" << std::endl;
       return false;
     }
+
+    // Only analyzed items are typed well enough to fold
+    constant_folder folder(_nodes);
+    folder.fold(instructions);
+    if (_stats) {
+      auto &counts = folder.totals();
+      std::cout << "Folded : " << counts.folded << " expressions, "
+                << counts.propagated << " constant uses, " << counts.pruned
+                << " if segments" << std::endl;
+    }
   }
 
   // Run instruction(s)
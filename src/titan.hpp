@@ -1,11 +1,15 @@
 #ifndef TITAN_HPP
 #define TITAN_HPP
 
+#include "analyze/analyzer.hpp"
 #include "exec/env.hpp"
 #include "exec/exec.hpp"
+#include "lang/arena.hpp"
+#include "lang/token_stream.hpp"
 #include "lang/tokens.hpp"
 #include "lang/parser.hpp"
 
+#include <memory>
 #include <string>
 #include <vector>
 
@@ -18,6 +22,30 @@ public:
   void set_analyze(bool analyze) { _analyze = analyze; }
   void set_execute(bool execute) { _execute = execute; }
 
+  // Show what constant folding changed in each analyzed run
+  void set_stats(bool stats) { _stats = stats; }
+
+  // Keep the nodes parsed from each REPL line alive until the session ends
+  // rather than dropping them once the line has run. They are always kept
+  // when analyzing, as each line is checked against the lines before it
+  void set_keep_nodes(bool keep) { _keep_nodes = keep; }
+
+  // Number of threads used to parse and analyze the functions of a file
+  void set_jobs(size_t jobs)
+  {
+    _jobs = jobs;
+    _parser.set_jobs(jobs);
+  }
+
+  // Parse the bodies of imported functions only once they are used
+  void set_lazy_imports(bool lazy) { _parser.set_lazy_imports(lazy); }
+
+  // Load files from .tlc caches of their parsed form while they are current
+  void set_cache(bool cache) { _parser.set_cache(cache); }
+
+  // Lex each file on a thread of its own while it is being parsed
+  void set_pipeline(bool pipeline);
+
   int do_repl();
   int do_run(std::string file);
   void set_include_dirs(std::vector<std::string> dir_list);
@@ -46,6 +74,9 @@ private:
   bool _analyze;
   bool _execute;
   bool _is_repl;
+  bool _keep_nodes;
+  bool _stats;
+  size_t _jobs;
 
   struct fp_info {
     std::string_view name;
@@ -56,10 +87,20 @@ private:
   fp_info _current_file;
 
   env _environment;
+  arena _nodes;
   parser _parser;
   exec * _executor;
 
-  bool run_tokens(std::vector<TD_Pair> tokens);
+  // Analyzes each run, and in the REPL every line after the first against
+  // the lines before it
+  std::unique_ptr<analyzer> _session;
+
+  bool run_tokens(token_stream &tokens);
+  bool run_file(const std::string &path);
+
+  // Forget the last run. 'path' is the file about to be run, if any
+  void start_run(const std::string &path = {});
+  bool run_instructions(std::vector<instructions::instruction_ptr> &instructions);
 };
 
 } // namespace titan